@@ -0,0 +1,305 @@
+/*
+ * asyncwrite.c: Benchmark for the asynchronous writes of recordings
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+// Writes data into a file in the given directory the way cRecorder does (in
+// blocks of about 64 KB, at a given data rate), once with synchronous and once
+// with asynchronous writes (see cUnbufferedFile::SetAsyncWrite()), and reports
+// how long the writing thread was blocked by each call to Write().
+//
+// If a number of streams is given, it then records that many synthetic TS
+// streams at the same time, once with synchronous and once with asynchronous
+// writes. Each stream has a producer thread that puts the data into a ring
+// buffer of the same size as cRecorder's (like a device delivering TS packets
+// to a receiver), and a thread that writes it from there into a file of its
+// own (like cRecorder::Action()). It reports the sustained total data rate and
+// the highest fill level of any of the ring buffers. At a given data rate,
+// data that doesn't fit into a ring buffer is dropped, just like the recorder
+// does, and reported.
+//
+// Usage: asyncwrite <directory> [<megabytes> [<megabytes per second> [<streams>]]]
+//
+// The megabytes and the rate apply to each stream. A rate of 0 writes as fast
+// as possible. The interesting figures are the maximum and the 99.9th
+// percentile of the blocking times, and the highest ring buffer fill, at a
+// realistic data rate (a few MB/s), while the disk is busy with other things.
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "remux.h"
+#include "ringbuffer.h"
+#include "tools.h"
+
+#define BLOCKSIZE (348 * TS_SIZE) // about 64 KB, the typical amount cRecorder writes at once
+#define RINGBUFSIZE (MEGABYTE(20) / TS_SIZE * TS_SIZE) // the size of cRecorder's ring buffer
+#define PUTSIZE (32 * TS_SIZE) // the amount of data a receiver typically gets from its device at once
+
+static uint64_t MicroSeconds(void)
+{
+  struct timespec tp;
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return uint64_t(tp.tv_sec) * 1000000 + tp.tv_nsec / 1000;
+}
+
+static int CompareTimes(const void *a, const void *b)
+{
+  uint64_t A = *(const uint64_t *)a;
+  uint64_t B = *(const uint64_t *)b;
+  return A < B ? -1 : A > B;
+}
+
+static bool Run(const char *FileName, bool Async, int MegaBytes, int Rate)
+{
+  cUnbufferedFile *f = cUnbufferedFile::Create(FileName, O_WRONLY | O_CREAT | O_TRUNC);
+  if (!f) {
+     fprintf(stderr, "can't create %s\n", FileName);
+     return false;
+     }
+  f->SetAsyncWrite(Async);
+  uchar *Block = MALLOC(uchar, BLOCKSIZE);
+  for (int i = 0; i < BLOCKSIZE; i++)
+      Block[i] = (i % TS_SIZE) ? uchar(rand()) : TS_SYNC_BYTE;
+  int NumBlocks = int(MEGABYTE(int64_t(MegaBytes)) / BLOCKSIZE);
+  uint64_t *Times = MALLOC(uint64_t, NumBlocks);
+  uint64_t Total = 0;
+  uint64_t Start = MicroSeconds();
+  for (int i = 0; i < NumBlocks; i++) {
+      if (Rate) {
+         // Data arrives at the given rate:
+         uint64_t Due = Start + uint64_t(i) * BLOCKSIZE / Rate;
+         uint64_t Now = MicroSeconds();
+         if (Due > Now)
+            cCondWait::SleepMs(int((Due - Now) / 1000));
+         }
+      uint64_t t = MicroSeconds();
+      if (f->Write(Block, BLOCKSIZE) < 0) {
+         perror(FileName);
+         return false;
+         }
+      Times[i] = MicroSeconds() - t;
+      Total += Times[i];
+      }
+  uint64_t t = MicroSeconds();
+  f->Close();
+  uint64_t CloseTime = MicroSeconds() - t;
+  uint64_t Elapsed = MicroSeconds() - Start;
+  qsort(Times, NumBlocks, sizeof(uint64_t), CompareTimes);
+  printf("%-5s %d MB in %.2f s (%.1f MB/s), blocked per write: avg %llu us, 99%% %llu us, 99.9%% %llu us, max %llu us, close %llu us\n",
+    Async ? "async" : "sync", MegaBytes, Elapsed / 1e6, MegaBytes / (Elapsed / 1e6),
+    (unsigned long long)(Total / NumBlocks),
+    (unsigned long long)Times[NumBlocks * 99 / 100],
+    (unsigned long long)Times[NumBlocks * 999 / 1000],
+    (unsigned long long)Times[NumBlocks - 1],
+    (unsigned long long)CloseTime);
+  free(Times);
+  free(Block);
+  delete f;
+  unlink(FileName);
+  return true;
+}
+
+// --- cStreamProducer --------------------------------------------------------
+
+class cStreamProducer : public cThread {
+private:
+  cRingBufferLinear *ringBuffer;
+  int megaBytes;
+  int rate;
+  std::atomic<bool> done;
+protected:
+  virtual void Action(void);
+public:
+  cStreamProducer(cRingBufferLinear *RingBuffer, int MegaBytes, int Rate);
+  bool Done(void) const { return done; }
+       ///< Returns true if all data has been put into the ring buffer. This is used
+       ///< instead of Active(), which isn't meant to be called all the time.
+  };
+
+cStreamProducer::cStreamProducer(cRingBufferLinear *RingBuffer, int MegaBytes, int Rate)
+:cThread("stream producer")
+{
+  ringBuffer = RingBuffer;
+  megaBytes = MegaBytes;
+  rate = Rate;
+  done = false;
+}
+
+void cStreamProducer::Action(void)
+{
+  uchar Data[PUTSIZE];
+  for (int i = 0; i < PUTSIZE; i++)
+      Data[i] = (i % TS_SIZE) ? uchar(rand()) : TS_SYNC_BYTE;
+  int NumPuts = int(MEGABYTE(int64_t(megaBytes)) / PUTSIZE);
+  uint64_t Start = MicroSeconds();
+  for (int i = 0; i < NumPuts && Running(); i++) {
+      if (rate) {
+         uint64_t Due = Start + uint64_t(i) * PUTSIZE / rate;
+         uint64_t Now = MicroSeconds();
+         if (Due > Now)
+            cCondWait::SleepMs(int((Due - Now) / 1000));
+         int p = ringBuffer->Put(Data, PUTSIZE);
+         if (p != PUTSIZE)
+            ringBuffer->ReportOverflow(PUTSIZE - p); // the recorder drops what doesn't fit
+         }
+      else {
+         for (int p = 0; p < PUTSIZE && Running(); ) // as fast as possible, but without losing data
+             p += ringBuffer->Put(Data + p, PUTSIZE - p);
+         }
+      }
+  done = true;
+}
+
+// --- cStream ---------------------------------------------------------------
+
+class cStream : public cThread, public cWriteBufferOwner {
+private:
+  cRingBufferLinear *ringBuffer;
+  cStreamProducer *producer;
+  cUnbufferedFile *file;
+  cString fileName;
+  bool ok;
+  std::atomic<bool> finished;
+  virtual void BufferWritten(const uchar *Data, int Count);
+protected:
+  virtual void Action(void);
+public:
+  cStream(const char *FileName, bool Async, int MegaBytes, int Rate);
+  virtual ~cStream();
+  bool Start(void);
+  bool Finish(void);
+       ///< Waits until all data has been produced and written, and closes the file.
+  int MaxFill(void) const { return ringBuffer->MaxFill(); }
+  uint64_t Dropped(void) const { return ringBuffer->OverflowedBytes(); }
+  };
+
+cStream::cStream(const char *FileName, bool Async, int MegaBytes, int Rate)
+:cThread("stream writer")
+{
+  fileName = FileName;
+  ringBuffer = new cRingBufferLinear(RINGBUFSIZE, TS_SIZE, true, "Stream");
+  ringBuffer->SetTimeouts(Rate ? 0 : 100, 100);
+  ringBuffer->SetIoThrottle();
+  ringBuffer->SetSingleProducerConsumer();
+  ringBuffer->SetDeferredRelease();
+  producer = new cStreamProducer(ringBuffer, MegaBytes, Rate);
+  file = cUnbufferedFile::Create(fileName, O_WRONLY | O_CREAT | O_TRUNC);
+  if (file)
+     file->SetAsyncWrite(Async);
+  else
+     fprintf(stderr, "can't create %s\n", *fileName);
+  ok = file != NULL;
+  finished = false;
+}
+
+cStream::~cStream()
+{
+  delete producer;
+  Cancel(3);
+  delete file;
+  delete ringBuffer;
+  unlink(fileName);
+}
+
+bool cStream::Start(void)
+{
+  if (file && producer->Start() && cThread::Start())
+     return true;
+  finished = true;
+  ok = false;
+  return false;
+}
+
+void cStream::BufferWritten(const uchar *Data, int Count)
+{
+  ringBuffer->Release(Data, Count);
+}
+
+void cStream::Action(void)
+{
+  while (Running()) {
+        bool Produced = producer->Done(); // checked first, so that no data can arrive unnoticed
+        int r;
+        uchar *b = ringBuffer->Get(r);
+        if (b) {
+           int Count = r / TS_SIZE * TS_SIZE;
+           if (file->WriteShared(b, Count, this) < 0) {
+              perror(fileName);
+              ok = false;
+              break;
+              }
+           ringBuffer->Del(Count);
+           }
+        else if (Produced)
+           break; // all data has been written
+        }
+  finished = true;
+}
+
+bool cStream::Finish(void)
+{
+  while (!finished)
+        cCondWait::SleepMs(10);
+  if (file && file->Close() < 0) {
+     perror(fileName);
+     ok = false;
+     }
+  return ok;
+}
+
+static bool RunStreams(const char *Directory, bool Async, int NumStreams, int MegaBytes, int Rate)
+{
+  cStream *Streams[NumStreams];
+  for (int i = 0; i < NumStreams; i++)
+      Streams[i] = new cStream(AddDirectory(Directory, cString::sprintf("asyncwrite-%d.ts", i + 1)), Async, MegaBytes, Rate);
+  bool Ok = true;
+  uint64_t Start = MicroSeconds();
+  for (int i = 0; i < NumStreams; i++)
+      Ok &= Streams[i]->Start();
+  int MaxFill = 0;
+  uint64_t Dropped = 0;
+  for (int i = 0; i < NumStreams; i++) {
+      Ok &= Streams[i]->Finish();
+      MaxFill = max(MaxFill, Streams[i]->MaxFill());
+      Dropped += Streams[i]->Dropped();
+      }
+  uint64_t Elapsed = MicroSeconds() - Start;
+  if (Ok) {
+     printf("%-5s %d streams of %d MB in %.2f s (%.1f MB/s in total), highest ring buffer fill %d KB (%d%%), %llu bytes dropped\n",
+       Async ? "async" : "sync", NumStreams, MegaBytes, Elapsed / 1e6, double(NumStreams) * MegaBytes / (Elapsed / 1e6),
+       MaxFill / KILOBYTE(1), int(MaxFill * 100 / RINGBUFSIZE), (unsigned long long)Dropped);
+     }
+  for (int i = 0; i < NumStreams; i++)
+      delete Streams[i];
+  return Ok;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+     fprintf(stderr, "usage: asyncwrite <directory> [<megabytes> [<megabytes per second> [<streams>]]]\n");
+     return 2;
+     }
+  int MegaBytes = argc > 2 ? atoi(argv[2]) : 1024;
+  int Rate = argc > 3 ? atoi(argv[3]) : 0; // MB/s, which is about the same as bytes/us
+  int NumStreams = argc > 4 ? atoi(argv[4]) : 0;
+  if (MegaBytes <= 0 || Rate < 0 || NumStreams < 0) {
+     fprintf(stderr, "invalid size, rate or number of streams\n");
+     return 2;
+     }
+  cString FileName = AddDirectory(argv[1], "asyncwrite.ts");
+  if (!Run(FileName, false, MegaBytes, Rate) || !Run(FileName, true, MegaBytes, Rate))
+     return 1;
+  if (NumStreams) {
+     if (!RunStreams(argv[1], false, NumStreams, MegaBytes, Rate) || !RunStreams(argv[1], true, NumStreams, MegaBytes, Rate))
+        return 1;
+     }
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * devicesel.c: Benchmark for the device selection
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+// Sets up 16 devices (12 for satellite, 4 for cable) and 6 CAM slots, and
+// measures how long a call to cDevice::GetDevice() takes for free-to-air and
+// encrypted channels, once with the selection cache invalidated before every
+// call and once with the cached selections (this is what happens when the
+// timers are checked, or the EPG scanner looks for an idle device).
+//
+// Before that, it makes sure that the cached selections are the same as the
+// ones made from scratch, while the devices are switched to other channels
+// every now and then.
+//
+// Usage: devicesel [<calls>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "channels.h"
+#include "ci.h"
+#include "device.h"
+
+#define NUMDEVICES  16
+#define NUMCAMSLOTS  6
+#define NUMCHANNELS 100
+#define CAID     0x100 // the CA system id the CAM slots can decrypt
+
+class cBenchDevice : public cDevice {
+private:
+  int source;
+  int transponder;
+public:
+  cBenchDevice(int Source) { source = Source; transponder = 0; }
+  virtual bool ProvidesSource(int Source) const { return Source == source; }
+  virtual bool ProvidesTransponder(const cChannel *Channel) const { return ProvidesSource(Channel->Source()); }
+  virtual bool IsTunedToTransponder(const cChannel *Channel) const { return transponder == Channel->Transponder(); }
+  virtual bool ProvidesChannel(const cChannel *Channel, int Priority = IDLEPRIORITY, bool *NeedsDetachReceivers = NULL) const;
+  virtual int NumProvidedSystems(void) const { return 2; }
+  virtual bool HasCi(void) { return true; }
+protected:
+  virtual bool SetChannelDevice(const cChannel *Channel, bool LiveView) { transponder = Channel->Transponder(); return true; }
+  };
+
+bool cBenchDevice::ProvidesChannel(const cChannel *Channel, int Priority, bool *NeedsDetachReceivers) const
+{
+  bool Result = false;
+  bool NeedsDetach = false;
+  if (ProvidesTransponder(Channel)) {
+     Result = Priority == IDLEPRIORITY || Priority > this->Priority();
+     if (transponder && !IsTunedToTransponder(Channel))
+        NeedsDetach = Receiving();
+     }
+  if (NeedsDetachReceivers)
+     *NeedsDetachReceivers = NeedsDetach;
+  return Result;
+}
+
+class cBenchCiAdapter : public cCiAdapter {
+public:
+  virtual eModuleStatus ModuleStatus(int Slot) { return msReady; }
+  virtual bool Assign(cDevice *Device, bool Query = false) { return true; }
+  };
+
+class cBenchCamSlot : public cCamSlot {
+public:
+  cBenchCamSlot(cCiAdapter *CiAdapter) : cCamSlot(CiAdapter) {}
+  virtual eModuleStatus ModuleStatus(void) { return msReady; }
+  virtual bool ProvidesCa(const int *CaSystemIds) { return CaSystemIds[0] == CAID; }
+  };
+
+static cChannel Channels[NUMCHANNELS]; // every other channel is encrypted, every fifth one is on cable
+
+static int Verify(int Calls)
+{
+  int Mismatches = 0;
+  for (int n = 0; n < Calls; n++) {
+      const cChannel *Channel = &Channels[rand() % NUMCHANNELS];
+      int Priority = rand() % 3 ? 50 : 99;
+      cDevice *Cached = cDevice::GetDevice(Channel, Priority, false, true);
+      cDevice::InvalidateDeviceSelection();
+      cDevice *Fresh = cDevice::GetDevice(Channel, Priority, false, true);
+      if (Cached != Fresh)
+         Mismatches++;
+      if (n % 1000 == 0)
+         cDevice::GetDevice(rand() % NUMDEVICES)->SwitchChannel(&Channels[rand() % NUMCHANNELS], false);
+      }
+  printf("%d selections verified, %d mismatches\n", Calls, Mismatches);
+  return Mismatches;
+}
+
+static void Benchmark(int Calls, bool Encrypted, bool Cached)
+{
+  cTimeMs Timer;
+  int Found = 0;
+  for (int n = 0; n < Calls; n++) {
+      if (!Cached)
+         cDevice::InvalidateDeviceSelection();
+      // Like a timer check, which looks at the same 10 channels over and over again:
+      if (cDevice::GetDevice(&Channels[n % 10 * 2 + Encrypted], 50, false, true))
+         Found++;
+      }
+  printf("%-9s %-8s %.3f us per call (%d devices found)\n", Encrypted ? "encrypted" : "FTA", Cached ? "cached" : "uncached", Timer.Elapsed() * 1000.0 / Calls, Found);
+}
+
+int main(int argc, char *argv[])
+{
+  int Calls = argc > 1 ? atoi(argv[1]) : 200000;
+  if (Calls <= 0) {
+     fprintf(stderr, "usage: devicesel [<calls>]\n");
+     return 2;
+     }
+  for (int i = 0; i < NUMDEVICES; i++)
+      new cBenchDevice(cSource::FromString(i < 12 ? "S19.2E" : "C"));
+  cCiAdapter *CiAdapter = new cBenchCiAdapter;
+  for (int i = 0; i < NUMCAMSLOTS; i++)
+      new cBenchCamSlot(CiAdapter);
+  for (int i = 0; i < NUMCHANNELS; i++) {
+      cString s = cString::sprintf("Channel %d:%d:h:%s:27500:101:102:0:%s:%d:1:%d:0", i, 11000 + i / 10 * 20, i % 5 ? "S19.2E" : "C", i % 2 ? "100" : "0", i + 1, 1000 + i / 10);
+      if (!Channels[i].Parse(s)) {
+         fprintf(stderr, "can't create channel %d\n", i);
+         return 1;
+         }
+      }
+  cDevice::GetDevice(0)->SwitchChannel(&Channels[10], false);
+  srand(1);
+  int Mismatches = Verify(Calls / 20);
+  for (int Encrypted = 0; Encrypted <= 1; Encrypted++) {
+      Benchmark(Calls, Encrypted, false);
+      Benchmark(Calls, Encrypted, true);
+      }
+  fflush(stdout);
+  _exit(Mismatches ? 1 : 0); // the devices and CAM slots are not cleaned up
+}
@@ -0,0 +1,144 @@
+/*
+ * epgsnapshot.c: Benchmark for the binary EPG data snapshot
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+// Fills the schedules of a given number of channels with generated events,
+// saves them once in the text format of epg.data (cSchedules::Dump()) and
+// once as a binary snapshot (cSchedules::DumpSnapshot()), and reports how
+// long it takes to write and to read back each of them, as well as the size
+// of the files. Each file is read by a separate process that starts with
+// empty schedules, just like VDR does at startup.
+//
+// Usage: epgsnapshot <directory> [<channels> [<events per channel>]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "channels.h"
+#include "config.h"
+#include "epg.h"
+
+#define DESCRIPTIONS 3000 // number of different descriptions, so that some of them are shared
+
+static void MakeChannels(int NumChannels)
+{
+  LOCK_CHANNELS_WRITE;
+  for (int i = 1; i <= NumChannels; i++) {
+      cChannel *Channel = new cChannel;
+      if (!Channel->Parse(cString::sprintf("Channel %d:11836:h:S19.2E:27500:101:102:0:0:%d:1:%d:0", i, i, 1000 + i / 20))) {
+         fprintf(stderr, "can't create channel %d\n", i);
+         exit(1);
+         }
+      Channels->Add(Channel);
+      }
+  Channels->ReNumber();
+}
+
+static void MakeEvents(int NumEvents)
+{
+  char *Descriptions[DESCRIPTIONS];
+  for (int i = 0; i < DESCRIPTIONS; i++) {
+      char *s = MALLOC(char, 381);
+      int n = snprintf(s, 381, "Description %d: ", i);
+      for (int j = n; j < 380; j++)
+          s[j] = 'a' + (i * 7 + j) % 26;
+      s[380] = 0;
+      Descriptions[i] = s;
+      }
+  LOCK_CHANNELS_READ;
+  LOCK_SCHEDULES_WRITE;
+  time_t Start = time(NULL) - 3600;
+  for (const cChannel *Channel = Channels->First(); Channel; Channel = Channels->Next(Channel)) {
+      cSchedule *Schedule = Schedules->AddSchedule(Channel->GetChannelID());
+      for (int i = 0; i < NumEvents; i++) {
+          cEvent *Event = new cEvent(i);
+          Event->SetStartTime(Start + i * 3000);
+          Event->SetDuration(3000);
+          Event->SetTitle(cString::sprintf("Title %d", rand() % 5000));
+          Event->SetShortText(cString::sprintf("Short text %d", rand() % 20000));
+          Event->SetDescription(Descriptions[rand() % DESCRIPTIONS]);
+          uchar Contents[MaxEventContents] = { 0x10, 0x23 };
+          Event->SetContents(Contents);
+          Schedule->AddEvent(Event);
+          }
+      Schedule->Sort();
+      }
+  for (int i = 0; i < DESCRIPTIONS; i++)
+      free(Descriptions[i]);
+}
+
+static void Write(bool Binary, const char *FileName)
+{
+  cTimeMs Timer;
+  if (Binary ? cSchedules::DumpSnapshot() : cSchedules::Dump()) {
+     int Elapsed = int(Timer.Elapsed());
+     printf("%-6s write: %5d ms, %6.1f MB\n", Binary ? "binary" : "text", Elapsed, FileSize(FileName) / double(MEGABYTE(1)));
+     }
+  else
+     printf("%-6s write: failed\n", Binary ? "binary" : "text");
+}
+
+static void Read(bool Binary)
+{
+  // A new process starts with empty schedules:
+  pid_t Pid = fork();
+  if (Pid < 0) {
+     perror("fork");
+     return;
+     }
+  if (Pid == 0) {
+     Setup.EPGBinaryData = Binary;
+     cTimeMs Timer;
+     bool Result = cSchedules::Read();
+     int Elapsed = int(Timer.Elapsed());
+     int NumEvents = 0;
+     {
+       LOCK_SCHEDULES_READ;
+       for (const cSchedule *Schedule = Schedules->First(); Schedule; Schedule = Schedules->Next(Schedule))
+           NumEvents += Schedule->Events()->Count();
+     }
+     if (Result)
+        printf("%-6s read:  %5d ms, %d events\n", Binary ? "binary" : "text", Elapsed, NumEvents);
+     else
+        printf("%-6s read:  failed\n", Binary ? "binary" : "text");
+     fflush(stdout);
+     _exit(0);
+     }
+  waitpid(Pid, NULL, 0);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+     fprintf(stderr, "usage: epgsnapshot <directory> [<channels> [<events per channel>]]\n");
+     return 2;
+     }
+  int NumChannels = argc > 2 ? atoi(argv[2]) : 1500;
+  int NumEvents = argc > 3 ? atoi(argv[3]) : 200;
+  if (NumChannels <= 0 || NumEvents <= 0) {
+     fprintf(stderr, "invalid number of channels or events\n");
+     return 2;
+     }
+  cString FileName = AddDirectory(argv[1], "epg.data");
+  cString SnapshotName = cString::sprintf("%s.bin", *FileName); // see cSchedules::DumpSnapshot()
+  cSchedules::SetEpgDataFileName(FileName);
+  Setup.EPGLinger = 0;
+  srand(1);
+  MakeChannels(NumChannels);
+  MakeEvents(NumEvents);
+  printf("%d channels, %d events per channel\n", NumChannels, NumEvents);
+  Write(false, FileName);
+  Write(true, SnapshotName); // written after the text file, so that it is the newer one
+  fflush(stdout);
+  Read(false);
+  Read(true);
+  unlink(FileName);
+  unlink(SnapshotName);
+  return 0;
+}
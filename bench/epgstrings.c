@@ -0,0 +1,143 @@
+/*
+ * epgstrings.c: Benchmark for the shared EPG texts
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+// Creates a given number of events with generated texts and reports how much
+// heap memory they take up:
+//
+// - with the texts of each event in private copies made with strdup(), the
+//   way cEvent used to store them (the events themselves hold no texts here,
+//   the copies are kept in separate arrays of pointers that are allocated
+//   before the measurement starts)
+// - with the texts set through cEvent::SetTitle() etc., which share identical
+//   texts through cEpgStrings
+//
+// The texts are the same in both cases: a limited number of different titles
+// (think of series), short texts and descriptions (think of repeats), chosen
+// at random. The result is given per 10000 events.
+//
+// Usage: epgstrings [<events> [<titles> [<short texts> [<descriptions>]]]]
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "epg.h"
+
+#define DESCRIPTIONLENGTH 300 // bytes per description
+
+static size_t HeapUsed(void)
+{
+  struct mallinfo2 mi = mallinfo2();
+  return mi.uordblks + mi.hblkhd;
+}
+
+class cTexts {
+private:
+  int numTitles;
+  int numShortTexts;
+  int numDescriptions;
+  char title[32];
+  char shortText[32];
+  char description[DESCRIPTIONLENGTH + 1];
+public:
+  cTexts(int NumTitles, int NumShortTexts, int NumDescriptions);
+  void Next(void);
+       ///< Generates the texts of the next event.
+  const char *Title(void) const { return title; }
+  const char *ShortText(void) const { return shortText; }
+  const char *Description(void) const { return description; }
+  };
+
+cTexts::cTexts(int NumTitles, int NumShortTexts, int NumDescriptions)
+{
+  numTitles = NumTitles;
+  numShortTexts = NumShortTexts;
+  numDescriptions = NumDescriptions;
+  srand(1);
+}
+
+void cTexts::Next(void)
+{
+  snprintf(title, sizeof(title), "Title %d", rand() % numTitles);
+  snprintf(shortText, sizeof(shortText), "Short text %d", rand() % numShortTexts);
+  int d = rand() % numDescriptions;
+  int n = snprintf(description, sizeof(description), "Description %d: ", d);
+  for (int i = n; i < DESCRIPTIONLENGTH; i++)
+      description[i] = 'a' + (d * 7 + i) % 26;
+  description[DESCRIPTIONLENGTH] = 0;
+}
+
+static size_t Duplicated(int NumEvents, cTexts &Texts)
+{
+  cEvent **Events = MALLOC(cEvent *, NumEvents);
+  char **Titles = MALLOC(char *, NumEvents);
+  char **ShortTexts = MALLOC(char *, NumEvents);
+  char **Descriptions = MALLOC(char *, NumEvents);
+  size_t Heap = HeapUsed();
+  for (int i = 0; i < NumEvents; i++) {
+      Texts.Next();
+      Events[i] = new cEvent(i);
+      Titles[i] = strdup(Texts.Title());
+      ShortTexts[i] = strdup(Texts.ShortText());
+      Descriptions[i] = strdup(Texts.Description());
+      }
+  Heap = HeapUsed() - Heap;
+  for (int i = 0; i < NumEvents; i++) {
+      delete Events[i];
+      free(Titles[i]);
+      free(ShortTexts[i]);
+      free(Descriptions[i]);
+      }
+  free(Events);
+  free(Titles);
+  free(ShortTexts);
+  free(Descriptions);
+  return Heap;
+}
+
+static size_t Shared(int NumEvents, cTexts &Texts)
+{
+  cEvent **Events = MALLOC(cEvent *, NumEvents);
+  size_t Heap = HeapUsed();
+  for (int i = 0; i < NumEvents; i++) {
+      Texts.Next();
+      Events[i] = new cEvent(i);
+      Events[i]->SetTitle(Texts.Title());
+      Events[i]->SetShortText(Texts.ShortText());
+      Events[i]->SetDescription(Texts.Description());
+      }
+  Heap = HeapUsed() - Heap;
+  int Strings, References;
+  size_t Bytes;
+  cEpgStrings::GetStatistics(Strings, References, Bytes);
+  printf("cEpgStrings: %d references to %d strings (%d KB)\n", References, Strings, int(Bytes / KILOBYTE(1)));
+  for (int i = 0; i < NumEvents; i++)
+      delete Events[i];
+  free(Events);
+  return Heap;
+}
+
+int main(int argc, char *argv[])
+{
+  int NumEvents = argc > 1 ? atoi(argv[1]) : 10000;
+  int NumTitles = argc > 2 ? atoi(argv[2]) : 1500;
+  int NumShortTexts = argc > 3 ? atoi(argv[3]) : 6000;
+  int NumDescriptions = argc > 4 ? atoi(argv[4]) : 5000;
+  if (NumEvents <= 0 || NumTitles <= 0 || NumShortTexts <= 0 || NumDescriptions <= 0) {
+     fprintf(stderr, "usage: epgstrings [<events> [<titles> [<short texts> [<descriptions>]]]]\n");
+     return 2;
+     }
+  printf("%d events, %d titles, %d short texts, %d descriptions of %d bytes\n", NumEvents, NumTitles, NumShortTexts, NumDescriptions, DESCRIPTIONLENGTH);
+  cTexts DuplicatedTexts(NumTitles, NumShortTexts, NumDescriptions);
+  size_t HeapDuplicated = Duplicated(NumEvents, DuplicatedTexts);
+  cTexts SharedTexts(NumTitles, NumShortTexts, NumDescriptions);
+  size_t HeapShared = Shared(NumEvents, SharedTexts);
+  printf("strdup():    %6d KB per 10000 events\n", int(HeapDuplicated * 10000 / NumEvents / KILOBYTE(1)));
+  printf("cEpgStrings: %6d KB per 10000 events\n", int(HeapShared * 10000 / NumEvents / KILOBYTE(1)));
+  return 0;
+}
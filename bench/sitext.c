@@ -0,0 +1,166 @@
+/*
+ * sitext.c: Benchmark for the conversion of SI texts
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+// Compares SI::convertCharacterTable() to the way it used to work (opening
+// an iconv handle for every text), with the system character table UTF-8:
+//
+// - Both are fed with random strings (ASCII, mixed and binary) in all
+//   character tables, and their results are checked for equality.
+// - The time per string is measured for some typical EPG texts.
+//
+// Usage: sitext [<strings per character table>]
+
+#include <errno.h>
+#include <iconv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "libsi/si.h"
+#include "tools.h"
+
+#define SYSTEMTABLE "UTF-8"
+
+static uint64_t NanoSeconds(void)
+{
+  struct timespec tp;
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return uint64_t(tp.tv_sec) * 1000000000 + tp.tv_nsec;
+}
+
+// The previous implementation of SI::convertCharacterTable():
+
+static size_t IconvConvert(const char *from, size_t fromLength, char *to, size_t toLength, const char *fromCode)
+{
+  char *result = to;
+  if (fromCode) {
+     iconv_t cd = iconv_open(SYSTEMTABLE, fromCode);
+     if (cd != (iconv_t)-1) {
+        char *fromPtr = (char *)from;
+        while (fromLength > 0 && toLength > 1) {
+              if (iconv(cd, &fromPtr, &fromLength, &to, &toLength) == size_t(-1)) {
+                 if (errno == EILSEQ) {
+                    // A character can't be converted, so mark it with '?' and proceed:
+                    fromPtr++;
+                    fromLength--;
+                    *to++ = '?';
+                    toLength--;
+                    }
+                 else
+                    break;
+                 }
+              }
+        *to = 0;
+        iconv_close(cd);
+        }
+     }
+  else {
+     size_t len = fromLength;
+     if (len >= toLength)
+        len = toLength - 1;
+     strncpy(to, from, len);
+     to[len] = 0;
+     }
+  // Handle control codes:
+  to = result;
+  size_t len = strlen(to);
+  while (len > 0) {
+        int l = Utf8CharLen(to);
+        if (l <= 2) {
+           unsigned char *p = (unsigned char *)to;
+           if (l == 2 && *p == 0xC2) // UTF-8 sequence
+              p++;
+           bool Move = true;
+           switch (*p) {
+             case 0x8A: *to = '\n'; break;
+             case 0xA0: *to = ' ';  break;
+             default:   Move = false;
+             }
+           if (l == 2 && Move) {
+              memmove(p, p + 1, len - 1); // we also copy the terminating 0!
+              len -= 1;
+              l = 1;
+              }
+           }
+        to += l;
+        len -= l;
+        }
+  return strlen(result);
+}
+
+static const char *CharacterTables[] = { "ISO6937", "ISO-8859-1", "ISO-8859-5", "ISO-8859-7", "ISO-8859-9", "ISO-8859-15", "UTF-8", "UTF-16", "GB2312" };
+
+static int Verify(int NumStrings)
+{
+  int Mismatches = 0;
+  for (unsigned int t = 0; t < sizeof(CharacterTables) / sizeof(*CharacterTables); t++) {
+      int Differ = 0;
+      for (int n = 0; n < NumStrings; n++) {
+          char From[64];
+          int Length = rand() % int(sizeof(From));
+          int Mode = rand() % 3;
+          for (int i = 0; i < Length; i++) {
+              switch (Mode) {
+                case 0:  From[i] = 0x20 + rand() % 0x5F; break; // ASCII
+                case 1:  From[i] = (rand() % 4) ? 0x20 + rand() % 0x5F : 0x80 + rand() % 0x80; break; // mixed
+                default: From[i] = rand() % 0x100; // binary
+                }
+              }
+          char Old[256], New[256];
+          IconvConvert(From, Length, Old, sizeof(Old), CharacterTables[t]);
+          SI::convertCharacterTable(From, Length, New, sizeof(New), CharacterTables[t]);
+          if (strcmp(Old, New) != 0)
+             Differ++;
+          }
+      printf("%-12s %d strings, %d different\n", CharacterTables[t], NumStrings, Differ);
+      Mismatches += Differ;
+      }
+  return Mismatches;
+}
+
+static const char *Texts[] = {
+  "Tagesschau",
+  "Nachrichten, Wetter und Sport aus aller Welt. Moderation: Jan Hofer",
+  "\xC8" "ao und \xC8" "ubergr\xC8" "o\xFB" "e Stra\xFB" "e", // ISO6937 with umlauts
+  "\x15" "Caf\xC3\xA9 de Flore \xE2\x80\x93 Dokumentation", // UTF-8
+  NULL
+  };
+
+static void Benchmark(void)
+{
+  const int N = 200000;
+  for (int t = 0; Texts[t]; t++) {
+      const unsigned char *Text = (const unsigned char *)Texts[t];
+      int Length = strlen(Texts[t]);
+      const char *CharacterTable = SI::getCharacterTable(Text, Length);
+      char To[1024];
+      uint64_t t0 = NanoSeconds();
+      for (int i = 0; i < N; i++)
+          IconvConvert((const char *)Text, Length, To, sizeof(To), CharacterTable);
+      uint64_t t1 = NanoSeconds();
+      for (int i = 0; i < N; i++)
+          SI::convertCharacterTable((const char *)Text, Length, To, sizeof(To), CharacterTable);
+      uint64_t t2 = NanoSeconds();
+      printf("%-12s %3d bytes: iconv %5.0f ns, tables %5.0f ns per string (\"%s\")\n", CharacterTable, Length, double(t1 - t0) / N, double(t2 - t1) / N, To);
+      }
+}
+
+int main(int argc, char *argv[])
+{
+  int NumStrings = argc > 1 ? atoi(argv[1]) : 20000;
+  if (NumStrings <= 0) {
+     fprintf(stderr, "usage: sitext [<strings per character table>]\n");
+     return 2;
+     }
+  SI::SetSystemCharacterTable(SYSTEMTABLE);
+  srand(1);
+  int Mismatches = Verify(NumStrings);
+  Benchmark();
+  return Mismatches ? 1 : 0;
+}
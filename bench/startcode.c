@@ -0,0 +1,357 @@
+/*
+ * startcode.c: Benchmark for the start code search in TS payloads
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+// Measures how fast start codes are found in the payload of TS packets:
+//
+// - cTsPayload::Find() compared to reading the payload byte by byte with
+//   cTsPayload::GetByte(), the way Find() used to work, on payload data
+//   that contains no start code at all. Since cTsPayload looks at no more
+//   than 6 TS packets of a payload unit, the PES packets have that size.
+// - cFrameDetector::Analyze() on MPEG-2, H.264 and H.265 video streams with
+//   two frames per PES packet, which makes the parser scan the entire payload
+//   (this is what the recorder and GenerateIndex() do with such streams).
+//   Each stream is analyzed once with the parser reading every payload byte
+//   with GetByte() and once with cTsPayload::SkipToStartCode(), and the
+//   result is given in frames per second on one CPU core.
+// - The same for the video stream of any recorded TS files given on the
+//   command line (up to the given number of megabytes of each file).
+//
+// Usage: startcode [<megabytes>] [<TS file>...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "remux.h"
+
+#define VPID 0x100
+#define FRAMESIZE 30000 // bytes of video data per frame
+
+static uint64_t MicroSeconds(void)
+{
+  struct timespec tp;
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return uint64_t(tp.tv_sec) * 1000000 + tp.tv_nsec / 1000;
+}
+
+static void RandomData(uchar *Data, int Length)
+{
+  // Random video data, which doesn't contain any start codes:
+  for (int i = 0; i < Length; i++) {
+      Data[i] = uchar(rand());
+      if (i >= 2 && Data[i] == 0x01 && Data[i - 1] == 0x00 && Data[i - 2] == 0x00)
+         Data[i] = 0x02;
+      }
+}
+
+class cTsStream {
+private:
+  uchar *data;
+  int length;
+  int size;
+  int cc;
+public:
+  cTsStream(int Size) { data = MALLOC(uchar, Size); length = 0; size = Size; cc = 0; }
+  ~cTsStream() { free(data); }
+  uchar *Data(void) { return data; }
+  int Length(void) { return length; }
+  bool Full(void) { return length + TS_SIZE > size; }
+  void PutPes(const uchar *Pes, int Length);
+  };
+
+void cTsStream::PutPes(const uchar *Pes, int Length)
+{
+  bool PayloadStart = true;
+  while (Length > 0 && !Full()) {
+        uchar *p = data + length;
+        p[0] = TS_SYNC_BYTE;
+        p[1] = (PayloadStart ? TS_PAYLOAD_START : 0x00) | (VPID >> 8);
+        p[2] = VPID & 0xFF;
+        int n = min(Length, TS_SIZE - 4);
+        if (n < TS_SIZE - 4) {
+           // The last packet of a PES packet is filled up with an adaptation field:
+           int a = TS_SIZE - 4 - n;
+           p[3] = TS_ADAPT_FIELD_EXISTS | TS_PAYLOAD_EXISTS | cc;
+           p[4] = a - 1;
+           if (a > 1) {
+              p[5] = 0x00;
+              memset(p + 6, 0xFF, a - 2);
+              }
+           memcpy(p + 4 + a, Pes, n);
+           }
+        else {
+           p[3] = TS_PAYLOAD_EXISTS | cc;
+           memcpy(p + 4, Pes, n);
+           }
+        cc = (cc + 1) & TS_CONT_CNT_MASK;
+        PayloadStart = false;
+        Pes += n;
+        Length -= n;
+        length += TS_SIZE;
+        }
+}
+
+class cBitWriter {
+private:
+  uchar *data;
+  int bits;
+public:
+  cBitWriter(uchar *Data) { data = Data; bits = 0; }
+  void PutBit(int Bit);
+  void PutBits(uint32_t Value, int Bits) { while (Bits--) PutBit((Value >> Bits) & 0x01); }
+  void PutGolombUe(uint32_t Value);
+  int Close(void);
+       ///< Appends the RBSP trailing bits and returns the number of bytes written.
+  };
+
+void cBitWriter::PutBit(int Bit)
+{
+  uchar &b = data[bits / 8];
+  int Mask = 0x80 >> (bits % 8);
+  b = Bit ? b | Mask : b & ~Mask;
+  bits++;
+}
+
+void cBitWriter::PutGolombUe(uint32_t Value)
+{
+  int z = 0;
+  while ((Value + 1) >> (z + 1))
+        z++;
+  PutBits(0, z);
+  PutBits(Value + 1, z + 1);
+}
+
+int cBitWriter::Close(void)
+{
+  PutBit(1);
+  while (bits % 8)
+        PutBit(0);
+  return bits / 8;
+}
+
+enum eCodec { cdMpeg2, cdH264, cdH265 };
+
+static int PutMpeg2Picture(uchar *p, int TemporalReference, bool Independent)
+{
+  int n = 0;
+  if (Independent) {
+     p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x01; p[n++] = 0xB3; // sequence header
+     p[n++] = 0x2D; p[n++] = 0x02; p[n++] = 0x40; p[n++] = 0x33; // 720x576, 4:3, 25 fps
+     }
+  int FrameType = Independent ? 1 : TemporalReference % 2 ? 3 : 2; // I, B or P
+  p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x01; p[n++] = 0x00; // picture start code
+  p[n++] = TemporalReference >> 2;
+  p[n++] = ((TemporalReference & 0x03) << 6) | (FrameType << 3);
+  p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x01; p[n++] = 0xB5; // extension start code
+  p[n++] = 0x80; // picture coding extension
+  p[n++] = 0x00;
+  p[n++] = 0x03; // frame picture
+  return n;
+}
+
+static int PutH264Picture(uchar *p, bool Independent)
+{
+  int n = 0;
+  p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x01; p[n++] = 0x09; // access unit delimiter
+  p[n++] = 0xF0;
+  if (Independent) {
+     p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x01; p[n++] = 0x67; // sequence parameter set
+     p[n++] = 77; // Main profile
+     p[n++] = 0x40;
+     p[n++] = 30; // level 3.0
+     cBitWriter Sps(p + n);
+     Sps.PutGolombUe(0); // seq_parameter_set_id
+     Sps.PutGolombUe(0); // log2_max_frame_num_minus4
+     Sps.PutGolombUe(0); // pic_order_cnt_type
+     Sps.PutGolombUe(0); // log2_max_pic_order_cnt_lsb_minus4
+     Sps.PutGolombUe(1); // max_num_ref_frames
+     Sps.PutBit(0); // gaps_in_frame_num_value_allowed_flag
+     Sps.PutGolombUe(720 / 16 - 1); // pic_width_in_mbs_minus1
+     Sps.PutGolombUe(576 / 16 - 1); // pic_height_in_map_units_minus1
+     Sps.PutBit(1); // frame_mbs_only_flag
+     Sps.PutBit(1); // direct_8x8_inference_flag
+     Sps.PutBit(0); // frame_cropping_flag
+     Sps.PutBit(0); // vui_parameters_present_flag
+     n += Sps.Close();
+     }
+  p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x01; p[n++] = Independent ? 0x65 : 0x41; // coded slice of an IDR or non-IDR picture
+  cBitWriter Slice(p + n);
+  Slice.PutGolombUe(0); // first_mb_in_slice
+  Slice.PutGolombUe(Independent ? 7 : 5); // slice_type, I or P
+  Slice.PutGolombUe(0); // pic_parameter_set_id
+  n += Slice.Close();
+  return n;
+}
+
+static int PutH265Picture(uchar *p, bool Independent)
+{
+  int n = 0;
+  p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x01; p[n++] = 35 << 1; // access unit delimiter
+  p[n++] = 0x01;
+  p[n++] = 0x50;
+  p[n++] = 0x00; p[n++] = 0x00; p[n++] = 0x01; p[n++] = (Independent ? 19 : 1) << 1; // slice segment of an IDR or trailing picture
+  p[n++] = 0x01;
+  p[n++] = 0xC0; // first_slice_segment_in_pic_flag, no_output_of_prior_pics_flag
+  return n;
+}
+
+static int PutPicture(uchar *p, eCodec Codec, int Frame)
+{
+  bool Independent = Frame % 12 == 0;
+  int n = 0;
+  switch (Codec) {
+    case cdMpeg2: n = PutMpeg2Picture(p, Frame % 12, Independent); break;
+    case cdH264:  n = PutH264Picture(p, Independent); break;
+    case cdH265:  n = PutH265Picture(p, Independent); break;
+    }
+  RandomData(p + n, FRAMESIZE);
+  return n + FRAMESIZE;
+}
+
+static void FindBenchmark(int MegaBytes)
+{
+  cTsStream Ts(MEGABYTE(MegaBytes));
+  int PesLength = 6 * (TS_SIZE - 4); // cTsPayload doesn't look at more than 6 TS packets of a payload unit
+  uchar *Pes = MALLOC(uchar, PesLength);
+  RandomData(Pes, PesLength);
+  while (!Ts.Full())
+        Ts.PutPes(Pes, PesLength);
+  free(Pes);
+  uint32_t Code = 0x000001B3; // a sequence header, which never occurs in the data
+  int PesSize = 6 * TS_SIZE; // cTsPayload stops at the next payload start
+  int Found = 0;
+  // Byte by byte:
+  uint64_t t = MicroSeconds();
+  for (int Offset = 0; Offset < Ts.Length(); Offset += PesSize) {
+      cTsPayload TsPayload(Ts.Data() + Offset, min(PesSize, Ts.Length() - Offset), VPID);
+      uint32_t Scanner = 0xFFFFFFFF;
+      while (!TsPayload.Eof()) {
+            Scanner = (Scanner << 8) | TsPayload.GetByte();
+            if (Scanner == Code)
+               Found++;
+            }
+      }
+  uint64_t Bytewise = MicroSeconds() - t;
+  // With Find():
+  t = MicroSeconds();
+  for (int Offset = 0; Offset < Ts.Length(); Offset += PesSize) {
+      cTsPayload TsPayload(Ts.Data() + Offset, min(PesSize, Ts.Length() - Offset), VPID);
+      if (TsPayload.Find(Code))
+         Found++;
+      }
+  uint64_t Find = MicroSeconds() - t;
+  printf("cTsPayload: %d MB, GetByte() %.0f MB/s, Find() %.0f MB/s (%d found)\n", MegaBytes, Ts.Length() / double(Bytewise), Ts.Length() / double(Find), Found);
+}
+
+static int CountFrames(const uchar *Data, int Length, int Pid, int Type, bool Skip, uint64_t &Elapsed)
+{
+  cTsPayload::SetSkipToStartCode(Skip);
+  cFrameDetector FrameDetector(Pid, Type);
+  int Frames = 0;
+  uint64_t t = MicroSeconds();
+  while (Length >= MIN_TS_PACKETS_FOR_FRAME_DETECTOR * TS_SIZE) {
+        int n = FrameDetector.Analyze(Data, Length);
+        if (n <= 0)
+           break;
+        if (FrameDetector.NewFrame())
+           Frames++;
+        Data += n;
+        Length -= n;
+        }
+  Elapsed = MicroSeconds() - t;
+  cTsPayload::SetSkipToStartCode(true);
+  return Frames;
+}
+
+static void FrameDetectorBenchmark(const char *Name, const uchar *Data, int Length, int Pid, int Type)
+{
+  uint64_t Bytewise, Skipping;
+  int Frames = CountFrames(Data, Length, Pid, Type, false, Bytewise);
+  int SkipFrames = CountFrames(Data, Length, Pid, Type, true, Skipping);
+  if (SkipFrames != Frames)
+     printf("%s: ERROR: %d frames without and %d frames with SkipToStartCode()\n", Name, Frames, SkipFrames);
+  printf("%s: %d MB, %d frames, GetByte() %.0f frames/s (%.0f MB/s), SkipToStartCode() %.0f frames/s (%.0f MB/s)\n", Name, int(Length / MEGABYTE(1)), Frames, Frames * 1000000.0 / Bytewise, Length / double(Bytewise), SkipFrames * 1000000.0 / Skipping, Length / double(Skipping));
+}
+
+static void FrameDetectorBenchmark(int MegaBytes, eCodec Codec)
+{
+  cTsStream Ts(MEGABYTE(MegaBytes));
+  uchar *Pes = MALLOC(uchar, 2 * (FRAMESIZE + 100));
+  uint32_t Pts = 0;
+  for (int Frame = 0; !Ts.Full(); Frame += 2) {
+      int n = 0;
+      Pes[n++] = 0x00; Pes[n++] = 0x00; Pes[n++] = 0x01; Pes[n++] = 0xE0; // PES start code, video stream
+      Pes[n++] = 0x00; Pes[n++] = 0x00; // unbounded PES packet length
+      Pes[n++] = 0x80; Pes[n++] = 0x80; Pes[n++] = 0x05; // PTS only
+      Pes[n++] = 0x21 | ((Pts >> 29) & 0x0E);
+      Pes[n++] = Pts >> 22;
+      Pes[n++] = 0x01 | ((Pts >> 14) & 0xFE);
+      Pes[n++] = Pts >> 7;
+      Pes[n++] = 0x01 | ((Pts << 1) & 0xFE);
+      n += PutPicture(Pes + n, Codec, Frame);
+      n += PutPicture(Pes + n, Codec, Frame + 1);
+      Ts.PutPes(Pes, n);
+      Pts += 2 * 3600;
+      }
+  free(Pes);
+  switch (Codec) {
+    case cdMpeg2: FrameDetectorBenchmark("MPEG-2", Ts.Data(), Ts.Length(), VPID, 0x02); break;
+    case cdH264:  FrameDetectorBenchmark("H.264", Ts.Data(), Ts.Length(), VPID, 0x1B); break;
+    case cdH265:  FrameDetectorBenchmark("H.265", Ts.Data(), Ts.Length(), VPID, 0x24); break;
+    }
+}
+
+static void FrameDetectorBenchmark(int MegaBytes, const char *FileName)
+{
+  FILE *f = fopen(FileName, "r");
+  if (!f) {
+     perror(FileName);
+     return;
+     }
+  uchar *Data = MALLOC(uchar, MEGABYTE(MegaBytes));
+  int Length = fread(Data, 1, MEGABYTE(MegaBytes), f);
+  fclose(f);
+  cPatPmtParser PatPmtParser;
+  for (int i = 0; i + TS_SIZE <= Length && !PatPmtParser.Completed(); i += TS_SIZE) {
+      const uchar *p = Data + i;
+      if (*p != TS_SYNC_BYTE)
+         break;
+      int Pid = TsPid(p);
+      if (Pid == PATPID)
+         PatPmtParser.ParsePat(p, TS_SIZE);
+      else if (PatPmtParser.IsPmtPid(Pid))
+         PatPmtParser.ParsePmt(p, TS_SIZE);
+      }
+  if (PatPmtParser.Vpid())
+     FrameDetectorBenchmark(FileName, Data, Length, PatPmtParser.Vpid(), PatPmtParser.Vtype());
+  else
+     fprintf(stderr, "%s: no video stream found\n", FileName);
+  free(Data);
+}
+
+int main(int argc, char *argv[])
+{
+  int MegaBytes = 256;
+  int FirstFile = 1;
+  if (argc > 1 && isnumber(argv[1])) {
+     MegaBytes = atoi(argv[1]);
+     FirstFile++;
+     }
+  if (MegaBytes <= 0) {
+     fprintf(stderr, "usage: startcode [<megabytes>] [<TS file>...]\n");
+     return 2;
+     }
+  srand(1);
+  FindBenchmark(MegaBytes);
+  FrameDetectorBenchmark(MegaBytes, cdMpeg2);
+  FrameDetectorBenchmark(MegaBytes, cdH264);
+  FrameDetectorBenchmark(MegaBytes, cdH265);
+  for (int i = FirstFile; i < argc; i++)
+      FrameDetectorBenchmark(MegaBytes, argv[i]);
+  return 0;
+}
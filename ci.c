@@ -2193,6 +2193,7 @@ cCamSlot::cCamSlot(cCiAdapter *CiAdapter, bool WantsTsData, cCamSlot *MasterSlot
      slotNumber = Index() + 1;
      ciAdapter->AddCamSlot(this);
      Reset();
+     cDevice::InvalidateDeviceSelection();
      }
 }
 
@@ -2202,6 +2203,7 @@ cCamSlot::~cCamSlot()
   delete caPidReceiver;
   delete caActivationReceiver;
   CamSlots.Del(this, false);
+  cDevice::InvalidateDeviceSelection();
   DeleteAllConnections();
   delete mtdHandler;
 }
@@ -2225,7 +2227,9 @@ bool cCamSlot::Assign(cDevice *Device, bool Query)
         OldDeviceNumber = assignedDevice->DeviceNumber() + 1;
         if (caPidReceiver)
            assignedDevice->Detach(caPidReceiver);
-        assignedDevice->SetCamSlot(NULL);
+        assignedDevice->SetCamSlot(NULL); // the device thread no longer hands packets to this CAM slot
+        if (BatchSize())
+           DecryptPackets(NULL, 0, NULL); // the packets are in the TS buffer of the old device
         assignedDevice = NULL;
         }
      if (ciAdapter->Assign(Device, true)) {
@@ -2339,6 +2343,7 @@ void cCamSlot::Process(cTPDU *TPDU)
                esyslog("ERROR: unknown module status %d (%s)", ms, __FUNCTION__);
           }
         lastModuleStatus = ms;
+        cDevice::InvalidateDeviceSelection();
         }
      moduleCheckTimer.Set(MODULE_CHECK_INTERVAL);
      }
@@ -2813,6 +2818,11 @@ uchar *cCamSlot::Decrypt(uchar *Data, int &Count)
   return Data;
 }
 
+int cCamSlot::DecryptPackets(uchar *Data, int Count, const uchar *Parity)
+{
+  return Count;
+}
+
 bool cCamSlot::TsPostProcess(uchar *Data)
 {
   return tc[1] ? tc[1]->TsPostProcess(Data) : false;
@@ -2988,6 +2998,7 @@ void cChannelCamRelations::Reset(int CamSlotNumber)
       ccr->ClrChecked(CamSlotNumber);
       ccr->ClrDecrypt(CamSlotNumber);
       }
+  cDevice::InvalidateDeviceSelection();
 }
 
 bool cChannelCamRelations::CamChecked(tChannelID ChannelID, int CamSlotNumber)
@@ -3010,6 +3021,7 @@ void cChannelCamRelations::SetChecked(tChannelID ChannelID, int CamSlotNumber)
   cChannelCamRelation *ccr = AddEntry(ChannelID);
   if (ccr)
      ccr->SetChecked(CamSlotNumber);
+  cDevice::InvalidateDeviceSelection();
 }
 
 void cChannelCamRelations::SetDecrypt(tChannelID ChannelID, int CamSlotNumber)
@@ -3018,6 +3030,7 @@ void cChannelCamRelations::SetDecrypt(tChannelID ChannelID, int CamSlotNumber)
   cChannelCamRelation *ccr = AddEntry(ChannelID);
   if (ccr)
      ccr->SetDecrypt(CamSlotNumber);
+  cDevice::InvalidateDeviceSelection();
 }
 
 void cChannelCamRelations::ClrChecked(tChannelID ChannelID, int CamSlotNumber)
@@ -3026,6 +3039,7 @@ void cChannelCamRelations::ClrChecked(tChannelID ChannelID, int CamSlotNumber)
   cChannelCamRelation *ccr = GetEntry(ChannelID);
   if (ccr)
      ccr->ClrChecked(CamSlotNumber);
+  cDevice::InvalidateDeviceSelection();
 }
 
 void cChannelCamRelations::ClrDecrypt(tChannelID ChannelID, int CamSlotNumber)
@@ -3034,6 +3048,7 @@ void cChannelCamRelations::ClrDecrypt(tChannelID ChannelID, int CamSlotNumber)
   cChannelCamRelation *ccr = GetEntry(ChannelID);
   if (ccr)
      ccr->ClrDecrypt(CamSlotNumber);
+  cDevice::InvalidateDeviceSelection();
 }
 
 void cChannelCamRelations::Load(const char *FileName)
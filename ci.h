@@ -254,6 +254,7 @@ private:
   cList<cCiCaProgramData> caProgramList;
   bool mtdAvailable;
   cMtdHandler *mtdHandler;
+  cCondWait packetsDecrypted;
   void KeepSharedCaPids(int ProgramNumber, const int *CaSystemIds, int *CaPids);
   void NewConnection(void);
   void DeleteAllConnections(void);
@@ -273,6 +274,10 @@ protected:
        ///< If MtdMapper is given, all SIDs and PIDs will be mapped accordingly.
   void SendCaPmts(cCiCaPmtList &CaPmtList);
        ///< Sends the given list of CA_PMTs to the CAM.
+  void PacketsDecrypted(void) { MasterSlot()->packetsDecrypted.Signal(); }
+       ///< A CAM slot that decrypts TS packets asynchronously in DecryptPackets()
+       ///< shall call this function whenever it has finished decrypting packets, so
+       ///< that the device can pick them up without having to poll for them.
   void MtdEnable(void);
        ///< Enables MTD support for this CAM. Note that actual MTD operation also
        ///< requires a CAM that supports MCD ("Multi Channel Decryption").
@@ -470,6 +475,38 @@ public:
        ///< A derived class that implements this function will also need
        ///< to set the WantsTsData parameter in the call to the base class
        ///< constructor to true in order to receive the TS data.
+  virtual int BatchSize(void) { return 0; }
+       ///< Returns the maximum number of TS packets this CAM slot wants to be given
+       ///< in one call to DecryptPackets(). If this is 0 (the default), Decrypt() is
+       ///< used instead. Like Decrypt(), DecryptPackets() is only called if the
+       ///< WantsTsData parameter was set in the call to the base class constructor.
+  virtual int DecryptPackets(uchar *Data, int Count, const uchar *Parity);
+       ///< Decrypts TS packets in place, many of them at a time. This is meant for
+       ///< CAMs that descramble in software, which need large batches of packets
+       ///< to be efficient (bitslicing, vector instructions, several threads).
+       ///< Data points to Count consecutive TS packets of the device's TS buffer,
+       ///< each TS_SIZE bytes long and starting with a TS_SYNC_BYTE. Parity[i] is
+       ///< the value of the transport_scrambling_control bits of packet i (0 if it
+       ///< is not scrambled, 2 for the even and 3 for the odd key), so that the
+       ///< packets can be grouped by key without looking at their headers again.
+       ///< Returns the number of leading packets that are done and will be processed
+       ///< further. A packet that can't be decrypted is returned as done anyway.
+       ///< The remaining packets are offered again in the next call, at the same
+       ///< address and possibly followed by more packets. So an implementation may
+       ///< keep working on them asynchronously in the meantime, and return 0 if no
+       ///< packet is done yet. In that case it shall call PacketsDecrypted() as
+       ///< soon as packets are done, because the device waits for this (at most a
+       ///< few milliseconds) before calling DecryptPackets() again.
+       ///< If Data is NULL, all packets that have not been returned as done yet are
+       ///< dropped. When this call returns, none of them may be accessed anymore.
+       ///< This happens before the device's TS buffer is deleted, or right after
+       ///< this CAM slot has been unassigned from the device (at which point the
+       ///< device thread has returned from its last call to DecryptPackets()),
+       ///< possibly in a thread other than the one of the device, so this function
+       ///< needs to be thread safe.
+       ///< The default implementation returns Count.
+  bool WaitDecrypted(int TimeoutMs) { return MasterSlot()->packetsDecrypted.Wait(TimeoutMs); }
+       ///< Waits until PacketsDecrypted() is called, or TimeoutMs have expired.
   virtual bool TsPostProcess(uchar *Data);
        ///< If there is a cCiSession that needs to do additional processing on TS packets
        ///< (after the CAM has done the decryption), this function will call its
@@ -411,6 +411,11 @@ cSetup::cSetup(void)
   EPGScanTimeout = 5;
   EPGBugfixLevel = 3;
   EPGLinger = 0;
+  EPGBinaryData = 0;
+  EPGJournal = 0;
+  EPGIndex = 1;
+  SoftwareSectionFilters = 0;
+  PmtFilters = 0;
   SVDRPTimeout = 300;
   SVDRPPeering = 0;
   strn0cpy(SVDRPHostName, GetHostName(), sizeof(SVDRPHostName));
@@ -493,10 +498,12 @@ cSetup::cSetup(void)
   CurrentDolby = 0;
   InitialChannel = "";
   DeviceBondings = "";
+  DeviceAffinity = "";
   InitialVolume = -1;
   ChannelsWrap = 0;
   ShowChannelNamesWithSource = 0;
   EmergencyExit = 1;
+  TSBufferHugePages = 0;
 }
 
 cSetup& cSetup::operator= (const cSetup &s)
@@ -504,6 +511,7 @@ cSetup& cSetup::operator= (const cSetup &s)
   memcpy(&__BeginData__, &s.__BeginData__, (char *)&s.__EndData__ - (char *)&s.__BeginData__);
   InitialChannel = s.InitialChannel;
   DeviceBondings = s.DeviceBondings;
+  DeviceAffinity = s.DeviceAffinity;
   return *this;
 }
 
@@ -639,6 +647,11 @@ bool cSetup::Parse(const char *Name, const char *Value)
   else if (!strcasecmp(Name, "EPGScanTimeout"))      EPGScanTimeout     = atoi(Value);
   else if (!strcasecmp(Name, "EPGBugfixLevel"))      EPGBugfixLevel     = atoi(Value);
   else if (!strcasecmp(Name, "EPGLinger"))           EPGLinger          = atoi(Value);
+  else if (!strcasecmp(Name, "EPGBinaryData"))       EPGBinaryData      = atoi(Value);
+  else if (!strcasecmp(Name, "EPGJournal"))          EPGJournal         = atoi(Value);
+  else if (!strcasecmp(Name, "EPGIndex"))            EPGIndex           = atoi(Value);
+  else if (!strcasecmp(Name, "SoftwareSectionFilters")) SoftwareSectionFilters = atoi(Value);
+  else if (!strcasecmp(Name, "PmtFilters"))          PmtFilters         = atoi(Value);
   else if (!strcasecmp(Name, "SVDRPTimeout"))        SVDRPTimeout       = atoi(Value);
   else if (!strcasecmp(Name, "SVDRPPeering"))        SVDRPPeering       = atoi(Value);
   else if (!strcasecmp(Name, "SVDRPHostName"))     { if (*Value) strn0cpy(SVDRPHostName, Value, sizeof(SVDRPHostName)); }
@@ -725,6 +738,8 @@ bool cSetup::Parse(const char *Name, const char *Value)
   else if (!strcasecmp(Name, "ChannelsWrap"))        ChannelsWrap       = atoi(Value);
   else if (!strcasecmp(Name, "ShowChannelNamesWithSource")) ShowChannelNamesWithSource = atoi(Value);
   else if (!strcasecmp(Name, "EmergencyExit"))       EmergencyExit      = atoi(Value);
+  else if (!strcasecmp(Name, "DeviceAffinity"))      DeviceAffinity     = Value;
+  else if (!strcasecmp(Name, "TSBufferHugePages"))   TSBufferHugePages  = atoi(Value);
   else if (!strcasecmp(Name, "LastReplayed"))        cReplayControl::SetRecording(Value);
   else
      return false;
@@ -771,6 +786,11 @@ bool cSetup::Save(void)
   Store("EPGScanTimeout",     EPGScanTimeout);
   Store("EPGBugfixLevel",     EPGBugfixLevel);
   Store("EPGLinger",          EPGLinger);
+  Store("EPGBinaryData",      EPGBinaryData);
+  Store("EPGJournal",         EPGJournal);
+  Store("EPGIndex",           EPGIndex);
+  Store("SoftwareSectionFilters", SoftwareSectionFilters);
+  Store("PmtFilters",         PmtFilters);
   Store("SVDRPTimeout",       SVDRPTimeout);
   Store("SVDRPPeering",       SVDRPPeering);
   Store("SVDRPHostName",      strcmp(SVDRPHostName, GetHostName()) ? SVDRPHostName : "");
@@ -857,6 +877,8 @@ bool cSetup::Save(void)
   Store("ChannelsWrap",       ChannelsWrap);
   Store("ShowChannelNamesWithSource", ShowChannelNamesWithSource);
   Store("EmergencyExit",      EmergencyExit);
+  Store("DeviceAffinity",     DeviceAffinity);
+  Store("TSBufferHugePages",  TSBufferHugePages);
   Store("LastReplayed",       cReplayControl::LastReplayed());
 
   Sort();
@@ -27,8 +27,8 @@
 
 // The plugin API's version number:
 
-#define APIVERSION  "2.4.3"
-#define APIVERSNUM   20403  // Version * 10000 + Major * 100 + Minor
+#define APIVERSION  "2.4.4"
+#define APIVERSNUM   20404  // Version * 10000 + Major * 100 + Minor
 
 // When loading plugins, VDR searches them by their APIVERSION, which
 // may be smaller than VDRVERSION in case there have been no changes to
@@ -287,6 +287,11 @@ public:
   int EPGScanTimeout;
   int EPGBugfixLevel;
   int EPGLinger;
+  int EPGBinaryData;
+  int EPGJournal;
+  int EPGIndex;
+  int SoftwareSectionFilters;
+  int PmtFilters;
   int SVDRPTimeout;
   int SVDRPPeering;
   char SVDRPHostName[HOST_NAME_MAX];
@@ -359,9 +364,11 @@ public:
   int ChannelsWrap;
   int ShowChannelNamesWithSource;
   int EmergencyExit;
+  int TSBufferHugePages;
   int __EndData__;
   cString InitialChannel;
   cString DeviceBondings;
+  cString DeviceAffinity;
   cSetup(void);
   cSetup& operator= (const cSetup &s);
   bool Load(const char *FileName);
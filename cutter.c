@@ -288,6 +288,7 @@ cCuttingThread::cCuttingThread(const char *FromFileName, const char *ToFileName)
      if (numSequences > 0) {
         fromFileName = new cFileName(FromFileName, false, true, isPesRecording);
         toFileName = new cFileName(ToFileName, true, true, isPesRecording);
+        toFileName->SetAsyncWrite(true);
         fromIndex = new cIndexFile(FromFileName, false, isPesRecording);
         toIndex = new cIndexFile(ToFileName, true, isPesRecording);
         toMarks.Load(ToFileName, framesPerSecond, isPesRecording); // doesn't actually load marks, just sets the file name
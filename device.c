@@ -80,6 +80,7 @@ cDevice::cDevice(void)
 :patPmtParser(true)
 {
   cardIndex = nextCardIndex++;
+  affinityNode = -1;
   dsyslog("new device number %d (card index %d)", numDevices + 1, CardIndex() + 1);
 
   SetDescription("device %d receiver", numDevices + 1);
@@ -94,6 +95,8 @@ cDevice::cDevice(void)
   nitFilter = NULL;
 
   camSlot = NULL;
+  camSlotUser = 0;
+  camSlotReleases = 0;
 
   occupiedTimeout = 0;
 
@@ -110,11 +113,19 @@ cDevice::cDevice(void)
 
   for (int i = 0; i < MAXRECEIVERS; i++)
       receiver[i] = NULL;
+  memset(receiverMask, 0, sizeof(receiverMask));
+  packetCount = 0;
+  dispatchBatches = 0;
+  dispatchSamples = 0;
+  dispatchTimeSum = 0;
+  packetRate = 0;
+  dispatchTime = 0;
 
   if (numDevices < MAXDEVICES)
      device[numDevices++] = this;
   else
      esyslog("ERROR: too many devices!");
+  InvalidateDeviceSelection();
 }
 
 cDevice::~cDevice()
@@ -201,6 +212,7 @@ bool cDevice::SetPrimaryDevice(int n)
      primaryDevice->SetVideoFormat(Setup.VideoFormat);
      primaryDevice->SetVolumeDevice(Setup.CurrentVolume);
      Setup.PrimaryDVB = n + 1;
+     InvalidateDeviceSelection();
      return true;
      }
   esyslog("ERROR: invalid primary device number: %d", n + 1);
@@ -245,7 +257,99 @@ static int GetClippedNumProvidedSystems(int AvailableBits, cDevice *Device)
   return NumProvidedSystems;
 }
 
-cDevice *cDevice::GetDevice(const cChannel *Channel, int Priority, bool LiveView, bool Query)
+// --- cDeviceSelectionCache ------------------------------------------------
+
+#define DEVICESELECTIONCACHESIZE  256 // number of cached selections (must be a power of 2)
+#define DEVICESELECTIONTIMEOUT   1000 // ms a cached selection is used at most, to cover changes nobody reports
+
+class cDeviceSelectionCache {
+private:
+  struct tEntry {
+    tChannelID channelID;
+    int transponder;
+    int ca;
+    int priority;
+    bool liveView;
+    int state;
+    uint64_t time;
+    cDevice *device;
+    cCamSlot *camSlot;
+    bool needsDetachReceivers;
+    };
+  cMutex mutex;
+  int state;
+  tEntry entries[DEVICESELECTIONCACHESIZE];
+  int Index(const cChannel *Channel, int Priority, bool LiveView);
+public:
+  cDeviceSelectionCache(void);
+  void Invalidate(void);
+  bool Get(const cChannel *Channel, int Priority, bool LiveView, cDevice *&Device, cCamSlot *&CamSlot, bool &NeedsDetachReceivers, int &State);
+       ///< Returns true if there is a valid selection for the given parameters, and
+       ///< copies it into Device, CamSlot and NeedsDetachReceivers. Otherwise the
+       ///< current state is returned in State, to be used in the call to Put().
+  void Put(const cChannel *Channel, int Priority, bool LiveView, cDevice *Device, cCamSlot *CamSlot, bool NeedsDetachReceivers, int State);
+  };
+
+static cDeviceSelectionCache DeviceSelectionCache;
+
+cDeviceSelectionCache::cDeviceSelectionCache(void)
+{
+  state = 1;
+  for (int i = 0; i < DEVICESELECTIONCACHESIZE; i++)
+      entries[i].state = 0; // state 0 is never valid
+}
+
+int cDeviceSelectionCache::Index(const cChannel *Channel, int Priority, bool LiveView)
+{
+  uint32_t h = uint32_t(Channel->Sid()) * 2654435761U ^ uint32_t(Channel->Transponder()) * 2246822519U ^ uint32_t(Priority * 2 + LiveView) * 3266489917U;
+  return (h ^ (h >> 16)) & (DEVICESELECTIONCACHESIZE - 1);
+}
+
+void cDeviceSelectionCache::Invalidate(void)
+{
+  cMutexLock MutexLock(&mutex);
+  if (++state == 0)
+     state = 1;
+}
+
+bool cDeviceSelectionCache::Get(const cChannel *Channel, int Priority, bool LiveView, cDevice *&Device, cCamSlot *&CamSlot, bool &NeedsDetachReceivers, int &State)
+{
+  cMutexLock MutexLock(&mutex);
+  State = state;
+  const tEntry &e = entries[Index(Channel, Priority, LiveView)];
+  if (e.state == state && e.priority == Priority && e.liveView == LiveView && e.channelID == Channel->GetChannelID() && e.transponder == Channel->Transponder() && e.ca == Channel->Ca() && cTimeMs::Now() - e.time < DEVICESELECTIONTIMEOUT) {
+     Device = e.device;
+     CamSlot = e.camSlot;
+     NeedsDetachReceivers = e.needsDetachReceivers;
+     return true;
+     }
+  return false;
+}
+
+void cDeviceSelectionCache::Put(const cChannel *Channel, int Priority, bool LiveView, cDevice *Device, cCamSlot *CamSlot, bool NeedsDetachReceivers, int State)
+{
+  cMutexLock MutexLock(&mutex);
+  if (State == state) { // nothing has changed while the selection was made
+     tEntry &e = entries[Index(Channel, Priority, LiveView)];
+     e.channelID = Channel->GetChannelID();
+     e.transponder = Channel->Transponder();
+     e.ca = Channel->Ca();
+     e.priority = Priority;
+     e.liveView = LiveView;
+     e.state = State;
+     e.time = cTimeMs::Now();
+     e.device = Device;
+     e.camSlot = CamSlot;
+     e.needsDetachReceivers = NeedsDetachReceivers;
+     }
+}
+
+void cDevice::InvalidateDeviceSelection(void)
+{
+  DeviceSelectionCache.Invalidate();
+}
+
+cDevice *cDevice::SelectDevice(const cChannel *Channel, int Priority, bool LiveView, cCamSlot *&CamSlot, bool &NeedsDetachReceivers)
 {
   // Collect the current priorities of all CAM slots that can decrypt the channel:
   int NumCamSlots = CamSlots.Count();
@@ -268,7 +372,7 @@ cDevice *cDevice::GetDevice(const cChannel *Channel, int Priority, bool LiveView
         InternalCamNeeded = true; // no CAM is able to decrypt this channel
      }
 
-  bool NeedsDetachReceivers = false;
+  NeedsDetachReceivers = false;
   cDevice *d = NULL;
   cCamSlot *s = NULL;
 
@@ -326,6 +430,20 @@ cDevice *cDevice::GetDevice(const cChannel *Channel, int Priority, bool LiveView
       if (!NumUsableSlots)
          break; // no CAM necessary, so just one loop over the devices
       }
+  CamSlot = s;
+  return d;
+}
+
+cDevice *cDevice::GetDevice(const cChannel *Channel, int Priority, bool LiveView, bool Query)
+{
+  bool NeedsDetachReceivers = false;
+  cDevice *d = NULL;
+  cCamSlot *s = NULL;
+  int State;
+  if (!DeviceSelectionCache.Get(Channel, Priority, LiveView, d, s, NeedsDetachReceivers, State)) {
+     d = SelectDevice(Channel, Priority, LiveView, s, NeedsDetachReceivers);
+     DeviceSelectionCache.Put(Channel, Priority, LiveView, d, s, NeedsDetachReceivers, State);
+     }
   if (d) {
      if (!Query && NeedsDetachReceivers)
         d->DetachAllReceivers();
@@ -444,8 +562,18 @@ bool cDevice::HasCi(void)
 
 void cDevice::SetCamSlot(cCamSlot *CamSlot)
 {
-  LOCK_THREAD;
-  camSlot = CamSlot;
+  cMutexLock MutexLock(&mutexCamSlot);
+  {
+    LOCK_THREAD;
+    camSlot = CamSlot;
+  }
+  if (camSlotUser && camSlotUser != cThread::ThreadId()) { // a CAM may unassign itself from within GetTSPackets()
+     // Only the ongoing call to GetTSPackets() may still use the previous CAM slot:
+     int Releases = camSlotReleases;
+     while (camSlotReleases == Releases)
+           camSlotIdle.Wait(mutexCamSlot);
+     }
+  InvalidateDeviceSelection();
 }
 
 void cDevice::Shutdown(void)
@@ -457,6 +585,60 @@ void cDevice::Shutdown(void)
       }
 }
 
+static cString NumaNodeCpus(int Node)
+{
+  cString CpuList;
+  if (FILE *f = fopen(cString::sprintf("/sys/devices/system/node/node%d/cpulist", Node), "r")) {
+     cReadLine ReadLine;
+     char *s = ReadLine.Read(f);
+     if (s && *stripspace(s))
+        CpuList = s;
+     fclose(f);
+     }
+  return CpuList;
+}
+
+void cDevice::SetCpuAffinities(const char *Affinities)
+{
+  for (int i = 0; i < numDevices; i++) {
+      device[i]->cpuAffinity = NULL;
+      device[i]->affinityNode = -1;
+      }
+  char *Buffer = strdup(Affinities);
+  char *strtok_next;
+  for (char *p = strtok_r(Buffer, " \t", &strtok_next); p; p = strtok_r(NULL, " \t", &strtok_next)) {
+      char *Cpus = strchr(p, ':');
+      int n = strtol(p, NULL, 10) - 1;
+      if (!Cpus || n < 0 || n >= numDevices) {
+         esyslog("ERROR: invalid device affinity '%s'", p);
+         continue;
+         }
+      cDevice *d = device[n];
+      Cpus++;
+      int Node = -1;
+      if (strcasecmp(Cpus, "auto") == 0) {
+         if ((Node = d->NumaNode()) < 0) {
+            isyslog("device %d: NUMA node unknown, affinity not set", n + 1);
+            continue;
+            }
+         }
+      else if (startswith(Cpus, "node"))
+         Node = strtol(Cpus + 4, NULL, 10);
+      if (Node >= 0) {
+         d->cpuAffinity = NumaNodeCpus(Node);
+         if (!*d->cpuAffinity) {
+            esyslog("ERROR: can't determine CPUs of NUMA node %d for device %d", Node, n + 1);
+            continue;
+            }
+         }
+      else
+         d->cpuAffinity = Cpus;
+      d->affinityNode = Node;
+      isyslog("device %d: CPU affinity %s (NUMA node %d)", n + 1, *d->cpuAffinity, Node);
+      }
+  free(Buffer);
+}
+
 uchar *cDevice::GrabImage(int &Size, bool Jpeg, int Quality, int SizeX, int SizeY)
 {
   return NULL;
@@ -910,6 +1092,7 @@ eSetChannelResult cDevice::SetChannel(const cChannel *Channel, bool LiveView)
      else
         Result = scrFailed;
      }
+  InvalidateDeviceSelection();
 
   if (Result == scrOk) {
      if (LiveView && IsPrimaryDevice()) {
@@ -951,8 +1134,10 @@ int cDevice::Occupied(void) const
 
 void cDevice::SetOccupied(int Seconds)
 {
-  if (Seconds >= 0)
+  if (Seconds >= 0) {
      occupiedTimeout = time(NULL) + min(Seconds, MAXOCCUPIEDTIMEOUT);
+     InvalidateDeviceSelection();
+     }
 }
 
 bool cDevice::SetChannelDevice(const cChannel *Channel, bool LiveView)
@@ -1346,6 +1531,7 @@ bool cDevice::AttachPlayer(cPlayer *Player)
      SetPlayMode(player->playMode);
      player->device = this;
      player->Activate(true);
+     InvalidateDeviceSelection();
      return true;
      }
   return false;
@@ -1367,6 +1553,7 @@ void cDevice::Detach(cPlayer *Player)
      patPmtParser.Reset();
      Audios.ClearAudio();
      isPlayingVideo = false;
+     InvalidateDeviceSelection();
      }
 }
 
@@ -1652,7 +1839,7 @@ int cDevice::Priority(void) const
      priority = TRANSFERPRIORITY; // we use the same value here, no matter whether it's actual Transfer Mode or real live viewing
   cMutexLock MutexLock(&mutexReceiver);
   for (int i = 0; i < MAXRECEIVERS; i++) {
-      if (receiver[i])
+      if (receiver[i] && !IsSectionReceiver(receiver[i]))
          priority = max(receiver[i]->priority, priority);
       }
   return priority;
@@ -1667,78 +1854,145 @@ bool cDevice::Receiving(bool Dummy) const
 {
   cMutexLock MutexLock(&mutexReceiver);
   for (int i = 0; i < MAXRECEIVERS; i++) {
-      if (receiver[i])
+      if (receiver[i] && !IsSectionReceiver(receiver[i]))
          return true;
       }
   return false;
 }
 
+bool cDevice::ReceiverStats(int Index, tChannelID &ChannelID, int &Priority, int &NumPids, uint64_t &NumPackets) const
+{
+  cMutexLock MutexLock(&mutexReceiver);
+  for (int i = 0; i < MAXRECEIVERS; i++) {
+      if (cReceiver *Receiver = receiver[i]) {
+         if (Index-- == 0) {
+            ChannelID = Receiver->channelID;
+            Priority = Receiver->priority;
+            NumPids = Receiver->numPids;
+            NumPackets = Receiver->numPackets;
+            return true;
+            }
+         }
+      }
+  return false;
+}
+
 #define TS_SCRAMBLING_TIMEOUT     3 // seconds to wait until a TS becomes unscrambled
 #define TS_SCRAMBLING_TIME_OK     3 // seconds before a Channel/CAM combination is marked as known to decrypt
 #define EIT_INJECTION_TIME       10 // seconds for which to inject EIT event
 
+#define MAXTSBATCH            128 // the maximum number of TS packets distributed to the receivers in one go
+#define DISPATCHSAMPLES       16 // only every n-th batch of TS packets is timed when collecting dispatch statistics
+#define DISPATCHSTATSINTERVAL 5000 // ms
+
+static uint64_t NanoSeconds(void)
+{
+  struct timespec tp;
+  if (clock_gettime(CLOCK_MONOTONIC, &tp) == 0)
+     return uint64_t(tp.tv_sec) * 1000000000 + tp.tv_nsec;
+  return 0;
+}
+
 void cDevice::Action(void)
 {
+  if (const char *CpuList = CpuAffinity())
+     SetCpuAffinity(CpuList);
   if (Running() && OpenDvr()) {
      while (Running()) {
            // Read data from the DVR device:
            uchar *b = NULL;
-           if (GetTSPacket(b)) {
-              if (b) {
-                 // Distribute the packet to all attached receivers:
+           int Count = MAXTSBATCH;
+           mutexCamSlot.Lock();
+           camSlotUser = ThreadId(); // SetCamSlot() waits until GetTSPackets() is done with the CAM slot
+           if (cCamSlot *cs = CamSlot())
+              Count = max(Count, cs->BatchSize()); // a CAM that decrypts in batches may want larger ones
+           mutexCamSlot.Unlock();
+           bool GotPackets = GetTSPackets(b, Count);
+           mutexCamSlot.Lock();
+           camSlotUser = 0;
+           camSlotReleases++;
+           camSlotIdle.Broadcast();
+           mutexCamSlot.Unlock();
+           if (GotPackets) {
+              if (b && Count > 0) {
+                 // Distribute the packets to all attached receivers:
                  Lock();
                  cCamSlot *cs = CamSlot();
-                 if (cs)
-                    cs->TsPostProcess(b);
-                 int Pid = TsPid(b);
-                 bool IsScrambled = TsIsScrambled(b);
-                 for (int i = 0; i < MAXRECEIVERS; i++) {
-                     cMutexLock MutexLock(&mutexReceiver);
-                     cReceiver *Receiver = receiver[i];
-                     if (Receiver && Receiver->WantsPid(Pid)) {
-                        Receiver->Receive(b, TS_SIZE);
-                        // Check whether the TS packet is scrambled:
-                        if (Receiver->startScrambleDetection) {
-                           if (cs) {
-                              int CamSlotNumber = cs->MasterSlotNumber();
-                              if (Receiver->lastScrambledPacket < Receiver->startScrambleDetection)
-                                 Receiver->lastScrambledPacket = Receiver->startScrambleDetection;
-                              time_t Now = time(NULL);
-                              if (IsScrambled) {
-                                 Receiver->lastScrambledPacket = Now;
-                                 if (Now - Receiver->startScrambleDetection > Receiver->scramblingTimeout) {
-                                    if (!cs->IsActivating() || Receiver->Priority() >= LIVEPRIORITY) {
-                                       if (Receiver->ChannelID().Valid()) {
-                                          dsyslog("CAM %d: won't decrypt channel %s, detaching receiver", CamSlotNumber, *Receiver->ChannelID().ToString());
-                                          ChannelCamRelations.SetChecked(Receiver->ChannelID(), CamSlotNumber);
-                                          }
-                                       Detach(Receiver);
-                                       }
-                                    }
-                                 }
-                              else if (Now - Receiver->lastScrambledPacket > TS_SCRAMBLING_TIME_OK) {
-                                 if (Receiver->ChannelID().Valid()) {
-                                    dsyslog("CAM %d: decrypts channel %s", CamSlotNumber, *Receiver->ChannelID().ToString());
-                                    ChannelCamRelations.SetDecrypt(Receiver->ChannelID(), CamSlotNumber);
-                                    }
-                                 Receiver->startScrambleDetection = 0;
-                                 }
-                              }
-                           }
-                        // Inject EIT event to avoid the CAMs parental rating prompt:
-                        if (Receiver->startEitInjection) {
-                           time_t Now = time(NULL);
-                           if (cCamSlot *cs = CamSlot()) {
-                              if (Now != Receiver->lastEitInjection) { // once per second
-                                 cs->InjectEit(Receiver->ChannelID().Sid());
-                                 Receiver->lastEitInjection = Now;
-                                 }
-                              }
-                           if (Now - Receiver->startEitInjection > EIT_INJECTION_TIME)
-                              Receiver->startEitInjection = 0;
-                           }
-                        }
+                 if (cs) {
+                    for (int i = 0; i < Count; i++)
+                        cs->TsPostProcess(b + i * TS_SIZE);
+                    }
+                 bool Timed = (dispatchBatches++ % DISPATCHSAMPLES) == 0;
+                 uint64_t DispatchStart = Timed ? NanoSeconds() : 0;
+                 packetCount += Count;
+                 mutexReceiver.Lock();
+                 for (int i = 0; i < Count; ) {
+                     // Consecutive packets that go to the same receivers are delivered in one go:
+                     uchar *Data = b + i * TS_SIZE;
+                     uint32_t Mask = receiverMask[TsPid(Data)];
+                     bool IsScrambled = TsIsScrambled(Data);
+                     int n = 1;
+                     for ( ; i + n < Count; n++) {
+                         const uchar *p = Data + n * TS_SIZE;
+                         if (receiverMask[TsPid(p)] != Mask)
+                            break;
+                         IsScrambled |= TsIsScrambled(p);
+                         }
+                     i += n;
+                     for ( ; Mask; Mask &= Mask - 1) {
+                         cReceiver *Receiver = receiver[ffs(Mask) - 1];
+                         if (Receiver) {
+                            Receiver->numPackets += n;
+                            if (n == 1)
+                               Receiver->Receive(Data, TS_SIZE);
+                            else
+                               Receiver->ReceiveBatch(Data, n);
+                            // Check whether the TS packets are scrambled:
+                            if (Receiver->startScrambleDetection) {
+                               if (cs) {
+                                  int CamSlotNumber = cs->MasterSlotNumber();
+                                  if (Receiver->lastScrambledPacket < Receiver->startScrambleDetection)
+                                     Receiver->lastScrambledPacket = Receiver->startScrambleDetection;
+                                  time_t Now = time(NULL);
+                                  if (IsScrambled) {
+                                     Receiver->lastScrambledPacket = Now;
+                                     if (Now - Receiver->startScrambleDetection > Receiver->scramblingTimeout) {
+                                        if (!cs->IsActivating() || Receiver->Priority() >= LIVEPRIORITY) {
+                                           if (Receiver->ChannelID().Valid()) {
+                                              dsyslog("CAM %d: won't decrypt channel %s, detaching receiver", CamSlotNumber, *Receiver->ChannelID().ToString());
+                                              ChannelCamRelations.SetChecked(Receiver->ChannelID(), CamSlotNumber);
+                                              }
+                                           Detach(Receiver);
+                                           }
+                                        }
+                                     }
+                                  else if (Now - Receiver->lastScrambledPacket > TS_SCRAMBLING_TIME_OK) {
+                                     if (Receiver->ChannelID().Valid()) {
+                                        dsyslog("CAM %d: decrypts channel %s", CamSlotNumber, *Receiver->ChannelID().ToString());
+                                        ChannelCamRelations.SetDecrypt(Receiver->ChannelID(), CamSlotNumber);
+                                        }
+                                     Receiver->startScrambleDetection = 0;
+                                     }
+                                  }
+                               }
+                            // Inject EIT event to avoid the CAMs parental rating prompt:
+                            if (Receiver->startEitInjection) {
+                               time_t Now = time(NULL);
+                               if (cCamSlot *cs = CamSlot()) {
+                                  if (Now != Receiver->lastEitInjection) { // once per second
+                                     cs->InjectEit(Receiver->ChannelID().Sid());
+                                     Receiver->lastEitInjection = Now;
+                                     }
+                                  }
+                               if (Now - Receiver->startEitInjection > EIT_INJECTION_TIME)
+                                  Receiver->startEitInjection = 0;
+                               }
+                            }
+                         }
                      }
+                 mutexReceiver.Unlock();
+                 if (Timed)
+                    DispatchStats(NanoSeconds() - DispatchStart, Count);
                  Unlock();
                  }
               }
@@ -1746,6 +2000,23 @@ void cDevice::Action(void)
               break;
            }
      CloseDvr();
+     packetRate = 0;
+     dispatchTime = 0;
+     }
+}
+
+void cDevice::DispatchStats(uint64_t DispatchTime, int Packets)
+{
+  dispatchTimeSum += DispatchTime;
+  dispatchSamples += Packets;
+  uint64_t Elapsed = dispatchStatsTimer.Elapsed();
+  if (Elapsed >= DISPATCHSTATSINTERVAL) {
+     packetRate = packetCount * 1000LL / Elapsed;
+     dispatchTime = dispatchTimeSum / dispatchSamples;
+     packetCount = 0;
+     dispatchSamples = 0;
+     dispatchTimeSum = 0;
+     dispatchStatsTimer.Set();
      }
 }
 
@@ -1763,6 +2034,15 @@ bool cDevice::GetTSPacket(uchar *&Data)
   return false;
 }
 
+bool cDevice::GetTSPackets(uchar *&Data, int &Count)
+{
+  if (GetTSPacket(Data)) {
+     Count = Data ? 1 : 0;
+     return true;
+     }
+  return false;
+}
+
 bool cDevice::AttachReceiver(cReceiver *Receiver)
 {
   if (!Receiver)
@@ -1791,6 +2071,8 @@ bool cDevice::AttachReceiver(cReceiver *Receiver)
          Receiver->Activate(true);
          Receiver->device = this;
          receiver[i] = Receiver;
+         SetReceiverMask(i);
+         InvalidateDeviceSelection();
          if (camSlot && Receiver->priority > MINPRIORITY) { // priority check to avoid an infinite loop with the CAM slot's caPidReceiver
             camSlot->StartDecrypting();
             if (camSlot->WantsTsData()) {
@@ -1822,12 +2104,15 @@ void cDevice::Detach(cReceiver *Receiver)
   bool receiversLeft = false;
   mutexReceiver.Lock();
   for (int i = 0; i < MAXRECEIVERS; i++) {
-      if (receiver[i] == Receiver)
+      if (receiver[i] == Receiver) {
          receiver[i] = NULL;
+         SetReceiverMask(i);
+         }
       else if (receiver[i])
          receiversLeft = true;
       }
   mutexReceiver.Unlock();
+  InvalidateDeviceSelection();
   Receiver->device = NULL;
   Receiver->Activate(false);
   for (int n = 0; n < Receiver->numPids; n++)
@@ -1843,6 +2128,31 @@ void cDevice::Detach(cReceiver *Receiver)
      Cancel(-1);
 }
 
+void cDevice::SetReceiverMask(int Index)
+{
+  uint32_t Bit = 1 << Index;
+  for (int Pid = 0; Pid < MAXPID; Pid++)
+      receiverMask[Pid] &= ~Bit;
+  if (cReceiver *Receiver = receiver[Index]) {
+     for (int n = 0; n < Receiver->numPids; n++) {
+         int Pid = Receiver->pids[n];
+         if (0 < Pid && Pid < MAXPID)
+            receiverMask[Pid] |= Bit;
+         }
+     }
+}
+
+void cDevice::ReceiverPidsChanged(cReceiver *Receiver)
+{
+  cMutexLock MutexLock(&mutexReceiver);
+  for (int i = 0; i < MAXRECEIVERS; i++) {
+      if (receiver[i] == Receiver) {
+         SetReceiverMask(i);
+         break;
+         }
+      }
+}
+
 void cDevice::DetachAll(int Pid)
 {
   if (Pid) {
@@ -1864,15 +2174,22 @@ void cDevice::DetachAllReceivers(void)
 
 // --- cTSBuffer -------------------------------------------------------------
 
-cTSBuffer::cTSBuffer(int File, int Size, int DeviceNumber)
+cTSBuffer::cTSBuffer(int File, int Size, int DeviceNumber, const char *CpuAffinity, int NumaNode)
 {
   SetDescription("device %d TS buffer", DeviceNumber);
   f = File;
   deviceNumber = DeviceNumber;
   delivered = 0;
+  bufferSize = Size;
+  bytesRead = 0;
+  driverOverflows = 0;
   ringBuffer = new cRingBufferLinear(Size, TS_SIZE, true, "TS");
   ringBuffer->SetTimeouts(100, 100);
   ringBuffer->SetIoThrottle();
+  ringBuffer->SetSingleProducerConsumer();
+  if (Setup.TSBufferHugePages)
+     ringBuffer->SetHugePages(NumaNode);
+  cpuAffinity = CpuAffinity;
   Start();
 }
 
@@ -1884,6 +2201,8 @@ cTSBuffer::~cTSBuffer()
 
 void cTSBuffer::Action(void)
 {
+  if (*cpuAffinity)
+     SetCpuAffinity(cpuAffinity);
   if (ringBuffer) {
      bool firstRead = true;
      cPoller Poller(f);
@@ -1891,9 +2210,13 @@ void cTSBuffer::Action(void)
            if (firstRead || Poller.Poll(100)) {
               firstRead = false;
               int r = ringBuffer->Read(f);
-              if (r < 0 && FATALERRNO) {
-                 if (errno == EOVERFLOW)
+              if (r > 0)
+                 bytesRead += r;
+              else if (r < 0 && FATALERRNO) {
+                 if (errno == EOVERFLOW) {
                     esyslog("ERROR: driver buffer overflow on device %d", deviceNumber);
+                    driverOverflows++;
+                    }
                  else {
                     LOG_ERROR;
                     break;
@@ -1935,6 +2258,21 @@ uchar *cTSBuffer::Get(int *Available, bool CheckAvailable)
   return NULL;
 }
 
+uchar *cTSBuffer::GetPackets(int &Count)
+{
+  int Available;
+  if (uchar *p = Get(&Available)) {
+     int n = 1;
+     for (int Max = min(Count, Available / TS_SIZE); n < Max && p[n * TS_SIZE] == TS_SYNC_BYTE; n++)
+         ;
+     delivered = n * TS_SIZE;
+     Count = n;
+     return p;
+     }
+  Count = 0;
+  return NULL;
+}
+
 void cTSBuffer::Skip(int Count)
 {
   delivered = Count;
@@ -28,7 +28,7 @@
 
 #define MAXDEVICES         16 // the maximum number of devices in the system
 #define MAXPIDHANDLES      64 // the maximum number of different PIDs per device
-#define MAXRECEIVERS       16 // the maximum number of receivers per device
+#define MAXRECEIVERS       16 // the maximum number of receivers per device (at most 32, see cDevice::receiverMask)
 #define MAXVOLUME         255
 #define VOLUMEDELTA       (MAXVOLUME / Setup.VolumeSteps) // used to increase/decrease the volume
 #define MAXOCCUPIEDTIMEOUT 99 // max. time (in seconds) a device may be occupied
@@ -125,6 +125,9 @@ private:
   static int useDevice;
   static cDevice *device[MAXDEVICES];
   static cDevice *primaryDevice;
+  static cDevice *SelectDevice(const cChannel *Channel, int Priority, bool LiveView, cCamSlot *&CamSlot, bool &NeedsDetachReceivers);
+         ///< Selects the device and CAM slot GetDevice() shall use for the given
+         ///< Channel, without making any CAM assignments or receiver detachments.
 public:
   static int NumDevices(void) { return numDevices; }
          ///< Returns the total number of devices.
@@ -173,6 +176,13 @@ public:
          ///< in order to just determine whether a device is available for the given
          ///< Channel.
          ///< See also ProvidesChannel().
+  static void InvalidateDeviceSelection(void);
+         ///< Tells GetDevice() that the state of the devices or CAM slots has changed
+         ///< (a device has been tuned, receivers have been attached or detached, a CAM
+         ///< has been assigned etc.). GetDevice() keeps the results of its selections
+         ///< for a short while, so that repeated calls for the same channel don't have
+         ///< to check all combinations of devices and CAM slots again, as long as
+         ///< nothing has changed.
   static cDevice *GetDeviceForTransponder(const cChannel *Channel, int Priority);
          ///< Returns a device that is not currently "occupied" and can be tuned to
          ///< the transponder of the given Channel, without disturbing any receiver
@@ -181,9 +191,20 @@ public:
   static void Shutdown(void);
          ///< Closes down all devices.
          ///< Must be called at the end of the program.
+  static void SetCpuAffinities(const char *Affinities);
+         ///< Sets the CPUs the TS buffer and receiver threads of the devices shall
+         ///< run on. Affinities is a blank separated list of "<device>:<cpus>"
+         ///< entries (as in "1:auto 2:node1 3:0-3,8"), where <device> is the device
+         ///< number (1...) and <cpus> is either a list of CPUs, "node<n>" for the
+         ///< CPUs of NUMA node n, or "auto" for the CPUs of the NUMA node the
+         ///< device's hardware is attached to. In the latter two cases, a device's
+         ///< TS buffer is allocated on that node, too.
+         ///< Takes effect whenever a device's threads are (re)started.
 private:
   static int nextCardIndex;
   int cardIndex;
+  cString cpuAffinity;
+  int affinityNode;
 protected:
   cDevice(void);
   virtual ~cDevice();
@@ -236,6 +257,15 @@ public:
   virtual bool AvoidRecording(void) const { return false; }
          ///< Returns true if this device should only be used for recording
          ///< if no other device is available.
+  virtual int NumaNode(void) const { return -1; }
+         ///< Returns the NUMA node the hardware of this device is attached to,
+         ///< or -1 if this is unknown.
+  const char *CpuAffinity(void) const { return *cpuAffinity ? *cpuAffinity : NULL; }
+         ///< Returns the list of CPUs this device's threads shall run on, or NULL
+         ///< if there is no such restriction (see SetCpuAffinities()).
+  int AffinityNode(void) const { return affinityNode; }
+         ///< Returns the NUMA node this device's TS buffer shall be allocated on,
+         ///< or -1 if there is no such restriction (see SetCpuAffinities()).
 
 // Device hooks
 
@@ -459,12 +489,17 @@ public:
   void Detach(cFilter *Filter);
        ///< Detaches the given filter from this device.
   const cSdtFilter *SdtFilter(void) const { return sdtFilter; }
+  cEitFilter *EitFilter(void) const { return eitFilter; }
   cSectionHandler *SectionHandler(void) const { return sectionHandler; }
 
 // Common Interface facilities:
 
 private:
   cCamSlot *camSlot;
+  cMutex mutexCamSlot;
+  cCondVar camSlotIdle;
+  tThreadId camSlotUser;
+  int camSlotReleases;
 public:
   virtual bool HasCi(void);
          ///< Returns true if this device has a Common Interface.
@@ -476,6 +511,9 @@ public:
          ///< shall check whether the channel can be decrypted.
   void SetCamSlot(cCamSlot *CamSlot);
          ///< Sets the given CamSlot to be used with this device.
+         ///< If the device thread is currently in GetTSPackets(), this function
+         ///< waits until it has returned, so that the previous CAM slot is no
+         ///< longer used by the device thread once this function returns.
   cCamSlot *CamSlot(void) const { return camSlot; }
          ///< Returns the CAM slot that is currently used with this device,
          ///< or NULL if no CAM slot is in use.
@@ -830,6 +868,24 @@ public:
 private:
   mutable cMutex mutexReceiver;
   cReceiver *receiver[MAXRECEIVERS];
+  uint32_t receiverMask[MAXPID]; // bit i is set if receiver[i] wants this PID
+  int packetCount;
+  int dispatchBatches;
+  int dispatchSamples;
+  uint64_t dispatchTimeSum;
+  int packetRate;
+  int dispatchTime;
+  cTimeMs dispatchStatsTimer;
+  void SetReceiverMask(int Index);
+       ///< Updates the PID dispatch table for the receiver in slot Index.
+       ///< mutexReceiver must be locked when calling this function.
+  void ReceiverPidsChanged(cReceiver *Receiver);
+       ///< Tells the device that the PIDs of the given (attached) Receiver
+       ///< have changed.
+  void DispatchStats(uint64_t DispatchTime, int Packets);
+  bool IsSectionReceiver(const cReceiver *Receiver) const { return sectionHandler && sectionHandler->Receiver() == Receiver; }
+       ///< Returns true if Receiver only gets the TS packets for the section handler.
+       ///< Such a receiver doesn't count as a receiving session of this device.
 public:
   int Priority(void) const;
       ///< Returns the priority of the current receiving session (-MAXPRIORITY..MAXPRIORITY),
@@ -847,6 +903,17 @@ protected:
       ///< new data available, Data will be set to NULL. The function returns
       ///< false in case of a non recoverable error, otherwise it returns true,
       ///< even if Data is NULL.
+  virtual bool GetTSPackets(uchar *&Data, int &Count);
+      ///< Gets at most Count consecutive TS packets from the DVR of this device
+      ///< and returns a pointer to the first one in Data. Upon return, Count
+      ///< contains the number of TS packets (each TS_SIZE bytes long and starting
+      ///< with a TS_SYNC_BYTE) that Data points to. If there is currently no new
+      ///< data available, Data will be set to NULL and Count to 0. The return value
+      ///< has the same meaning as for GetTSPacket().
+      ///< The default implementation calls GetTSPacket() and thus always delivers
+      ///< at most one TS packet. A derived device that buffers the data it reads
+      ///< from the driver can reimplement this function to allow the receivers to
+      ///< be handed larger blocks of data at once.
 public:
   bool Receiving(bool Dummy = false) const;
        ///< Returns true if we are currently receiving. The parameter has no meaning (for backwards compatibility only).
@@ -858,6 +925,22 @@ public:
        ///< Detaches all receivers from this device for this pid.
   virtual void DetachAllReceivers(void);
        ///< Detaches all receivers from this device.
+  int ReceiverPacketRate(void) const { return packetRate; }
+       ///< Returns the number of TS packets per second this device has recently
+       ///< distributed to its attached receivers.
+  int ReceiverDispatchTime(void) const { return dispatchTime; }
+       ///< Returns the average time (in nanoseconds) this device has recently
+       ///< spent distributing a single TS packet to its attached receivers.
+  virtual bool TSBufferStats(uint64_t &BytesRead, int &DriverOverflows, int &BufferSize, int &BufferMaxFill) { return false; }
+       ///< Returns statistics about the cTSBuffer this device reads its TS packets
+       ///< through: the number of bytes read so far, the number of buffer overflows
+       ///< reported by the driver, and the size and high water mark of the buffer
+       ///< (in bytes). Returns false if the device currently has no such buffer.
+  bool ReceiverStats(int Index, tChannelID &ChannelID, int &Priority, int &NumPids, uint64_t &NumPackets) const;
+       ///< Returns statistics about the Index'th receiver (counting from 0) that is
+       ///< currently attached to this device: the channel and priority it has been
+       ///< created with, the number of PIDs it receives and the number of TS packets
+       ///< it has been given so far. Returns false if there is no such receiver.
   };
 
 /// Derived cDevice classes that can receive channels will have to provide
@@ -873,10 +956,18 @@ private:
   int f;
   int deviceNumber;
   int delivered;
+  int bufferSize;
+  uint64_t bytesRead;
+  int driverOverflows;
+  cString cpuAffinity;
   cRingBufferLinear *ringBuffer;
   virtual void Action(void);
 public:
-  cTSBuffer(int File, int Size, int DeviceNumber);
+  cTSBuffer(int File, int Size, int DeviceNumber, const char *CpuAffinity = NULL, int NumaNode = -1);
+     ///< Creates a TS buffer of Size bytes that reads from File. If CpuAffinity
+     ///< is given, the reading thread runs on these CPUs only (see
+     ///< cThread::SetCpuAffinity()). If Setup.TSBufferHugePages is set, the
+     ///< buffer is backed by huge pages, bound to NumaNode (if not negative).
   virtual ~cTSBuffer();
   uchar *Get(int *Available = NULL, bool CheckAvailable = false);
      ///< Returns a pointer to the first TS packet in the buffer. If Available is given,
@@ -896,6 +987,20 @@ public:
      ///< in Get() and skip the given number of bytes instead. Count may be 0 if the
      ///< caller wants the previous TS packet to be delivered again in the next call
      ///< to Get().
+  uchar *GetPackets(int &Count);
+     ///< Like Get(), but returns a pointer to a run of at most Count consecutive
+     ///< TS packets in the buffer, each of which starts with a TS_SYNC_BYTE.
+     ///< Upon return, Count contains the actual number of TS packets Data points to
+     ///< (or 0, if NULL is returned). The next call to Get() or GetPackets() will
+     ///< continue with the TS packet following this run.
+  uint64_t BytesRead(void) const { return bytesRead; }
+     ///< Returns the number of bytes read from the device so far.
+  int DriverOverflows(void) const { return driverOverflows; }
+     ///< Returns the number of times the driver reported a buffer overflow.
+  int BufferSize(void) const { return bufferSize; }
+     ///< Returns the size of this TS buffer (in bytes).
+  int BufferMaxFill(void) const { return ringBuffer->MaxFill(); }
+     ///< Returns the highest number of bytes that have been stored in this TS buffer.
   };
 
 #endif //__DEVICE_H
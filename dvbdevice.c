@@ -33,6 +33,7 @@ static int DvbApiVersion = 0x0000; // the version of the DVB driver actually in
 #define ATSC_LOCK_TIMEOUT  2000 //ms
 
 #define SCR_RANDOM_TIMEOUT  500 // ms (add random value up to this when tuning SCR device to avoid lockups)
+#define DECRYPT_WAIT         10 // ms to wait for a CAM that decrypts TS packets asynchronously
 
 // --- DVB Parameter Maps ----------------------------------------------------
 
@@ -1929,6 +1930,18 @@ cString cDvbDevice::DeviceName(void) const
   return "";
 }
 
+int cDvbDevice::NumaNode(void) const
+{
+  int Node = -1;
+  if (FILE *f = fopen(cString::sprintf("/sys/class/dvb/dvb%d.frontend%d/device/numa_node", adapter, frontend), "r")) {
+     cReadLine ReadLine;
+     if (char *s = ReadLine.Read(f))
+        Node = strtol(s, NULL, 10);
+     fclose(f);
+     }
+  return Node;
+}
+
 bool cDvbDevice::Initialize(void)
 {
   new cDvbSourceParam('A', "ATSC");
@@ -2310,14 +2323,21 @@ bool cDvbDevice::OpenDvr(void)
 {
   CloseDvr();
   fd_dvr = DvbOpen(DEV_DVB_DVR, adapter, frontend, O_RDONLY | O_NONBLOCK, true);
-  if (fd_dvr >= 0)
-     tsBuffer = new cTSBuffer(fd_dvr, MEGABYTE(5), DeviceNumber() + 1);
+  if (fd_dvr >= 0) {
+     cMutexLock MutexLock(&tsBufferMutex);
+     tsBuffer = new cTSBuffer(fd_dvr, MEGABYTE(5), DeviceNumber() + 1, CpuAffinity(), AffinityNode());
+     }
   return fd_dvr >= 0;
 }
 
 void cDvbDevice::CloseDvr(void)
 {
   if (fd_dvr >= 0) {
+     cMutexLock MutexLock(&tsBufferMutex);
+     if (cCamSlot *cs = CamSlot()) {
+        if (cs->BatchSize())
+           cs->DecryptPackets(NULL, 0, NULL); // the CAM must let go of the packets in the TS buffer
+        }
      delete tsBuffer;
      tsBuffer = NULL;
      close(fd_dvr);
@@ -2325,6 +2345,19 @@ void cDvbDevice::CloseDvr(void)
      }
 }
 
+bool cDvbDevice::TSBufferStats(uint64_t &BytesRead, int &DriverOverflows, int &BufferSize, int &BufferMaxFill)
+{
+  cMutexLock MutexLock(&tsBufferMutex);
+  if (tsBuffer) {
+     BytesRead = tsBuffer->BytesRead();
+     DriverOverflows = tsBuffer->DriverOverflows();
+     BufferSize = tsBuffer->BufferSize();
+     BufferMaxFill = tsBuffer->BufferMaxFill();
+     return true;
+     }
+  return false;
+}
+
 bool cDvbDevice::GetTSPacket(uchar *&Data)
 {
   if (tsBuffer) {
@@ -2346,6 +2379,40 @@ bool cDvbDevice::GetTSPacket(uchar *&Data)
   return false;
 }
 
+bool cDvbDevice::GetTSPackets(uchar *&Data, int &Count)
+{
+  if (tsBuffer) {
+     if (cCamSlot *cs = CamSlot()) {
+        if (cs->WantsTsData()) {
+           if (int BatchSize = cs->BatchSize()) {
+              // the CAM decrypts whole batches of TS packets in place:
+              Count = min(Count, BatchSize);
+              if ((Data = tsBuffer->GetPackets(Count)) != NULL) {
+                 uchar Parity[Count];
+                 for (int i = 0; i < Count; i++)
+                     Parity[i] = (Data[i * TS_SIZE + 3] & TS_SCRAMBLING_CONTROL) >> 6;
+                 Count = cs->DecryptPackets(Data, Count, Parity);
+                 tsBuffer->Skip(Count * TS_SIZE); // the rest stays in the buffer until the CAM is done with it
+                 if (!Count) {
+                    Data = NULL;
+                    cs->WaitDecrypted(DECRYPT_WAIT);
+                    }
+                 }
+              return true;
+              }
+           // the CAM's Decrypt() function handles one TS packet at a time:
+           if (!GetTSPacket(Data))
+              return false;
+           Count = Data ? 1 : 0;
+           return true;
+           }
+        }
+     Data = tsBuffer->GetPackets(Count);
+     return true;
+     }
+  return false;
+}
+
 void cDvbDevice::DetachAllReceivers(void)
 {
   cMutexLock MutexLock(&bondMutex);
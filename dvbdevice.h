@@ -193,6 +193,7 @@ public:
   int Frontend(void) const;
   virtual cString DeviceType(void) const;
   virtual cString DeviceName(void) const;
+  virtual int NumaNode(void) const;
   static bool BondDevices(const char *Bondings);
        ///< Bonds the devices as defined in the given Bondings string.
        ///< A bonding is a sequence of device numbers (starting at 1),
@@ -281,11 +282,15 @@ public:
 
 private:
   cTSBuffer *tsBuffer;
+  cMutex tsBufferMutex;
 protected:
   virtual bool OpenDvr(void);
   virtual void CloseDvr(void);
   virtual bool GetTSPacket(uchar *&Data);
+  virtual bool GetTSPackets(uchar *&Data, int &Count);
   virtual void DetachAllReceivers(void);
+public:
+  virtual bool TSBufferStats(uint64_t &BytesRead, int &DriverOverflows, int &BufferSize, int &BufferMaxFill);
   };
 
 // A plugin that implements a DVB device derived from cDvbDevice needs to create
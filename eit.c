@@ -22,60 +22,271 @@
 
 #define DBGEIT 0
 
-// --- cEIT ------------------------------------------------------------------
+// --- cSectionSyncerHash ----------------------------------------------------
 
-class cEIT : public SI::EIT {
+cSectionSyncerEntry *cSectionSyncerHash::GetEntry(int Tid, int ServiceId)
+{
+  cSectionSyncerEntry *Entry = Get(Tid * ServiceId);
+  if (!Entry) {
+     Entry = new cSectionSyncerEntry;
+     Add(Entry, Tid * ServiceId);
+     numTables++;
+     lastNewTable.Set();
+     }
+  return Entry;
+}
+
+bool cSectionSyncerHash::Sync(int Tid, int ServiceId, int LastTid, uchar Version, int Number, int LastNumber)
+{
+  if (Tid >= 0x50 && (LastTid & 0xF0) == (Tid & 0xF0)) {
+     for (int t = Tid & 0xF0; t <= LastTid; t++) // the schedule tables of this service that will follow
+         GetEntry(t, ServiceId);
+     }
+  cSectionSyncerEntry *Entry = GetEntry(Tid, ServiceId);
+  bool WasComplete = Entry->Complete();
+  bool Result = Entry->Sync(Version, Number, LastNumber);
+  numComplete += Entry->Complete() - WasComplete;
+  return Result;
+}
+
+bool cSectionSyncerHash::Seen(int Tid, int ServiceId, uchar Version, int Number)
+{
+  cSectionSyncerEntry *Entry = Get(Tid * ServiceId);
+  return Entry && !Entry->Check(Version, Number);
+}
+
+void cSectionSyncerHash::Clear(void)
+{
+  cHash::Clear();
+  numTables = numComplete = 0;
+  lastNewTable.Set();
+}
+
+bool cSectionSyncerHash::Complete(int SettleTime)
+{
+  return numTables > 0 && numComplete == numTables && lastNewTable.Elapsed() >= uint64_t(SettleTime);
+}
+
+// --- cEitSection -----------------------------------------------------------
+
+class cEitSection {
+private:
+  uchar *data;
+  u_char tid;
+  int serviceId;
+  int lastTid;
+  uchar version;
+  int number;
+  int lastNumber;
+  bool process;
+  bool decoded;
+  cVector<char *> texts; // title, short text and description of each event
+  void DecodeTexts(SI::EIT::Event &SiEitEvent);
+  const char *Text(int Event, int Index) const { return Event * 3 + Index < texts.Size() ? texts[Event * 3 + Index] : NULL; }
 public:
-  cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const u_char *Data);
+  cEitSection(uchar *Data);
+       ///< Takes ownership of the given section Data.
+  ~cEitSection();
+  bool Decode(cSectionSyncerHash *SectionSyncerHash, cMutex &Mutex);
+       ///< Checks the CRC of this section and converts the texts of its events,
+       ///< unless the given SectionSyncerHash (which is protected by Mutex) has
+       ///< already seen it. The state of the syncers is not changed. Returns false
+       ///< if this section is invalid.
+  bool Sync(cSectionSyncerHash *SectionSyncerHash);
+       ///< Synchronizes this section with the given SectionSyncerHash (if it is
+       ///< NULL, the section is always processed). Returns false if this section
+       ///< shall not be applied.
+  void DecodeTexts(void);
+       ///< Converts the texts of the events of this section, unless this has
+       ///< already been done.
+  const uchar *Data(void) const { return data; }
+  bool Process(void) const { return process; }
+       ///< Returns true if the events of this section are new, false if the
+       ///< section is only needed to watch the running status.
+  const char *Title(int Event) const { return Text(Event, 0); }
+  const char *ShortText(int Event) const { return Text(Event, 1); }
+  const char *Description(int Event) const { return Text(Event, 2); }
+       ///< Return the texts of the given Event (counted in the order of the
+       ///< section's event loop), or NULL if there are none.
   };
 
-cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const u_char *Data)
-:SI::EIT(Data, false)
+cEitSection::cEitSection(uchar *Data)
+{
+  data = Data;
+  tid = 0;
+  serviceId = 0;
+  lastTid = 0;
+  version = 0;
+  number = 0;
+  lastNumber = 0;
+  process = false;
+  decoded = false;
+}
+
+cEitSection::~cEitSection()
+{
+  for (int i = 0; i < texts.Size(); i++)
+      free(texts[i]);
+  free(data);
+}
+
+bool cEitSection::Decode(cSectionSyncerHash *SectionSyncerHash, cMutex &Mutex)
+{
+  SI::EIT Eit(data, false);
+  if (!Eit.CheckCRCAndParse())
+     return false;
+  tid = Eit.getTableId();
+  serviceId = Eit.getServiceId();
+  lastTid = Eit.getLastTableId();
+  version = Eit.getVersionNumber();
+  number = Eit.getSectionNumber();
+  lastNumber = Eit.getLastSectionNumber();
+  if (SectionSyncerHash) {
+     cMutexLock MutexLock(&Mutex);
+     if (SectionSyncerHash->Seen(tid, serviceId, version, number))
+        return true; // the texts are converted later if they are needed after all
+     }
+  DecodeTexts();
+  return true;
+}
+
+bool cEitSection::Sync(cSectionSyncerHash *SectionSyncerHash)
+{
+  process = SectionSyncerHash ? SectionSyncerHash->Sync(tid, serviceId, lastTid, version, number, lastNumber) : true;
+  if (tid != 0x4E && !process) // we need to set the 'seen' tag to watch the running status of the present/following event
+     return false;
+  return true;
+}
+
+void cEitSection::DecodeTexts(void)
 {
-  if (!CheckCRCAndParse())
+  if (decoded)
      return;
-  int HashId = Tid * getServiceId();
-  cSectionSyncerEntry *SectionSyncerEntry = SectionSyncerHash.Get(HashId);
-  if (!SectionSyncerEntry) {
-     SectionSyncerEntry = new cSectionSyncerEntry;
-     SectionSyncerHash.Add(SectionSyncerEntry, HashId);
+  SI::EIT Eit(data, false);
+  Eit.CheckParse();
+  SI::EIT::Event SiEitEvent;
+  for (SI::Loop::Iterator it; Eit.eventLoop.getNext(SiEitEvent, it); )
+      DecodeTexts(SiEitEvent);
+  decoded = true;
+}
+
+void cEitSection::DecodeTexts(SI::EIT::Event &SiEitEvent)
+{
+  int LanguagePreferenceShort = -1;
+  int LanguagePreferenceExt = -1;
+  bool UseExtendedEventDescriptor = false;
+  SI::Descriptor *d;
+  SI::ExtendedEventDescriptors *ExtendedEventDescriptors = NULL;
+  SI::ShortEventDescriptor *ShortEventDescriptor = NULL;
+  for (SI::Loop::Iterator it; (d = SiEitEvent.eventDescriptors.getNext(it)); ) {
+      switch (d->getDescriptorTag()) {
+        case SI::ExtendedEventDescriptorTag: {
+             SI::ExtendedEventDescriptor *eed = (SI::ExtendedEventDescriptor *)d;
+             if (I18nIsPreferredLanguage(Setup.EPGLanguages, eed->languageCode, LanguagePreferenceExt) || !ExtendedEventDescriptors) {
+                delete ExtendedEventDescriptors;
+                ExtendedEventDescriptors = new SI::ExtendedEventDescriptors;
+                UseExtendedEventDescriptor = true;
+                }
+             if (UseExtendedEventDescriptor) {
+                if (ExtendedEventDescriptors->Add(eed))
+                   d = NULL; // so that it is not deleted
+                }
+             if (eed->getDescriptorNumber() == eed->getLastDescriptorNumber())
+                UseExtendedEventDescriptor = false;
+             }
+             break;
+        case SI::ShortEventDescriptorTag: {
+             SI::ShortEventDescriptor *sed = (SI::ShortEventDescriptor *)d;
+             if (I18nIsPreferredLanguage(Setup.EPGLanguages, sed->languageCode, LanguagePreferenceShort) || !ShortEventDescriptor) {
+                delete ShortEventDescriptor;
+                ShortEventDescriptor = sed;
+                d = NULL; // so that it is not deleted
+                }
+             }
+             break;
+        default: ;
+        }
+      delete d;
+      }
+  if (ShortEventDescriptor) {
+     char buffer[Utf8BufSize(256)];
+     texts.Append(strdup(ShortEventDescriptor->name.getText(buffer, sizeof(buffer))));
+     texts.Append(strdup(ShortEventDescriptor->text.getText(buffer, sizeof(buffer))));
+     }
+  else {
+     texts.Append(NULL);
+     texts.Append(NULL);
      }
-  bool Process = SectionSyncerEntry->Sync(getVersionNumber(), getSectionNumber(), getLastSectionNumber());
-  if (Tid != 0x4E && !Process) // we need to set the 'seen' tag to watch the running status of the present/following event
+  if (ExtendedEventDescriptors) {
+     char buffer[Utf8BufSize(ExtendedEventDescriptors->getMaximumTextLength(": ")) + 1];
+     texts.Append(strdup(ExtendedEventDescriptors->getText(buffer, sizeof(buffer), ": ")));
+     }
+  else
+     texts.Append(NULL);
+  delete ExtendedEventDescriptors;
+  delete ShortEventDescriptor;
+}
+
+// --- cEitBatch -------------------------------------------------------------
+
+class cEitBatch : public cListObject {
+  friend class cEitFilter;
+private:
+  int source;
+  bool retired;
+  cVector<uchar *> sections;             // received, but not yet decoded (protected by the filter's mutex)
+  cVector<cEitSection *> decodedSections; // only accessed by whoever is currently doing the filter's Work()
+  int unapplied;                         // number of sections received and not yet applied (protected by the filter's mutex)
+  int taken;                             // number of sections taken by DecodeSections() and not yet applied (like decodedSections)
+public:
+  cEitBatch(int Source);
+  virtual ~cEitBatch();
+  };
+
+cEitBatch::cEitBatch(int Source)
+{
+  source = Source;
+  retired = false;
+  unapplied = 0;
+  taken = 0;
+}
+
+cEitBatch::~cEitBatch()
+{
+  for (int i = 0; i < sections.Size(); i++)
+      free(sections[i]);
+  for (int i = 0; i < decodedSections.Size(); i++)
+      delete decodedSections[i];
+}
+
+// --- cEIT ------------------------------------------------------------------
+
+class cEIT : public SI::EIT {
+public:
+  cEIT(const cEitSection &Section, int Source, cChannels *Channels, cSchedules *Schedules, bool &ChannelsModified, bool &SchedulesModified);
+  };
+
+cEIT::cEIT(const cEitSection &Section, int Source, cChannels *Channels, cSchedules *Schedules, bool &ChannelsModified, bool &SchedulesModified)
+:SI::EIT(Section.Data(), false)
+{
+  CheckParse(); // the CRC has already been checked by cEitSection::Decode()
+  if (!isValid())
      return;
+  u_char Tid = getTableId();
+  bool Process = Section.Process();
 
   time_t Now = time(NULL);
   if (Now < VALID_TIME)
      return; // we need the current time for handling PDC descriptors
 
-  cStateKey ChannelsStateKey;
-  cChannels *Channels = cChannels::GetChannelsWrite(ChannelsStateKey, 10);
-  if (!Channels) {
-     SectionSyncerEntry->Repeat(); // let's not miss any section of the EIT
-     return;
-     }
   tChannelID channelID(Source, getOriginalNetworkId(), getTransportStreamId(), getServiceId());
   cChannel *Channel = Channels->GetByChannelID(channelID, true);
-  if (!Channel || EpgHandlers.IgnoreChannel(Channel)) {
-     ChannelsStateKey.Remove(false);
+  if (!Channel || EpgHandlers.IgnoreChannel(Channel))
      return;
-     }
 
-  cStateKey SchedulesStateKey;
-  cSchedules *Schedules = cSchedules::GetSchedulesWrite(SchedulesStateKey, 10);
-  if (!Schedules) {
-     SectionSyncerEntry->Repeat(); // let's not miss any section of the EIT
-     ChannelsStateKey.Remove(false);
+  if (!EpgHandlers.BeginSegmentTransfer(Channel))
      return;
-     }
 
-  if (!EpgHandlers.BeginSegmentTransfer(Channel)) {
-     SchedulesStateKey.Remove(false);
-     ChannelsStateKey.Remove(false);
-     return;
-     }
-
-  bool ChannelsModified = false;
   bool handledExternally = EpgHandlers.HandledExternally(Channel);
   cSchedule *pSchedule = (cSchedule *)Schedules->GetSchedule(Channel, true);
 
@@ -88,7 +299,8 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
   localtime_r(&Now, &t); // this initializes the time zone in 't'
 
   SI::EIT::Event SiEitEvent;
-  for (SI::Loop::Iterator it; eventLoop.getNext(SiEitEvent, it); ) {
+  int EventNumber = 0;
+  for (SI::Loop::Iterator it; eventLoop.getNext(SiEitEvent, it); EventNumber++) {
       if (EpgHandlers.HandleEitEvent(pSchedule, &SiEitEvent, Tid, getVersionNumber()))
          continue; // an EPG handler has done all of the processing
       time_t StartTime = SiEitEvent.getStartTime();
@@ -165,40 +377,12 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
          }
       pEvent->SetVersion(getVersionNumber());
 
-      int LanguagePreferenceShort = -1;
-      int LanguagePreferenceExt = -1;
-      bool UseExtendedEventDescriptor = false;
       SI::Descriptor *d;
-      SI::ExtendedEventDescriptors *ExtendedEventDescriptors = NULL;
-      SI::ShortEventDescriptor *ShortEventDescriptor = NULL;
       cLinkChannels *LinkChannels = NULL;
       cComponents *Components = NULL;
       for (SI::Loop::Iterator it2; (d = SiEitEvent.eventDescriptors.getNext(it2)); ) {
           switch (d->getDescriptorTag()) {
-            case SI::ExtendedEventDescriptorTag: {
-                 SI::ExtendedEventDescriptor *eed = (SI::ExtendedEventDescriptor *)d;
-                 if (I18nIsPreferredLanguage(Setup.EPGLanguages, eed->languageCode, LanguagePreferenceExt) || !ExtendedEventDescriptors) {
-                    delete ExtendedEventDescriptors;
-                    ExtendedEventDescriptors = new SI::ExtendedEventDescriptors;
-                    UseExtendedEventDescriptor = true;
-                    }
-                 if (UseExtendedEventDescriptor) {
-                    if (ExtendedEventDescriptors->Add(eed))
-                       d = NULL; // so that it is not deleted
-                    }
-                 if (eed->getDescriptorNumber() == eed->getLastDescriptorNumber())
-                    UseExtendedEventDescriptor = false;
-                 }
-                 break;
-            case SI::ShortEventDescriptorTag: {
-                 SI::ShortEventDescriptor *sed = (SI::ShortEventDescriptor *)d;
-                 if (I18nIsPreferredLanguage(Setup.EPGLanguages, sed->languageCode, LanguagePreferenceShort) || !ShortEventDescriptor) {
-                    delete ShortEventDescriptor;
-                    ShortEventDescriptor = sed;
-                    d = NULL; // so that it is not deleted
-                    }
-                 }
-                 break;
+            // The short and extended event descriptors have already been handled by cEitSection::DecodeTexts().
             case SI::ContentDescriptorTag: {
                  SI::ContentDescriptor *cd = (SI::ContentDescriptor *)d;
                  SI::ContentDescriptor::Nibble Nibble;
@@ -321,24 +505,10 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
           }
 
       if (!rEvent) {
-         if (ShortEventDescriptor) {
-            char buffer[Utf8BufSize(256)];
-            EpgHandlers.SetTitle(pEvent, ShortEventDescriptor->name.getText(buffer, sizeof(buffer)));
-            EpgHandlers.SetShortText(pEvent, ShortEventDescriptor->text.getText(buffer, sizeof(buffer)));
-            }
-         else {
-            EpgHandlers.SetTitle(pEvent, NULL);
-            EpgHandlers.SetShortText(pEvent, NULL);
-            }
-         if (ExtendedEventDescriptors) {
-            char buffer[Utf8BufSize(ExtendedEventDescriptors->getMaximumTextLength(": ")) + 1];
-            EpgHandlers.SetDescription(pEvent, ExtendedEventDescriptors->getText(buffer, sizeof(buffer), ": "));
-            }
-         else
-            EpgHandlers.SetDescription(pEvent, NULL);
+         EpgHandlers.SetTitle(pEvent, Section.Title(EventNumber));
+         EpgHandlers.SetShortText(pEvent, Section.ShortText(EventNumber));
+         EpgHandlers.SetDescription(pEvent, Section.Description(EventNumber));
          }
-      delete ExtendedEventDescriptors;
-      delete ShortEventDescriptor;
 
       EpgHandlers.SetComponents(pEvent, Components);
 
@@ -361,8 +531,7 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
      EpgHandlers.DropOutdated(pSchedule, SegmentStart, SegmentEnd, Tid, getVersionNumber());
      pSchedule->SetModified();
      }
-  SchedulesStateKey.Remove(Modified);
-  ChannelsStateKey.Remove(ChannelsModified);
+  SchedulesModified |= Modified;
   EpgHandlers.EndSegmentTransfer(Modified);
 }
 
@@ -416,23 +585,315 @@ cTDT::cTDT(const u_char *Data)
      }
 }
 
+// --- cEitWorkers -----------------------------------------------------------
+
+#define EITWORKERS   4 // maximum number of threads that decode and apply EIT sections
+#define EITRETRYTIME 100 // ms to wait before trying again if the locks could not be acquired
+
+class cEitWorker : public cThread {
+  friend class cEitWorkers;
+protected:
+  virtual void Action(void);
+public:
+  cEitWorker(void);
+  virtual ~cEitWorker();
+  };
+
+class cEitWorkers {
+  friend class cEitWorker;
+private:
+  cMutex mutex;
+  cCondVar condVar;
+  cVector<cEitFilter *> queue; // filters that have sections to process...
+  cVector<uint64_t> due;       // ...and the time (in ms) when to process them
+  cVector<cEitFilter *> busy;  // filters that are currently being processed
+  cVector<cEitWorker *> workers;
+  void Add(cEitFilter *Filter, int DelayMs);
+  cEitFilter *Get(int TimeoutMs);
+  void Done(cEitFilter *Filter, int RetryMs);
+       ///< Marks the given Filter as no longer being processed. If RetryMs is not
+       ///< negative, the Filter is queued again and processed after that many ms.
+public:
+  ~cEitWorkers();
+  void Queue(cEitFilter *Filter, int DelayMs = 0);
+       ///< Queues the given Filter for processing its pending sections by the
+       ///< next free worker once DelayMs milliseconds have passed. If the Filter
+       ///< is already queued, the earlier of the two times applies. Starts a new
+       ///< worker if all of them are busy.
+  void Remove(cEitFilter *Filter);
+       ///< Waits until no worker is processing the given Filter any more and
+       ///< removes it from the queue.
+  };
+
+static cEitWorkers EitWorkers;
+
+cEitWorker::cEitWorker(void)
+:cThread("EIT worker")
+{
+}
+
+cEitWorker::~cEitWorker()
+{
+  Cancel(3);
+}
+
+void cEitWorker::Action(void)
+{
+  while (Running()) {
+        if (cEitFilter *Filter = EitWorkers.Get(1000))
+           EitWorkers.Done(Filter, Filter->Work() ? -1 : EITRETRYTIME);
+        }
+}
+
+cEitWorkers::~cEitWorkers()
+{
+  mutex.Lock();
+  for (int i = 0; i < workers.Size(); i++)
+      workers[i]->Cancel(-1);
+  condVar.Broadcast();
+  mutex.Unlock();
+  for (int i = 0; i < workers.Size(); i++)
+      delete workers[i];
+}
+
+void cEitWorkers::Add(cEitFilter *Filter, int DelayMs)
+{
+  uint64_t Due = cTimeMs::Now() + DelayMs;
+  int i = queue.IndexOf(Filter);
+  if (i < 0) {
+     queue.Append(Filter);
+     due.Append(Due);
+     if (queue.Size() > workers.Size() - busy.Size() && workers.Size() < EITWORKERS) {
+        cEitWorker *Worker = new cEitWorker;
+        workers.Append(Worker);
+        Worker->Start();
+        }
+     }
+  else if (Due < due[i])
+     due[i] = Due;
+  else
+     return;
+  condVar.Broadcast();
+}
+
+void cEitWorkers::Queue(cEitFilter *Filter, int DelayMs)
+{
+  cMutexLock MutexLock(&mutex);
+  Add(Filter, DelayMs);
+}
+
+void cEitWorkers::Remove(cEitFilter *Filter)
+{
+  cMutexLock MutexLock(&mutex);
+  while (busy.IndexOf(Filter) >= 0)
+        condVar.Wait(mutex);
+  int i = queue.IndexOf(Filter);
+  if (i >= 0) {
+     queue.Remove(i);
+     due.Remove(i);
+     }
+}
+
+cEitFilter *cEitWorkers::Get(int TimeoutMs)
+{
+  cMutexLock MutexLock(&mutex);
+  uint64_t Timeout = cTimeMs::Now() + TimeoutMs;
+  for (;;) {
+      uint64_t Now = cTimeMs::Now();
+      uint64_t Next = Timeout;
+      for (int i = 0; i < queue.Size(); i++) {
+          cEitFilter *Filter = queue[i];
+          if (busy.IndexOf(Filter) < 0) {
+             if (due[i] <= Now) {
+                queue.Remove(i);
+                due.Remove(i);
+                busy.Append(Filter);
+                return Filter;
+                }
+             Next = min(Next, due[i]);
+             }
+          }
+      if (Now >= Timeout)
+         return NULL;
+      condVar.TimedWait(mutex, int(Next - Now));
+      }
+}
+
+void cEitWorkers::Done(cEitFilter *Filter, int RetryMs)
+{
+  cMutexLock MutexLock(&mutex);
+  busy.RemoveElement(Filter);
+  if (RetryMs >= 0)
+     Add(Filter, RetryMs);
+  condVar.Broadcast();
+}
+
 // --- cEitFilter ------------------------------------------------------------
 
 time_t cEitFilter::disableUntil = 0;
 
+#define EITSTATISTICSINTERVAL 600 // seconds between reports of the section statistics
+#define EITBATCHTIME          250 // ms to collect EIT sections before processing them in one go...
+#define EITBATCHSECTIONS      100 // ...or this many sections, whatever comes first
+#define EITMAXPENDING        2000 // maximum number of sections to keep if the locks can't be acquired
+#define EITSETTLETIME        3000 // ms without new tables before the EIT of a transponder is considered complete
+
 cEitFilter::cEitFilter(void)
 {
+  sectionsProcessed = 0;
+  sectionsSkipped = 0;
+  sectionsDropped = 0;
+  lastStatistics = time(NULL);
+  detached = false;
   Set(0x12, 0x40, 0xC0);  // event info now&next actual/other TS (0x4E/0x4F), future actual/other TS (0x5X/0x6X)
   Set(0x14, 0x70);        // TDT
 }
 
+cEitFilter::~cEitFilter()
+{
+  mutex.Lock();
+  detached = true; // makes sure Process() doesn't queue this filter again
+  mutex.Unlock();
+  EitWorkers.Remove(this);
+}
+
 void cEitFilter::SetStatus(bool On)
 {
   cMutexLock MutexLock(&mutex);
+  // Whatever has been received so far is still applied by the EIT workers (with
+  // the source it was received from), but no longer synchronized with the
+  // section syncers, which start all over:
+  if (cEitBatch *Batch = batches.Last())
+     Batch->retired = true;
+  ReportStatistics();
   cFilter::SetStatus(On);
   sectionSyncerHash.Clear();
 }
 
+bool cEitFilter::Seen(u_char Tid, const u_char *Data, int Length)
+{
+  if (Tid == 0x4E || Length < 8)
+     return false; // present/following sections are always parsed to watch the running status
+  int ServiceId = (Data[3] << 8) | Data[4];
+  uchar Version = (Data[5] >> 1) & 0x1F;
+  int Number = Data[6];
+  return sectionSyncerHash.Seen(Tid, ServiceId, Version, Number);
+}
+
+void cEitFilter::DecodeSections(cEitBatch *Batch)
+{
+  cVector<uchar *> Sections(EITBATCHSECTIONS);
+  mutex.Lock();
+  for (int i = 0; i < Batch->sections.Size(); i++)
+      Sections.Append(Batch->sections[i]);
+  Batch->sections.Clear();
+  bool Retired = Batch->retired;
+  mutex.Unlock();
+  Batch->taken += Sections.Size();
+  int Dropped = 0;
+  for (int i = 0; i < Sections.Size(); i++) {
+      cEitSection *Section = new cEitSection(Sections[i]);
+      if (Batch->decodedSections.Size() >= EITMAXPENDING) {
+         delete Section;
+         Dropped++;
+         }
+      else if (Section->Decode(Retired ? NULL : &sectionSyncerHash, mutex))
+         Batch->decodedSections.Append(Section);
+      else
+         delete Section;
+      }
+  if (Dropped) {
+     cMutexLock MutexLock(&mutex);
+     sectionsDropped += Dropped;
+     }
+}
+
+bool cEitFilter::ApplyDecodedSections(cEitBatch *Batch)
+{
+  if (!Batch->decodedSections.Size())
+     return true;
+  cStateKey ChannelsStateKey;
+  cChannels *Channels = cChannels::GetChannelsWrite(ChannelsStateKey, 10);
+  if (!Channels)
+     return false; // let's not miss any section of the EIT and try again later
+  cStateKey SchedulesStateKey;
+  cSchedules *Schedules = cSchedules::GetSchedulesWrite(SchedulesStateKey, 10);
+  if (!Schedules) {
+     ChannelsStateKey.Remove(false);
+     return false;
+     }
+  bool ChannelsModified = false;
+  bool SchedulesModified = false;
+  int Processed = 0;
+  for (int i = 0; i < Batch->decodedSections.Size(); i++) {
+      cEitSection *Section = Batch->decodedSections[i];
+      // The section syncers are only updated now that the section is actually
+      // going to be applied, so that nothing is lost if the locks can't be acquired:
+      mutex.Lock();
+      bool Apply = Section->Sync(Batch->retired ? NULL : &sectionSyncerHash);
+      mutex.Unlock();
+      if (Apply) {
+         if (Section->Process())
+            Section->DecodeTexts();
+         cEIT EIT(*Section, Batch->source, Channels, Schedules, ChannelsModified, SchedulesModified);
+         Processed++;
+         }
+      }
+  SchedulesStateKey.Remove(SchedulesModified);
+  ChannelsStateKey.Remove(ChannelsModified);
+  mutex.Lock();
+  sectionsProcessed += Processed;
+  mutex.Unlock();
+  for (int i = 0; i < Batch->decodedSections.Size(); i++)
+      delete Batch->decodedSections[i];
+  Batch->decodedSections.Clear();
+  return true;
+}
+
+bool cEitFilter::Work(void)
+{
+  for (;;) {
+      mutex.Lock();
+      cEitBatch *Batch = batches.First();
+      mutex.Unlock();
+      if (!Batch)
+         return true;
+      DecodeSections(Batch);
+      if (!ApplyDecodedSections(Batch))
+         return false;
+      cMutexLock MutexLock(&mutex);
+      Batch->unapplied -= Batch->taken;
+      Batch->taken = 0;
+      if (!Batch->retired)
+         return true; // sections that arrive in the meantime are handled the next time
+      // A retired batch doesn't receive any more sections:
+      batches.Del(Batch);
+      }
+}
+
+void cEitFilter::ReportStatistics(void)
+{
+  if (sectionsProcessed || sectionsSkipped || sectionsDropped)
+     dsyslog("EIT filter %s/%d: %d sections processed, %d skipped, %d dropped", *cSource::ToString(Source()), Transponder(), sectionsProcessed, sectionsSkipped, sectionsDropped);
+  sectionsProcessed = 0;
+  sectionsSkipped = 0;
+  sectionsDropped = 0;
+  lastStatistics = time(NULL);
+}
+
+bool cEitFilter::Complete(void)
+{
+  cMutexLock MutexLock(&mutex);
+  // Sections that have been received, but not yet applied, have not yet been
+  // synchronized with the section syncers, so they may still complete a table
+  // or announce new ones:
+  if (cEitBatch *Batch = batches.Last()) {
+     if (!Batch->retired && Batch->unapplied)
+        return false;
+     }
+  return sectionSyncerHash.Complete(EITSETTLETIME);
+}
+
 void cEitFilter::SetDisableUntil(time_t Time)
 {
   disableUntil = Time;
@@ -449,8 +910,34 @@ void cEitFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
      }
   switch (Pid) {
     case 0x12: {
-         if (Tid >= 0x4E && Tid <= 0x6F)
-            cEIT EIT(sectionSyncerHash, Source(), Tid, Data);
+         if (Tid >= 0x4E && Tid <= 0x6F) {
+            if (Seen(Tid, Data, Length))
+               sectionsSkipped++;
+            else {
+               cEitBatch *Batch = batches.Last();
+               if (!Batch || Batch->retired) {
+                  Batch = new cEitBatch(Source());
+                  batches.Add(Batch);
+                  }
+               if (Batch->sections.Size() >= EITMAXPENDING)
+                  sectionsDropped++;
+               else if (uchar *Section = MALLOC(uchar, Length)) {
+                  memcpy(Section, Data, Length);
+                  Batch->sections.Append(Section);
+                  Batch->unapplied++;
+                  // The sections are processed in batches, because every change to the
+                  // channels or schedules wakes up everybody who watches them:
+                  if (!detached) {
+                     if (Batch->sections.Size() == 1)
+                        EitWorkers.Queue(this, EITBATCHTIME);
+                     else if (Batch->sections.Size() == EITBATCHSECTIONS)
+                        EitWorkers.Queue(this);
+                     }
+                  }
+               }
+            if (time(NULL) - lastStatistics > EITSTATISTICSINTERVAL)
+               ReportStatistics();
+            }
          }
          break;
     case 0x14: {
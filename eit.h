@@ -16,20 +16,70 @@
 class cSectionSyncerEntry : public cListObject, public cSectionSyncer {};
 
 class cSectionSyncerHash : public cHash<cSectionSyncerEntry> {
+private:
+  int numTables;
+  int numComplete;
+  cTimeMs lastNewTable;
+  cSectionSyncerEntry *GetEntry(int Tid, int ServiceId);
 public:
-  cSectionSyncerHash(void) : cHash(HASHSIZE, true) {};
+  cSectionSyncerHash(void) : cHash(HASHSIZE, true) { numTables = numComplete = 0; }
+  bool Sync(int Tid, int ServiceId, int LastTid, uchar Version, int Number, int LastNumber);
+       ///< Calls cSectionSyncer::Sync() for the table with the given Tid and ServiceId.
+       ///< LastTid is the last table id this service uses for its schedule, so all
+       ///< tables from the first one of that group up to LastTid are expected.
+  bool Seen(int Tid, int ServiceId, uchar Version, int Number);
+       ///< Returns true if a section with the given data has already been processed
+       ///< by Sync(), without changing the state of any syncer.
+  void Clear(void);
+  bool Complete(int SettleTime);
+       ///< Returns true if all tables that have been seen or announced so far are
+       ///< complete, and no new table has shown up within the last SettleTime ms.
   };
 
+class cEitSection;
+class cEitBatch;
+
 class cEitFilter : public cFilter {
+  friend class cEitWorker;
 private:
   cMutex mutex;
   cSectionSyncerHash sectionSyncerHash;
+  int sectionsProcessed;
+  int sectionsSkipped;
+  int sectionsDropped;
+  time_t lastStatistics;
+  bool detached;
+  cList<cEitBatch> batches; // the sections that have been received and not yet applied
   static time_t disableUntil;
+  bool Seen(u_char Tid, const u_char *Data, int Length);
+       ///< Checks the header of the given EIT section and returns true if this
+       ///< section has already been processed.
+  void DecodeSections(cEitBatch *Batch);
+       ///< Checks the CRC of the sections of the given Batch that have been
+       ///< received so far and converts their texts, which doesn't require any
+       ///< locks on the channels or schedules.
+  bool ApplyDecodedSections(cEitBatch *Batch);
+       ///< Processes all decoded EIT sections of the given Batch while holding the
+       ///< write locks on the channels and schedules only once, so that readers are
+       ///< notified of the changes only once per batch. The section syncers are
+       ///< updated only here. Returns false if the locks could not be acquired, in
+       ///< which case the sections are kept and the syncers remain unchanged.
+  bool Work(void);
+       ///< Decodes and applies the pending sections. This is done by one of the
+       ///< EIT worker threads, so that neither the section handler nor whoever
+       ///< switches the channel has to wait for it. A filter is only ever handled
+       ///< by one worker at a time, so the sections of each service are applied in
+       ///< order. Returns false if the work shall be tried again later.
+  void ReportStatistics(void);
 protected:
   virtual void Process(u_short Pid, u_char Tid, const u_char *Data, int Length);
 public:
   cEitFilter(void);
+  virtual ~cEitFilter();
   virtual void SetStatus(bool On);
+  bool Complete(void);
+       ///< Returns true if all EIT tables that are broadcast on the current transponder
+       ///< have been received completely, and all of their sections have been applied.
   static void SetDisableUntil(time_t Time);
   };
 
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include "channels.h"
 #include "dvbdevice.h"
+#include "epg.h"
 #include "skins.h"
 #include "transfer.h"
 
@@ -19,22 +20,31 @@
 class cScanData : public cListObject {
 private:
   cChannel channel;
+  time_t lastSeen;
+  cTimeMs timer;
 public:
-  cScanData(const cChannel *Channel);
+  cScanData(const cChannel *Channel, time_t LastSeen);
   virtual int Compare(const cListObject &ListObject) const;
   int Source(void) const { return channel.Source(); }
   int Transponder(void) const { return channel.Transponder(); }
   const cChannel *GetChannel(void) const { return &channel; }
+  time_t LastSeen(void) const { return lastSeen; }
+  void SetLastSeen(time_t LastSeen) { lastSeen = LastSeen; }
+  void Start(void) { timer.Set(); }
+  int Elapsed(void) const { return int(timer.Elapsed()); }
   };
 
-cScanData::cScanData(const cChannel *Channel)
+cScanData::cScanData(const cChannel *Channel, time_t LastSeen)
 {
   channel = *Channel;
+  lastSeen = LastSeen;
 }
 
 int cScanData::Compare(const cListObject &ListObject) const
 {
   const cScanData *sd = (const cScanData *)&ListObject;
+  if (lastSeen != sd->lastSeen)
+     return lastSeen < sd->lastSeen ? -1 : 1; // the transponders that haven't been seen for the longest time come first
   int r = Source() - sd->Source();
   if (r == 0)
      r = Transponder() - sd->Transponder();
@@ -45,25 +55,33 @@ int cScanData::Compare(const cListObject &ListObject) const
 
 class cScanList : public cList<cScanData> {
 public:
-  void AddTransponders(const cList<cChannel> *Channels);
-  void AddTransponder(const cChannel *Channel);
+  void AddTransponders(const cList<cChannel> *Channels, const cSchedules *Schedules);
+  void AddTransponder(const cChannel *Channel, const cSchedules *Schedules);
   };
 
-void cScanList::AddTransponders(const cList<cChannel> *Channels)
+void cScanList::AddTransponders(const cList<cChannel> *Channels, const cSchedules *Schedules)
 {
   for (const cChannel *ch = Channels->First(); ch; ch = Channels->Next(ch))
-      AddTransponder(ch);
+      AddTransponder(ch, Schedules);
   Sort();
 }
 
-void cScanList::AddTransponder(const cChannel *Channel)
+void cScanList::AddTransponder(const cChannel *Channel, const cSchedules *Schedules)
 {
   if (Channel->Source() && Channel->Transponder()) {
+     // The present event of a service is only seen while its transponder is tuned to,
+     // so the latest time any service of a transponder has been seen tells how stale
+     // the schedules of that transponder are:
+     const cSchedule *Schedule = Schedules ? Schedules->GetSchedule(Channel->GetChannelID()) : NULL;
+     time_t LastSeen = Schedule ? Schedule->PresentSeen() : 0;
      for (cScanData *sd = First(); sd; sd = Next(sd)) {
-         if (sd->Source() == Channel->Source() && ISTRANSPONDER(sd->Transponder(), Channel->Transponder()))
+         if (sd->Source() == Channel->Source() && ISTRANSPONDER(sd->Transponder(), Channel->Transponder())) {
+            if (LastSeen > sd->LastSeen())
+               sd->SetLastSeen(LastSeen);
             return;
+            }
          }
-     Add(new cScanData(Channel));
+     Add(new cScanData(Channel, LastSeen));
      }
 }
 
@@ -95,10 +113,14 @@ cEITScanner::cEITScanner(void)
   currentChannel = 0;
   scanList = NULL;
   transponderList = NULL;
+  memset(scanData, 0, sizeof(scanData));
+  numTransponders = numScanned = numComplete = maxDevices = 0;
 }
 
 cEITScanner::~cEITScanner()
 {
+  for (int i = 0; i < MAXDEVICES; i++)
+      delete scanData[i];
   delete scanList;
   delete transponderList;
 }
@@ -125,24 +147,93 @@ void cEITScanner::Activity(void)
   lastActivity = time(NULL);
 }
 
+void cEITScanner::StartScan(const cChannels *Channels)
+{
+  scanList = new cScanList;
+  cStateKey StateKey;
+  const cSchedules *Schedules = cSchedules::GetSchedulesRead(StateKey, 10); // without them all transponders are equally stale
+  if (transponderList) {
+     scanList->AddTransponders(transponderList, Schedules);
+     delete transponderList;
+     transponderList = NULL;
+     }
+  scanList->AddTransponders(Channels, Schedules);
+  if (Schedules)
+     StateKey.Remove();
+  scanTimer.Set();
+  numTransponders = scanList->Count();
+  numScanned = numComplete = maxDevices = 0;
+  dsyslog("EIT scan: starting scan of %d transponders", numTransponders);
+}
+
+void cEITScanner::CheckDevices(void)
+{
+  // Devices move on to the next transponder as soon as the EIT of the current one is complete:
+  for (int i = 0; i < MAXDEVICES; i++) {
+      if (cScanData *ScanData = scanData[i]) {
+         cDevice *Device = cDevice::GetDevice(i);
+         const char *Result = NULL;
+         if (!Device || !Device->IsTunedToTransponder(ScanData->GetChannel()))
+            Result = "aborted";
+         else if (Device->EitFilter() && Device->EitFilter()->Complete()) {
+            Result = "complete";
+            numComplete++;
+            }
+         else if (ScanData->Elapsed() > LockTimeout * 1000 && !Device->HasLock())
+            Result = "no lock";
+         else if (ScanData->Elapsed() > ScanTimeout * 1000)
+            Result = "timeout";
+         if (Result) {
+            dsyslog("EIT scan: device %d source %-8s tp %5d %s after %d ms", i + 1, *cSource::ToString(ScanData->Source()), ScanData->Transponder(), Result, ScanData->Elapsed());
+            delete ScanData;
+            scanData[i] = NULL;
+            numScanned++;
+            }
+         }
+      }
+}
+
+void cEITScanner::StopScan(void)
+{
+  int Seconds = max(int(scanTimer.Elapsed() / 1000), 1);
+  dsyslog("EIT scan: %d of %d transponders scanned in %d s with up to %d devices (%d complete, %.1f transponders per minute)", numScanned, numTransponders, Seconds, maxDevices, numComplete, numScanned * 60.0 / Seconds);
+  delete scanList;
+  scanList = NULL;
+}
+
+bool cEITScanner::GetStatistics(int &Transponders, int &Scanned, int &Devices, int &Seconds) const
+{
+  if (scanList) {
+     Transponders = numTransponders;
+     Scanned = numScanned;
+     Devices = 0;
+     for (int i = 0; i < MAXDEVICES; i++) {
+         if (scanData[i])
+            Devices++;
+         }
+     Seconds = int(scanTimer.Elapsed() / 1000);
+     return true;
+     }
+  return false;
+}
+
 void cEITScanner::Process(void)
 {
   if (Setup.EPGScanTimeout || !lastActivity) { // !lastActivity means a scan was forced
      time_t now = time(NULL);
-     if (now - lastScan > ScanTimeout && now - lastActivity > ActivityTimeout) {
+     // While a scan is in progress the devices are checked every second:
+     if (now - lastScan > (scanList ? 0 : ScanTimeout) && now - lastActivity > ActivityTimeout) {
         cStateKey StateKey;
         if (const cChannels *Channels = cChannels::GetChannelsRead(StateKey, 10)) {
-           if (!scanList) {
-              scanList = new cScanList;
-              if (transponderList) {
-                 scanList->AddTransponders(transponderList);
-                 delete transponderList;
-                 transponderList = NULL;
-                 }
-              scanList->AddTransponders(Channels);
-              }
-           bool AnyDeviceSwitched = false;
+           if (!scanList)
+              StartScan(Channels);
+           CheckDevices();
+           int NumDevices = 0;
            for (int i = 0; i < cDevice::NumDevices(); i++) {
+               if (scanData[i]) {
+                  NumDevices++;
+                  continue;
+                  }
                cDevice *Device = cDevice::GetDevice(i);
                if (Device && Device->ProvidesEIT()) {
                   for (cScanData *ScanData = scanList->First(); ScanData; ScanData = scanList->Next(ScanData)) {
@@ -164,10 +255,11 @@ void cEITScanner::Process(void)
                                            Skins.Message(mtInfo, tr("Starting EPG scan"));
                                            }
                                         }
-                                     //dsyslog("EIT scan: device %d  source  %-8s tp %5d", Device->DeviceNumber() + 1, *cSource::ToString(Channel->Source()), Channel->Transponder());
                                      Device->SwitchChannel(Channel, false);
-                                     scanList->Del(ScanData);
-                                     AnyDeviceSwitched = true;
+                                     scanList->Del(ScanData, false);
+                                     ScanData->Start();
+                                     scanData[i] = ScanData;
+                                     NumDevices++;
                                      break;
                                      }
                                   }
@@ -177,9 +269,9 @@ void cEITScanner::Process(void)
                       }
                   }
                }
-           if (!AnyDeviceSwitched) {
-              delete scanList;
-              scanList = NULL;
+           maxDevices = max(maxDevices, NumDevices);
+           if (!NumDevices) { // either all transponders have been scanned, or none of the remaining ones can be scanned now
+              StopScan();
               if (lastActivity == 0) // this was a triggered scan
                  Activity();
               }
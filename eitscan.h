@@ -15,18 +15,29 @@
 #include "config.h"
 #include "device.h"
 
+class cScanData;
 class cScanList;
 class cTransponderList;
 
 class cEITScanner {
 private:
   enum { ActivityTimeout = 60,
-         ScanTimeout = 20
+         ScanTimeout = 20,
+         LockTimeout = 5
        };
   time_t lastScan, lastActivity;
   int currentChannel;
   cScanList *scanList;
   cTransponderList *transponderList;
+  cScanData *scanData[MAXDEVICES]; // the transponder each device is currently scanning
+  cTimeMs scanTimer;
+  int numTransponders;
+  int numScanned;
+  int numComplete;
+  int maxDevices;
+  void StartScan(const cChannels *Channels);
+  void CheckDevices(void);
+  void StopScan(void);
 public:
   cEITScanner(void);
   ~cEITScanner();
@@ -35,6 +46,11 @@ public:
   void ForceScan(void);
   void Activity(void);
   void Process(void);
+  bool GetStatistics(int &Transponders, int &Scanned, int &Devices, int &Seconds) const;
+       ///< If an EPG scan is in progress, returns the total number of Transponders
+       ///< of this scan, how many of them have been Scanned so far, the number of
+       ///< Devices that are currently scanning and the number of Seconds since the
+       ///< scan has started, and returns true. Otherwise returns false.
   };
 
 extern cEITScanner EITScanner;
@@ -12,12 +12,24 @@
 
 #include "epg.h"
 #include <ctype.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include "epgindex.h"
 #include "libsi/si.h"
 
 #define RUNNINGSTATUSTIMEOUT 30 // seconds before the running status is considered unknown
 #define EPGDATAWRITEDELTA   600 // seconds between writing the epg.data file
+#define EPGCLEANUPSLICE      10 // ms the schedules are locked at a time while deleting expired events
+#define EPGCOMPACTDELTA   86400 // seconds between completely rewriting the epg.data file if the journal is used
+#define EPGJOURNALMAXSIZE    50 // percent of the size of the epg.data file the journal may grow to
+#define EPGJOURNALEXT       ".journal"
+#define EPGSNAPSHOTEXT      ".bin"
+#define EPGSNAPSHOTMAGIC    "VDR-EPG\n"
+#define EPGSNAPSHOTVERSION  1
+#define EPGSNAPSHOTBYTEORDER 0x01020304
 
 // --- tComponent ------------------------------------------------------------
 
@@ -108,6 +120,121 @@ tComponent *cComponents::GetComponent(int Index, uchar Stream, uchar Type)
   return NULL;
 }
 
+// --- cEpgStrings -----------------------------------------------------------
+
+#define EPGSTRINGSMINBUCKETS 1024
+
+cMutex cEpgStrings::mutex;
+cEpgStrings::tEntry **cEpgStrings::buckets = NULL;
+int cEpgStrings::numBuckets = 0;
+int cEpgStrings::numStrings = 0;
+int cEpgStrings::numReferences = 0;
+size_t cEpgStrings::numBytes = 0;
+
+static uint32_t EpgStringHash(const char *s, size_t &Length)
+{
+  // FNV-1a
+  uint32_t Hash = 2166136261U;
+  const char *p = s;
+  while (*p)
+        Hash = (Hash ^ uchar(*p++)) * 16777619U;
+  Length = p - s;
+  return Hash;
+}
+
+void cEpgStrings::Rehash(int NumBuckets)
+{
+  tEntry **NewBuckets = (tEntry **)calloc(NumBuckets, sizeof(tEntry *));
+  if (!NewBuckets)
+     return; // we'll just have to live with longer chains
+  for (int i = 0; i < numBuckets; i++) {
+      while (tEntry *e = buckets[i]) {
+            buckets[i] = e->next;
+            e->next = NewBuckets[e->hash % NumBuckets];
+            NewBuckets[e->hash % NumBuckets] = e;
+            }
+      }
+  free(buckets);
+  buckets = NewBuckets;
+  numBuckets = NumBuckets;
+}
+
+const char *cEpgStrings::Get(const char *s)
+{
+  if (!s)
+     return NULL;
+  size_t Length;
+  uint32_t Hash = EpgStringHash(s, Length);
+  cMutexLock MutexLock(&mutex);
+  if (numStrings >= numBuckets)
+     Rehash(max(numBuckets * 2, EPGSTRINGSMINBUCKETS));
+  if (!numBuckets)
+     return NULL;
+  tEntry **Bucket = &buckets[Hash % numBuckets];
+  for (tEntry *e = *Bucket; e; e = e->next) {
+      if (e->hash == Hash && strcmp(e->text, s) == 0) {
+         e->refs++;
+         numReferences++;
+         return e->text;
+         }
+      }
+  size_t Size = offsetof(tEntry, text) + Length + 1;
+  tEntry *e = (tEntry *)malloc(Size);
+  if (!e) {
+     esyslog("ERROR: out of memory");
+     return NULL;
+     }
+  memcpy(e->text, s, Length + 1);
+  e->hash = Hash;
+  e->refs = 1;
+  e->next = *Bucket;
+  *Bucket = e;
+  numStrings++;
+  numReferences++;
+  numBytes += Size;
+  return e->text;
+}
+
+const char *cEpgStrings::Ref(const char *s)
+{
+  if (s) {
+     tEntry *Entry = (tEntry *)(s - offsetof(tEntry, text));
+     cMutexLock MutexLock(&mutex);
+     Entry->refs++;
+     numReferences++;
+     }
+  return s;
+}
+
+void cEpgStrings::Put(const char *s)
+{
+  if (!s)
+     return;
+  tEntry *Entry = (tEntry *)(s - offsetof(tEntry, text));
+  cMutexLock MutexLock(&mutex);
+  numReferences--;
+  if (--Entry->refs > 0)
+     return;
+  for (tEntry **p = &buckets[Entry->hash % numBuckets]; *p; p = &(*p)->next) {
+      if (*p == Entry) {
+         *p = Entry->next;
+         numStrings--;
+         numBytes -= offsetof(tEntry, text) + strlen(Entry->text) + 1;
+         free(Entry);
+         return;
+         }
+      }
+  esyslog("ERROR: EPG string '%s' not found", s);
+}
+
+void cEpgStrings::GetStatistics(int &Strings, int &References, size_t &Bytes)
+{
+  cMutexLock MutexLock(&mutex);
+  Strings = numStrings;
+  References = numReferences;
+  Bytes = numBytes;
+}
+
 // --- cEvent ----------------------------------------------------------------
 
 cMutex cEvent::numTimersMutex;
@@ -126,6 +253,7 @@ cEvent::cEvent(tEventID EventID)
   components = NULL;
   memset(contents, 0, sizeof(contents));
   parentalRating = 0;
+  indexId = 0;
   startTime = 0;
   duration = 0;
   vps = 0;
@@ -135,10 +263,12 @@ cEvent::cEvent(tEventID EventID)
 
 cEvent::~cEvent()
 {
-  free(title);
-  free(shortText);
-  free(description);
-  free(aux);
+  if (indexId)
+     cEpgIndex::Del(this);
+  cEpgStrings::Put(title);
+  cEpgStrings::Put(shortText);
+  cEpgStrings::Put(description);
+  cEpgStrings::Put(aux);
   delete components;
 }
 
@@ -178,22 +308,36 @@ void cEvent::SetRunningStatus(int RunningStatus, const cChannel *Channel)
 {
   if (Channel && runningStatus != RunningStatus && (RunningStatus > SI::RunningStatusNotRunning || runningStatus > SI::RunningStatusUndefined) && schedule && schedule->HasTimer())
      isyslog("channel %d (%s) event %s status %d", Channel->Number(), Channel->Name(), *ToDescr(), RunningStatus);
+  if (schedule && runningStatus != RunningStatus)
+     schedule->InvalidatePresent();
   runningStatus = RunningStatus;
 }
 
 void cEvent::SetTitle(const char *Title)
 {
-  title = strcpyrealloc(title, Title);
+  const char *s = cEpgStrings::Get(Title);
+  cEpgStrings::Put(title);
+  if (indexId && s != title)
+     cEpgIndex::Changed(this);
+  title = s;
 }
 
 void cEvent::SetShortText(const char *ShortText)
 {
-  shortText = strcpyrealloc(shortText, ShortText);
+  const char *s = cEpgStrings::Get(ShortText);
+  cEpgStrings::Put(shortText);
+  if (indexId && s != shortText)
+     cEpgIndex::Changed(this);
+  shortText = s;
 }
 
 void cEvent::SetDescription(const char *Description)
 {
-  description = strcpyrealloc(description, Description);
+  const char *s = cEpgStrings::Get(Description);
+  cEpgStrings::Put(description);
+  if (indexId && s != description)
+     cEpgIndex::Changed(this);
+  description = s;
 }
 
 void cEvent::SetComponents(cComponents *Components)
@@ -226,6 +370,8 @@ void cEvent::SetStartTime(time_t StartTime)
 
 void cEvent::SetDuration(int Duration)
 {
+  if (schedule && duration != Duration)
+     schedule->InvalidateIndex();
   duration = Duration;
 }
 
@@ -236,13 +382,16 @@ void cEvent::SetVps(time_t Vps)
 
 void cEvent::SetSeen(void)
 {
+  if (schedule && runningStatus >= SI::RunningStatusPausing)
+     schedule->InvalidatePresent(); // this event may now count as "running" again
   seen = time(NULL);
 }
 
 void cEvent::SetAux(const char *Aux)
 {
-  free(aux);
-  aux = Aux ? strdup(Aux) : NULL;
+  const char *s = cEpgStrings::Get(Aux);
+  cEpgStrings::Put(aux);
+  aux = s;
 }
 
 cString cEvent::ToDescr(void) const
@@ -457,9 +606,9 @@ void cEvent::Dump(FILE *f, const char *Prefix, bool InfoOnly) const
      if (!isempty(shortText))
         fprintf(f, "%sS %s\n", Prefix, shortText);
      if (!isempty(description)) {
-        strreplace(description, '\n', '|');
-        fprintf(f, "%sD %s\n", Prefix, description);
-        strreplace(description, '|', '\n');
+        char *d = strreplace(strdup(description), '\n', '|');
+        fprintf(f, "%sD %s\n", Prefix, d);
+        free(d);
         }
      if (contents[0]) {
         fprintf(f, "%sG", Prefix);
@@ -478,9 +627,9 @@ void cEvent::Dump(FILE *f, const char *Prefix, bool InfoOnly) const
      if (vps)
         fprintf(f, "%sV %ld\n", Prefix, vps);
      if (!InfoOnly && !isempty(aux)) {
-        strreplace(aux, '\n', '|');
-        fprintf(f, "%s@ %s\n", Prefix, aux);
-        strreplace(aux, '|', '\n');
+        char *a = strreplace(strdup(aux), '\n', '|');
+        fprintf(f, "%s@ %s\n", Prefix, a);
+        free(a);
         }
      if (!InfoOnly)
         fprintf(f, "%se\n", Prefix);
@@ -689,9 +838,14 @@ static void StripControlCharacters(char *s)
 
 void cEvent::FixEpgBugs(void)
 {
-  if (isempty(title)) {
+  // The texts may be shared with other events, so they are fixed in private copies:
+  char *Title = title ? strdup(title) : NULL;
+  char *ShortText = shortText ? strdup(shortText) : NULL;
+  char *Description = description ? strdup(description) : NULL;
+
+  if (isempty(Title)) {
      // we don't want any "(null)" titles
-     title = strcpyrealloc(title, tr("No title"));
+     Title = strcpyrealloc(Title, tr("No title"));
      EpgBugFixStat(12, ChannelID());
      }
 
@@ -707,8 +861,8 @@ void cEvent::FixEpgBugs(void)
   // Title
   // "ShortText". Description
   //
-  if ((shortText == NULL) != (description == NULL)) {
-     char *p = shortText ? shortText : description;
+  if ((ShortText == NULL) != (Description == NULL)) {
+     char *p = ShortText ? ShortText : Description;
      if (*p == '"') {
         const char *delim = "\".";
         char *e = strstr(p + 1, delim);
@@ -716,10 +870,10 @@ void cEvent::FixEpgBugs(void)
            *e = 0;
            char *s = strdup(p + 1);
            char *d = strdup(e + strlen(delim));
-           free(shortText);
-           free(description);
-           shortText = s;
-           description = d;
+           free(ShortText);
+           free(Description);
+           ShortText = s;
+           Description = d;
            EpgBugFixStat(1, ChannelID());
            }
         }
@@ -732,11 +886,11 @@ void cEvent::FixEpgBugs(void)
   // Title
   //  Description
   //
-  if (shortText && !description) {
-     if (*shortText == ' ') {
-        memmove(shortText, shortText + 1, strlen(shortText));
-        description = shortText;
-        shortText = NULL;
+  if (ShortText && !Description) {
+     if (*ShortText == ' ') {
+        memmove(ShortText, ShortText + 1, strlen(ShortText));
+        Description = ShortText;
+        ShortText = NULL;
         EpgBugFixStat(2, ChannelID());
         }
      }
@@ -746,9 +900,9 @@ void cEvent::FixEpgBugs(void)
   // Title
   // Title
   //
-  if (shortText && strcmp(title, shortText) == 0) {
-     free(shortText);
-     shortText = NULL;
+  if (ShortText && strcmp(Title, ShortText) == 0) {
+     free(ShortText);
+     ShortText = NULL;
      EpgBugFixStat(3, ChannelID());
      }
 
@@ -758,11 +912,11 @@ void cEvent::FixEpgBugs(void)
   // Title
   // "ShortText"[.]
   //
-  if (shortText && *shortText == '"') {
-     int l = strlen(shortText);
-     if (l > 2 && (shortText[l - 1] == '"' || (shortText[l - 1] == '.' && shortText[l - 2] == '"'))) {
-        memmove(shortText, shortText + 1, l);
-        char *p = strrchr(shortText, '"');
+  if (ShortText && *ShortText == '"') {
+     int l = strlen(ShortText);
+     if (l > 2 && (ShortText[l - 1] == '"' || (ShortText[l - 1] == '.' && ShortText[l - 2] == '"'))) {
+        memmove(ShortText, ShortText + 1, l);
+        char *p = strrchr(ShortText, '"');
         if (p)
            *p = 0;
         EpgBugFixStat(4, ChannelID());
@@ -776,34 +930,34 @@ void cEvent::FixEpgBugs(void)
   // which is a bad idea because they have no way of knowing the width
   // of the window that will actually display the text.
   // Remove excess whitespace:
-  title = compactspace(title);
-  shortText = compactspace(shortText);
-  description = compactspace(description);
+  Title = compactspace(Title);
+  ShortText = compactspace(ShortText);
+  Description = compactspace(Description);
 
 #define MAX_USEFUL_EPISODE_LENGTH 40
   // Some channels put a whole lot of information in the ShortText and leave
   // the Description totally empty. So if the ShortText length exceeds
   // MAX_USEFUL_EPISODE_LENGTH, let's put this into the Description
   // instead:
-  if (!isempty(shortText) && isempty(description)) {
-     if (strlen(shortText) > MAX_USEFUL_EPISODE_LENGTH) {
-        free(description);
-        description = shortText;
-        shortText = NULL;
+  if (!isempty(ShortText) && isempty(Description)) {
+     if (strlen(ShortText) > MAX_USEFUL_EPISODE_LENGTH) {
+        free(Description);
+        Description = ShortText;
+        ShortText = NULL;
         EpgBugFixStat(6, ChannelID());
         }
      }
 
   // Some channels put the same information into ShortText and Description.
   // In that case we delete one of them:
-  if (shortText && description && strcmp(shortText, description) == 0) {
-     if (strlen(shortText) > MAX_USEFUL_EPISODE_LENGTH) {
-        free(shortText);
-        shortText = NULL;
+  if (ShortText && Description && strcmp(ShortText, Description) == 0) {
+     if (strlen(ShortText) > MAX_USEFUL_EPISODE_LENGTH) {
+        free(ShortText);
+        ShortText = NULL;
         }
      else {
-        free(description);
-        description = NULL;
+        free(Description);
+        Description = NULL;
         }
      EpgBugFixStat(7, ChannelID());
      }
@@ -811,9 +965,9 @@ void cEvent::FixEpgBugs(void)
   // Some channels use the ` ("backtick") character, where a ' (single quote)
   // would be normally used. Actually, "backticks" in normal text don't make
   // much sense, so let's replace them:
-  strreplace(title, '`', '\'');
-  strreplace(shortText, '`', '\'');
-  strreplace(description, '`', '\'');
+  strreplace(Title, '`', '\'');
+  strreplace(ShortText, '`', '\'');
+  strreplace(Description, '`', '\'');
 
   if (Setup.EPGBugfixLevel <= 2)
      goto Final;
@@ -887,8 +1041,8 @@ Final:
 
   // VDR can't usefully handle newline characters in the title, shortText or component description of EPG
   // data, so let's always convert them to blanks (independent of the setting of EPGBugfixLevel):
-  strreplace(title, '\n', ' ');
-  strreplace(shortText, '\n', ' ');
+  strreplace(Title, '\n', ' ');
+  strreplace(ShortText, '\n', ' ');
   if (components) {
      for (int i = 0; i < components->NumComponents(); i++) {
          tComponent *p = components->Component(i);
@@ -897,22 +1051,34 @@ Final:
          }
      }
   // Same for control characters:
-  StripControlCharacters(title);
-  StripControlCharacters(shortText);
-  StripControlCharacters(description);
+  StripControlCharacters(Title);
+  StripControlCharacters(ShortText);
+  StripControlCharacters(Description);
+  SetTitle(Title);
+  SetShortText(ShortText);
+  SetDescription(Description);
+  free(Title);
+  free(ShortText);
+  free(Description);
 }
 
 // --- cSchedule -------------------------------------------------------------
 
 cMutex cSchedule::numTimersMutex;
+cMutex cSchedule::indexMutex;
 
 cSchedule::cSchedule(tChannelID ChannelID)
 {
   channelID = ChannelID;
   events.SetUseGarbageCollector();
+  maxDuration = 0;
+  indexValid = false;
+  presentEvent = NULL;
+  presentValidUntil = 0;
   numTimers = 0;
   hasRunning = false;
   modified = 0;
+  savedState = 0;
   presentSeen = 0;
 }
 
@@ -935,6 +1101,7 @@ cEvent *cSchedule::AddEvent(cEvent *Event)
   events.Add(Event);
   Event->schedule = this;
   HashEvent(Event);
+  cEpgIndex::Add(Event);
   return Event;
 }
 
@@ -942,12 +1109,14 @@ void cSchedule::DelEvent(cEvent *Event)
 {
   if (Event->schedule == this) {
      UnhashEvent(Event);
+     cEpgIndex::Del(Event);
      events.Del(Event);
      }
 }
 
 void cSchedule::HashEvent(cEvent *Event)
 {
+  InvalidateIndex();
   eventsHashID.Add(Event, Event->EventID());
   if (Event->StartTime() > 0) // 'StartTime < 0' is apparently used with NVOD channels
      eventsHashStartTime.Add(Event, Event->StartTime());
@@ -955,23 +1124,77 @@ void cSchedule::HashEvent(cEvent *Event)
 
 void cSchedule::UnhashEvent(cEvent *Event)
 {
+  InvalidateIndex();
   eventsHashID.Del(Event, Event->EventID());
   if (Event->StartTime() > 0) // 'StartTime < 0' is apparently used with NVOD channels
      eventsHashStartTime.Del(Event, Event->StartTime());
 }
 
+static int CompareEventsByStartTime(const void *a, const void *b)
+{
+  time_t ta = (*(const cEvent **)a)->StartTime();
+  time_t tb = (*(const cEvent **)b)->StartTime();
+  return (ta > tb) - (ta < tb);
+}
+
+void cSchedule::UpdateIndex(void) const
+{
+  if (indexValid)
+     return;
+  eventsByTime.Clear();
+  maxDuration = 0;
+  bool Sorted = true;
+  for (const cEvent *p = events.First(); p; p = events.Next(p)) {
+      if (eventsByTime.Size() && p->StartTime() < eventsByTime[eventsByTime.Size() - 1]->StartTime())
+         Sorted = false;
+      eventsByTime.Append((cEvent *)p);
+      maxDuration = max(maxDuration, p->Duration());
+      }
+  if (!Sorted)
+     eventsByTime.Sort(CompareEventsByStartTime);
+  indexValid = true;
+}
+
+int cSchedule::FirstStartingAfter(time_t Time) const
+{
+  int Low = 0;
+  int High = eventsByTime.Size();
+  while (Low < High) {
+        int Middle = (Low + High) / 2;
+        if (eventsByTime[Middle]->StartTime() <= Time)
+           Low = Middle + 1;
+        else
+           High = Middle;
+        }
+  return Low;
+}
+
 const cEvent *cSchedule::GetPresentEvent(void) const
 {
-  const cEvent *pe = NULL;
   time_t now = time(NULL);
+  cMutexLock MutexLock(&indexMutex);
+  if (now < presentValidUntil)
+     return presentEvent;
+  // The result remains the same until the next event starts, or the running
+  // status of an event changes (see cEvent::SetRunningStatus() and SetSeen()):
+  const cEvent *pe = NULL;
+  time_t ValidUntil = now + 3600;
   for (const cEvent *p = events.First(); p; p = events.Next(p)) {
       if (p->StartTime() <= now)
          pe = p;
-      else if (p->StartTime() > now + 3600)
+      else {
+         ValidUntil = min(ValidUntil, p->StartTime());
+         if (p->StartTime() > now + 3600)
+            break;
+         }
+      if (p->SeenWithin(RUNNINGSTATUSTIMEOUT) && p->RunningStatus() >= SI::RunningStatusPausing) {
+         pe = p;
+         ValidUntil = min(ValidUntil, p->Seen() + RUNNINGSTATUSTIMEOUT);
          break;
-      if (p->SeenWithin(RUNNINGSTATUSTIMEOUT) && p->RunningStatus() >= SI::RunningStatusPausing)
-         return p;
+         }
       }
+  presentEvent = pe;
+  presentValidUntil = ValidUntil;
   return pe;
 }
 
@@ -982,10 +1205,11 @@ const cEvent *cSchedule::GetFollowingEvent(void) const
      p = events.Next(p);
   else {
      time_t now = time(NULL);
-     for (p = events.First(); p; p = events.Next(p)) {
-         if (p->StartTime() >= now)
-            break;
-         }
+     cMutexLock MutexLock(&indexMutex);
+     UpdateIndex();
+     // the first event that starts at or after 'now':
+     int i = FirstStartingAfter(now - 1);
+     p = i < eventsByTime.Size() ? eventsByTime[i] : NULL;
      }
   return p;
 }
@@ -1002,16 +1226,18 @@ const cEvent *cSchedule::GetEvent(tEventID EventID, time_t StartTime) const
 
 const cEvent *cSchedule::GetEventAround(time_t Time) const
 {
-  const cEvent *pe = NULL;
-  time_t delta = INT_MAX;
-  for (const cEvent *p = events.First(); p; p = events.Next(p)) {
-      time_t dt = Time - p->StartTime();
-      if (dt >= 0 && dt < delta && p->EndTime() >= Time) {
-         delta = dt;
-         pe = p;
-         }
+  cMutexLock MutexLock(&indexMutex);
+  UpdateIndex();
+  // Of all events that contain Time, the one that started last wins. Since no
+  // event lasts longer than maxDuration, only a few events need to be checked:
+  for (int i = FirstStartingAfter(Time) - 1; i >= 0; i--) {
+      const cEvent *p = eventsByTime[i];
+      if (p->StartTime() < Time - maxDuration)
+         break;
+      if (p->EndTime() >= Time)
+         return p;
       }
-  return pe;
+  return NULL;
 }
 
 void cSchedule::SetRunningStatus(cEvent *Event, int RunningStatus, const cChannel *Channel)
@@ -1054,6 +1280,7 @@ void cSchedule::ResetVersions(void)
 void cSchedule::Sort(void)
 {
   events.Sort();
+  InvalidateIndex();
   // Make sure there are no RunningStatusUndefined before the currently running event:
   if (hasRunning) {
      for (cEvent *p = events.First(); p; p = events.Next(p)) {
@@ -1068,23 +1295,26 @@ void cSchedule::Sort(void)
 void cSchedule::DropOutdated(time_t SegmentStart, time_t SegmentEnd, uchar TableID, uchar Version)
 {
   if (SegmentStart > 0 && SegmentEnd > 0) {
-     cEvent *p = events.First();
-     while (p) {
-           cEvent *n = events.Next(p);
-           if (p->EndTime() > SegmentStart) {
-              if (p->StartTime() < SegmentEnd) {
-                 // The event overlaps with the given time segment.
-                 if (p->TableID() > TableID || p->TableID() == TableID && p->Version() != Version) {
-                    // The segment overwrites all events from tables with higher ids, and
-                    // within the same table id all events must have the same version.
-                    DelEvent(p);
-                    }
-                 }
-              else
-                 break;
-              }
-           p = n;
-           }
+     cVector<cEvent *> Outdated;
+     indexMutex.Lock();
+     UpdateIndex();
+     // Events that end after SegmentStart can't start before SegmentStart - maxDuration:
+     for (int i = FirstStartingAfter(SegmentStart - maxDuration - 1); i < eventsByTime.Size(); i++) {
+         cEvent *p = eventsByTime[i];
+         if (p->StartTime() >= SegmentEnd)
+            break;
+         if (p->EndTime() > SegmentStart) {
+            // The event overlaps with the given time segment.
+            if (p->TableID() > TableID || p->TableID() == TableID && p->Version() != Version) {
+               // The segment overwrites all events from tables with higher ids, and
+               // within the same table id all events must have the same version.
+               Outdated.Append(p);
+               }
+            }
+         }
+     indexMutex.Unlock();
+     for (int i = 0; i < Outdated.Size(); i++)
+         DelEvent(Outdated[i]);
      }
 }
 
@@ -1093,15 +1323,19 @@ void cSchedule::Cleanup(void)
   Cleanup(time(NULL));
 }
 
-void cSchedule::Cleanup(time_t Time)
+bool cSchedule::Cleanup(time_t Time, const cTimeMs *Timeout)
 {
   cEvent *Event;
   while ((Event = events.First()) != NULL) {
-        if (!Event->HasTimer() && Event->EndTime() + Setup.EPGLinger * 60 < Time)
+        if (!Event->HasTimer() && Event->EndTime() + Setup.EPGLinger * 60 < Time) {
+           if (Timeout && Timeout->TimedOut())
+              return false;
            DelEvent(Event);
+           }
         else
            break;
         }
+  return true;
 }
 
 void cSchedule::Dump(const cChannels *Channels, FILE *f, const char *Prefix, eDumpMode DumpMode, time_t AtTime) const
@@ -1136,7 +1370,7 @@ void cSchedule::Dump(const cChannels *Channels, FILE *f, const char *Prefix, eDu
      }
 }
 
-bool cSchedule::Read(FILE *f, cSchedules *Schedules)
+bool cSchedule::Read(FILE *f, cSchedules *Schedules, bool Replace)
 {
   if (Schedules) {
      int Line = 0;
@@ -1153,6 +1387,8 @@ bool cSchedule::Read(FILE *f, cSchedules *Schedules)
                  tChannelID channelID = tChannelID::FromString(s);
                  if (channelID.Valid()) {
                     if (cSchedule *p = Schedules->AddSchedule(channelID)) {
+                       if (Replace)
+                          p->Cleanup(INT_MAX);
                        if (!cEvent::Read(f, p, Line))
                           return false;
                        p->Sort();
@@ -1174,6 +1410,266 @@ bool cSchedule::Read(FILE *f, cSchedules *Schedules)
   return false;
 }
 
+// --- cEpgSnapshotWriter ----------------------------------------------------
+
+// The binary EPG data snapshot consists of a header:
+//   magic (8 bytes), version (u32), byte order (u32), number of strings (u32),
+//   number of schedules (u32)
+// followed by the string table, where each distinct text of the events is
+// stored only once, as its length including the terminating 0 (u32), followed
+// by the characters and the terminating 0. Then come the schedules:
+//   source, nid, tid, sid, rid (s32), number of events (u32)
+// each followed by its events:
+//   event id (u32), start time (s64), duration (s32), table id (u8), version (u8),
+//   parental rating (u8), contents (MaxEventContents * u8), vps (s64),
+//   title, short text, description, aux (u32 index into the string table + 1,
+//   or 0 for NULL), number of components (u8)
+// each followed by its components:
+//   stream (u8), type (u8), language (MAXLANGCODE2 bytes), description (string,
+//   stored like the strings in the string table, with length 0 for NULL)
+// All numbers are stored in the byte order of the machine that wrote the file.
+
+class cEpgSnapshotWriter {
+private:
+  FILE *f;
+  bool error;
+  // Maps the (shared, see cEpgStrings) texts of the events to their index in the string table:
+  int size;
+  const char **keys;
+  uint32_t *values;
+  cVector<const char *> strings;
+  void Grow(void);
+  uint32_t Index(const char *s);
+public:
+  cEpgSnapshotWriter(FILE *File);
+  ~cEpgSnapshotWriter();
+  bool Error(void) { return error; }
+  void Put(const void *Data, size_t Size) { if (!error && fwrite(Data, Size, 1, f) != 1) error = true; }
+  void Put8(uint8_t Value) { Put(&Value, sizeof(Value)); }
+  void Put32(uint32_t Value) { Put(&Value, sizeof(Value)); }
+  void Put64(uint64_t Value) { Put(&Value, sizeof(Value)); }
+  void PutString(const char *s) { uint32_t l = s ? strlen(s) + 1 : 0; Put32(l); if (l) Put(s, l); }
+  void AddStrings(const cEvent *Event);
+       ///< Adds the texts of the given Event to the string table.
+  void PutStrings(void);
+       ///< Writes the string table, after all events have been given to AddStrings().
+  void PutEvent(const cEvent *Event);
+  uint32_t NumStrings(void) { return strings.Size(); }
+  };
+
+cEpgSnapshotWriter::cEpgSnapshotWriter(FILE *File)
+{
+  f = File;
+  error = false;
+  size = 0;
+  keys = NULL;
+  values = NULL;
+}
+
+cEpgSnapshotWriter::~cEpgSnapshotWriter()
+{
+  free(keys);
+  free(values);
+}
+
+static inline int EpgSnapshotHash(const char *s, int Size)
+{
+  return ((uintptr_t(s) >> 3) * 2654435761U) & (Size - 1);
+}
+
+void cEpgSnapshotWriter::Grow(void)
+{
+  int OldSize = size;
+  const char **OldKeys = keys;
+  uint32_t *OldValues = values;
+  size = max(size * 2, 1 << 16);
+  keys = (const char **)calloc(size, sizeof(const char *));
+  values = (uint32_t *)malloc(size * sizeof(uint32_t));
+  for (int i = 0; i < OldSize; i++) {
+      if (const char *k = OldKeys[i]) {
+         int h = EpgSnapshotHash(k, size);
+         while (keys[h])
+               h = (h + 1) & (size - 1);
+         keys[h] = k;
+         values[h] = OldValues[i];
+         }
+      }
+  free(OldKeys);
+  free(OldValues);
+}
+
+uint32_t cEpgSnapshotWriter::Index(const char *s)
+{
+  if (!s)
+     return 0;
+  if (strings.Size() >= size / 2)
+     Grow();
+  int h = EpgSnapshotHash(s, size);
+  while (keys[h]) {
+        if (keys[h] == s)
+           return values[h];
+        h = (h + 1) & (size - 1);
+        }
+  keys[h] = s;
+  strings.Append(s);
+  return values[h] = strings.Size();
+}
+
+void cEpgSnapshotWriter::AddStrings(const cEvent *Event)
+{
+  Index(Event->Title());
+  Index(Event->ShortText());
+  Index(Event->Description());
+  Index(Event->Aux());
+}
+
+void cEpgSnapshotWriter::PutStrings(void)
+{
+  for (int i = 0; i < strings.Size(); i++)
+      PutString(strings[i]);
+}
+
+void cEpgSnapshotWriter::PutEvent(const cEvent *Event)
+{
+  Put32(Event->EventID());
+  Put64(Event->StartTime());
+  Put32(Event->Duration());
+  Put8(Event->TableID());
+  Put8(Event->Version());
+  Put8(Event->ParentalRating());
+  for (int i = 0; i < MaxEventContents; i++)
+      Put8(Event->Contents(i));
+  Put64(Event->Vps());
+  Put32(Index(Event->Title()));
+  Put32(Index(Event->ShortText()));
+  Put32(Index(Event->Description()));
+  Put32(Index(Event->Aux()));
+  const cComponents *Components = Event->Components();
+  int NumComponents = Components ? min(Components->NumComponents(), 255) : 0;
+  Put8(NumComponents);
+  for (int i = 0; i < NumComponents; i++) {
+      tComponent *p = Components->Component(i);
+      Put8(p->stream);
+      Put8(p->type);
+      Put(p->language, sizeof(p->language));
+      PutString(p->description);
+      }
+}
+
+// --- cEpgSnapshotReader ----------------------------------------------------
+
+class cEpgSnapshotReader {
+private:
+  const uchar *data;
+  const uchar *end;
+  bool error;
+  cVector<const char *> strings; // the string table, taken from cEpgStrings
+  const char *GetStringRef(void);
+public:
+  cEpgSnapshotReader(const uchar *Data, size_t Size) { data = Data; end = Data + Size; error = false; }
+  ~cEpgSnapshotReader();
+  bool Error(void) { return error; }
+  void Get(void *Data, size_t Size);
+  uint8_t Get8(void) { uint8_t v; Get(&v, sizeof(v)); return v; }
+  uint32_t Get32(void) { uint32_t v; Get(&v, sizeof(v)); return v; }
+  uint64_t Get64(void) { uint64_t v; Get(&v, sizeof(v)); return v; }
+  const char *GetString(void);
+  bool GetStrings(uint32_t NumStrings);
+       ///< Reads the string table.
+  cEvent *GetEvent(void);
+  };
+
+cEpgSnapshotReader::~cEpgSnapshotReader()
+{
+  for (int i = 0; i < strings.Size(); i++)
+      cEpgStrings::Put(strings[i]);
+}
+
+void cEpgSnapshotReader::Get(void *Data, size_t Size)
+{
+  if (!error && size_t(end - data) >= Size) {
+     memcpy(Data, data, Size);
+     data += Size;
+     }
+  else {
+     error = true;
+     memset(Data, 0, Size);
+     }
+}
+
+const char *cEpgSnapshotReader::GetString(void)
+{
+  uint32_t l = Get32();
+  if (!l || error)
+     return NULL;
+  if (size_t(end - data) < l || data[l - 1] != 0) {
+     error = true;
+     return NULL;
+     }
+  const char *s = (const char *)data;
+  data += l;
+  return s;
+}
+
+bool cEpgSnapshotReader::GetStrings(uint32_t NumStrings)
+{
+  for (uint32_t i = 0; i < NumStrings && !error; i++) {
+      if (const char *s = GetString())
+         strings.Append(cEpgStrings::Get(s));
+      else
+         error = true;
+      }
+  return !error;
+}
+
+const char *cEpgSnapshotReader::GetStringRef(void)
+{
+  uint32_t Index = Get32();
+  if (!Index)
+     return NULL;
+  if (int(Index) > strings.Size()) {
+     error = true;
+     return NULL;
+     }
+  return cEpgStrings::Ref(strings[Index - 1]);
+}
+
+cEvent *cEpgSnapshotReader::GetEvent(void)
+{
+  cEvent *Event = new cEvent(Get32());
+  Event->SetStartTime(Get64());
+  Event->SetDuration(Get32());
+  Event->SetTableID(Get8());
+  Event->SetVersion(Get8());
+  Event->SetParentalRating(Get8());
+  uchar Contents[MaxEventContents];
+  Get(Contents, sizeof(Contents));
+  Event->SetContents(Contents);
+  Event->SetVps(Get64());
+  // The texts are already in the string pool, so there's no need to look them up again:
+  Event->title = GetStringRef();
+  Event->shortText = GetStringRef();
+  Event->description = GetStringRef();
+  Event->aux = GetStringRef();
+  if (int NumComponents = Get8()) {
+     cComponents *Components = new cComponents;
+     for (int i = 0; i < NumComponents; i++) {
+         uchar Stream = Get8();
+         uchar Type = Get8();
+         char Language[MAXLANGCODE2];
+         Get(Language, sizeof(Language));
+         Language[sizeof(Language) - 1] = 0;
+         Components->SetComponent(i, Stream, Type, Language, GetString());
+         }
+     Event->SetComponents(Components);
+     }
+  if (error) {
+     delete Event;
+     return NULL;
+     }
+  return Event;
+}
+
 // --- cEpgDataWriter --------------------------------------------------------
 
 class cEpgDataWriter : public cThread {
@@ -1202,17 +1698,58 @@ void cEpgDataWriter::Action(void)
 void cEpgDataWriter::Perform(void)
 {
   cMutexLock MutexLock(&mutex); // to make sure fore- and background calls don't cause parellel dumps!
+  // Expired events are deleted in short slices, so that others don't have to wait
+  // for the schedules lock for too long:
+  time_t now = time(NULL);
+  int Index = 0;
+  for (int Slices = 1; ; Slices++) {
+      cStateKey StateKey;
+      cSchedules *Schedules = cSchedules::GetSchedulesWrite(StateKey, 1000);
+      if (!Schedules)
+         break;
+      cTimeMs Timeout(EPGCLEANUPSLICE);
+      cSchedule *p = Schedules->Get(Index);
+      while (p && p->Cleanup(now, &Timeout)) {
+            p = Schedules->Next(p);
+            Index++;
+            }
+      StateKey.Remove();
+      if (!p) {
+         if (Slices > 1)
+            dsyslog("EPG cleanup done in %d slices", Slices);
+         break;
+         }
+      cCondWait::SleepMs(EPGCLEANUPSLICE);
+      }
+  int Strings, References;
+  size_t Bytes;
+  cEpgStrings::GetStatistics(Strings, References, Bytes);
+  dsyslog("EPG strings: %d references to %d strings (%d KB)", References, Strings, int(Bytes / KILOBYTE(1)));
   {
     cStateKey StateKey;
-    if (cSchedules *Schedules = cSchedules::GetSchedulesWrite(StateKey, 1000)) {
-       time_t now = time(NULL);
-       for (cSchedule *p = Schedules->First(); p; p = Schedules->Next(p))
-           p->Cleanup(now);
+    if (const cSchedules *Schedules = cSchedules::GetSchedulesRead(StateKey, 1000)) {
+       cTimeMs Timer;
+       cEpgIndex::Update(Schedules);
        StateKey.Remove();
+       if (cEpgIndex::Enabled()) {
+          int Events, Terms, Postings;
+          cEpgIndex::GetStatistics(Events, Terms, Postings);
+          dsyslog("EPG index: %d events, %d words, %d postings (updated in %d ms)", Events, Terms, Postings, int(Timer.Elapsed()));
+          }
        }
   }
-  if (dump)
-     cSchedules::Dump();
+  if (dump) {
+     cTimeMs Timer;
+     if (Setup.EPGJournal && cSchedules::DumpJournal())
+        dsyslog("EPG data journal written in %d ms", int(Timer.Elapsed()));
+     else {
+        if (Setup.EPGBinaryData)
+           cSchedules::DumpSnapshot();
+        else
+           cSchedules::Dump();
+        dsyslog("EPG data written in %d ms", int(Timer.Elapsed()));
+        }
+     }
 }
 
 static cEpgDataWriter EpgDataWriter;
@@ -1284,16 +1821,113 @@ bool cSchedules::Dump(FILE *f, const char *Prefix, eDumpMode DumpMode, time_t At
   for (const cSchedule *p = Schedules->First(); p; p = Schedules->Next(p))
       p->Dump(Channels, f, Prefix, DumpMode, AtTime);
   if (sf) {
-     sf->Close();
+     if (sf->Close())
+        MarkSaved(Schedules, true);
      delete sf;
      }
   return true;
 }
 
+cString cSchedules::BaseFileName(void)
+{
+  return Setup.EPGBinaryData ? cString::sprintf("%s%s", epgDataFileName, EPGSNAPSHOTEXT) : cString(epgDataFileName);
+}
+
+cString cSchedules::JournalFileName(void)
+{
+  return cString::sprintf("%s%s", epgDataFileName, EPGJOURNALEXT);
+}
+
+void cSchedules::MarkSaved(const cSchedules *Schedules, bool Complete)
+{
+  for (const cSchedule *p = Schedules->First(); p; p = Schedules->Next(p))
+      p->savedState = p->modified;
+  // The journal's content is now contained in the EPG data file:
+  if (Complete && unlink(JournalFileName()) < 0 && errno != ENOENT)
+     LOG_ERROR_STR(*JournalFileName());
+}
+
+static bool IsNewer(const struct stat &st1, const struct stat &st2)
+{
+  return st1.st_mtim.tv_sec > st2.st_mtim.tv_sec || st1.st_mtim.tv_sec == st2.st_mtim.tv_sec && st1.st_mtim.tv_nsec > st2.st_mtim.tv_nsec;
+}
+
+bool cSchedules::DumpJournal(void)
+{
+  if (!epgDataFileName)
+     return false;
+  cString FileName = JournalFileName();
+  struct stat stbase;
+  if (stat(BaseFileName(), &stbase) != 0 || time(NULL) - stbase.st_mtime > EPGCOMPACTDELTA)
+     return false;
+  struct stat st;
+  if (stat(FileName, &st) == 0) {
+     // A journal that is older than the EPG data file is left over from an interrupted write:
+     if (!IsNewer(st, stbase) || st.st_size > stbase.st_size / 100 * EPGJOURNALMAXSIZE)
+        return false;
+     }
+  LOCK_CHANNELS_READ;
+  LOCK_SCHEDULES_READ;
+  int NumModified = 0;
+  for (const cSchedule *p = Schedules->First(); p; p = Schedules->Next(p)) {
+      if (p->savedState != p->modified)
+         NumModified++;
+      }
+  if (NumModified) {
+     FILE *f = fopen(FileName, "a");
+     if (!f) {
+        LOG_ERROR_STR(*FileName);
+        return false;
+        }
+     for (const cSchedule *p = Schedules->First(); p; p = Schedules->Next(p)) {
+         if (p->savedState != p->modified)
+            p->Dump(Channels, f);
+         }
+     bool Result = fflush(f) == 0 && fdatasync(fileno(f)) == 0;
+     if (fclose(f) != 0)
+        Result = false;
+     if (!Result) {
+        LOG_ERROR_STR(*FileName);
+        return false;
+        }
+     for (const cSchedule *p = Schedules->First(); p; p = Schedules->Next(p))
+         p->savedState = p->modified;
+     }
+  dsyslog("%d of %d schedules written to %s", NumModified, Schedules->Count(), *FileName);
+  return true;
+}
+
+bool cSchedules::ReadJournal(cSchedules *Schedules, const char *BaseFileName)
+{
+  if (!Setup.EPGJournal)
+     return true;
+  cString FileName = JournalFileName();
+  struct stat st;
+  if (stat(FileName, &st) != 0)
+     return true;
+  struct stat stbase;
+  if (stat(BaseFileName, &stbase) == 0 && !IsNewer(st, stbase)) {
+     isyslog("%s is older than %s - ignoring the former", *FileName, BaseFileName);
+     return true;
+     }
+  dsyslog("reading EPG data journal from %s", *FileName);
+  FILE *f = fopen(FileName, "r");
+  if (!f) {
+     LOG_ERROR_STR(*FileName);
+     return false;
+     }
+  // Every schedule in the journal replaces what has been read so far:
+  bool Result = cSchedule::Read(f, Schedules, true);
+  fclose(f);
+  return Result;
+}
+
 bool cSchedules::Read(FILE *f)
 {
   bool OwnFile = f == NULL;
   if (OwnFile) {
+     if (Setup.EPGBinaryData && ReadSnapshot())
+        return true;
      if (epgDataFileName && access(epgDataFileName, R_OK) == 0) {
         dsyslog("reading EPG data from %s", epgDataFileName);
         if ((f = fopen(epgDataFileName, "r")) == NULL) {
@@ -1304,19 +1938,179 @@ bool cSchedules::Read(FILE *f)
      else
         return false;
      }
+  cTimeMs Timer;
   LOCK_CHANNELS_WRITE;
   LOCK_SCHEDULES_WRITE;
   bool result = cSchedule::Read(f, Schedules);
-  if (OwnFile)
+  if (OwnFile) {
      fclose(f);
+     if (result) {
+        ReadJournal(Schedules, epgDataFileName);
+        MarkSaved(Schedules);
+        }
+     }
   if (result) {
      // Initialize the channels' schedule pointers, so that the first WhatsOn menu will come up faster:
      for (cChannel *Channel = Channels->First(); Channel; Channel = Channels->Next(Channel))
          Schedules->GetSchedule(Channel);
+     if (OwnFile)
+        dsyslog("EPG data read in %d ms", int(Timer.Elapsed()));
      }
   return result;
 }
 
+bool cSchedules::DumpSnapshot(void)
+{
+  if (!epgDataFileName)
+     return false;
+  cSafeFile f(cString::sprintf("%s%s", epgDataFileName, EPGSNAPSHOTEXT));
+  if (!f.Open()) {
+     LOG_ERROR;
+     return false;
+     }
+  cEpgSnapshotWriter Writer(f);
+  time_t Limit = time(NULL) - Setup.EPGLinger * 60;
+  {
+    LOCK_CHANNELS_READ;
+    LOCK_SCHEDULES_READ;
+    // Like Dump(), only schedules of known channels and events that haven't expired are written:
+    uint32_t NumSchedules = 0;
+    for (const cSchedule *p = Schedules->First(); p; p = Schedules->Next(p)) {
+        if (Channels->GetByChannelID(p->ChannelID(), true)) {
+           NumSchedules++;
+           const cList<cEvent> *Events = p->Events();
+           for (const cEvent *e = Events->First(); e; e = Events->Next(e)) {
+               if (e->EndTime() >= Limit)
+                  Writer.AddStrings(e);
+               }
+           }
+        }
+    Writer.Put(EPGSNAPSHOTMAGIC, 8);
+    Writer.Put32(EPGSNAPSHOTVERSION);
+    Writer.Put32(EPGSNAPSHOTBYTEORDER);
+    Writer.Put32(Writer.NumStrings());
+    Writer.Put32(NumSchedules);
+    Writer.PutStrings();
+    for (const cSchedule *p = Schedules->First(); p; p = Schedules->Next(p)) {
+        if (Channels->GetByChannelID(p->ChannelID(), true)) {
+           const cList<cEvent> *Events = p->Events();
+           uint32_t NumEvents = 0;
+           for (const cEvent *e = Events->First(); e; e = Events->Next(e)) {
+               if (e->EndTime() >= Limit)
+                  NumEvents++;
+               }
+           tChannelID ChannelID = p->ChannelID();
+           Writer.Put32(ChannelID.Source());
+           Writer.Put32(ChannelID.Nid());
+           Writer.Put32(ChannelID.Tid());
+           Writer.Put32(ChannelID.Sid());
+           Writer.Put32(ChannelID.Rid());
+           Writer.Put32(NumEvents);
+           for (const cEvent *e = Events->First(); e; e = Events->Next(e)) {
+               if (e->EndTime() >= Limit)
+                  Writer.PutEvent(e);
+               }
+           }
+        }
+    if (Writer.Error()) {
+       LOG_ERROR;
+       f.Close();
+       return false;
+       }
+    if (!f.Close())
+       return false;
+    MarkSaved(Schedules, true);
+  }
+  return true;
+}
+
+bool cSchedules::ReadSnapshot(void)
+{
+  if (!epgDataFileName)
+     return false;
+  cString FileName = cString::sprintf("%s%s", epgDataFileName, EPGSNAPSHOTEXT);
+  struct stat st;
+  if (stat(FileName, &st) != 0)
+     return false;
+  struct stat sttext;
+  if (stat(epgDataFileName, &sttext) == 0 && sttext.st_mtime > st.st_mtime) {
+     isyslog("%s is newer than %s - ignoring the latter", epgDataFileName, *FileName);
+     return false;
+     }
+  int fd = open(FileName, O_RDONLY);
+  if (fd < 0) {
+     LOG_ERROR_STR(*FileName);
+     return false;
+     }
+  void *Map = st.st_size > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (Map == MAP_FAILED) {
+     LOG_ERROR_STR(*FileName);
+     return false;
+     }
+  madvise(Map, st.st_size, MADV_SEQUENTIAL);
+  dsyslog("reading EPG data from %s", *FileName);
+  cTimeMs Timer;
+  cEpgSnapshotReader Reader((const uchar *)Map, st.st_size);
+  char Magic[8];
+  Reader.Get(Magic, sizeof(Magic));
+  uint32_t Version = Reader.Get32();
+  uint32_t ByteOrder = Reader.Get32();
+  uint32_t NumStrings = Reader.Get32();
+  uint32_t NumSchedules = Reader.Get32();
+  bool Result = false;
+  int NumEvents = 0;
+  if (Reader.Error() || memcmp(Magic, EPGSNAPSHOTMAGIC, sizeof(Magic)) != 0)
+     esyslog("ERROR: %s is not an EPG data snapshot", *FileName);
+  else if (Version != EPGSNAPSHOTVERSION || ByteOrder != EPGSNAPSHOTBYTEORDER)
+     isyslog("EPG data snapshot %s has version %u (expected %d), or a different byte order - ignored", *FileName, Version, EPGSNAPSHOTVERSION);
+  else {
+     Result = Reader.GetStrings(NumStrings);
+     for (uint32_t i = 0; Result && i < NumSchedules; i++) {
+         int Source = Reader.Get32();
+         int Nid = Reader.Get32();
+         int Tid = Reader.Get32();
+         int Sid = Reader.Get32();
+         int Rid = Reader.Get32();
+         uint32_t n = Reader.Get32();
+         if (Reader.Error())
+            break;
+         // Each schedule is made available as soon as it has been read:
+         LOCK_SCHEDULES_WRITE;
+         cSchedule *p = Schedules->AddSchedule(tChannelID(Source, Nid, Tid, Sid, Rid));
+         for (uint32_t e = 0; e < n; e++) {
+             if (cEvent *Event = Reader.GetEvent()) {
+                if (!p->GetEvent(Event->EventID(), Event->StartTime())) {
+                   p->AddEvent(Event);
+                   NumEvents++;
+                   }
+                else
+                   delete Event;
+                }
+             else {
+                Result = false;
+                break;
+                }
+             }
+         p->Sort();
+         }
+     if (!Result || Reader.Error())
+        esyslog("ERROR: EPG data snapshot %s is corrupted", *FileName);
+     }
+  munmap(Map, st.st_size);
+  if (Result) {
+     LOCK_CHANNELS_WRITE;
+     LOCK_SCHEDULES_WRITE;
+     ReadJournal(Schedules, FileName);
+     MarkSaved(Schedules);
+     // Initialize the channels' schedule pointers, so that the first WhatsOn menu will come up faster:
+     for (cChannel *Channel = Channels->First(); Channel; Channel = Channels->Next(Channel))
+         Schedules->GetSchedule(Channel);
+     dsyslog("read %d EPG events in %d ms", NumEvents, int(Timer.Elapsed()));
+     }
+  return Result;
+}
+
 cSchedule *cSchedules::AddSchedule(tChannelID ChannelID)
 {
   ChannelID.ClrRid();
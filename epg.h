@@ -64,12 +64,46 @@ public:
                                                                  // In case of an audio stream the 'type' check actually just distinguishes between "normal" and "Dolby Digital"
   };
 
+class cEpgStrings {
+private:
+  struct tEntry {
+    tEntry *next;
+    uint32_t hash;
+    int refs;
+    char text[1];
+    };
+  static cMutex mutex;
+  static tEntry **buckets;
+  static int numBuckets;
+  static int numStrings;
+  static int numReferences;
+  static size_t numBytes;
+  static void Rehash(int NumBuckets);
+public:
+  static const char *Get(const char *s);
+       ///< Returns a shared, reference counted copy of s, or NULL if s is NULL.
+       ///< Since the same text is used by many events (think of series titles),
+       ///< each distinct string is stored only once. The returned string must
+       ///< not be modified, and must be released by a call to Put().
+  static const char *Ref(const char *s);
+       ///< Adds a reference to s, which must have been returned by Get(), and
+       ///< returns s. This avoids looking up a string that is already known to
+       ///< be in the pool. The reference must be released by a call to Put().
+  static void Put(const char *s);
+       ///< Releases a string that has been returned by Get() or Ref(). s may be NULL.
+  static void GetStatistics(int &Strings, int &References, size_t &Bytes);
+       ///< Returns the number of distinct strings, the number of references to
+       ///< them and the number of bytes allocated for them.
+  };
+
 class cSchedule;
 
 typedef u_int32_t tEventID;
 
 class cEvent : public cListObject {
   friend class cSchedule;
+  friend class cEpgSnapshotReader;
+  friend class cEpgIndex;
 private:
   static cMutex numTimersMutex; // Protects numTimers, because it might be accessed from parallel read locks
   // The sequence of these parameters is optimized for minimal memory waste!
@@ -80,16 +114,18 @@ private:
   uchar version;           // Version number of section this event came from
   uchar runningStatus;     // 0=undefined, 1=not running, 2=starts in a few seconds, 3=pausing, 4=running
   uchar parentalRating;    // Parental rating of this event
-  char *title;             // Title of this event
-  char *shortText;         // Short description of this event (typically the episode name in case of a series)
-  char *description;       // Description of this event
+  mutable int indexId;     // The id of this event in cEpgIndex (0 if not indexed)
+  const char *title;       // Title of this event
+  const char *shortText;   // Short description of this event (typically the episode name in case of a series)
+  const char *description; // Description of this event
   cComponents *components; // The stream components of this event
   time_t startTime;        // Start time of this event
   int duration;            // Duration of this event in seconds
   uchar contents[MaxEventContents]; // Contents of this event
   time_t vps;              // Video Programming Service timestamp (VPS, aka "Programme Identification Label", PIL)
   time_t seen;             // When this event was last seen in the data stream
-  char *aux;               // Auxiliary data, for use with plugins
+  const char *aux;         // Auxiliary data, for use with plugins
+  // All of the above strings are shared through cEpgStrings!
 public:
   cEvent(tEventID EventID);
   ~cEvent();
@@ -148,16 +184,33 @@ public:
 class cSchedules;
 
 class cSchedule : public cListObject  {
+  friend class cEvent;
+  friend class cSchedules;
 private:
   static cMutex numTimersMutex; // Protects numTimers, because it might be accessed from parallel read locks
+  static cMutex indexMutex; // Protects the time index, because it might be built from parallel read locks
   tChannelID channelID;
   cList<cEvent> events;
   cHash<cEvent> eventsHashID;
   cHash<cEvent> eventsHashStartTime;
+  mutable cVector<cEvent *> eventsByTime; // All events, sorted by their start times
+  mutable int maxDuration;    // The longest duration of any of the events in eventsByTime
+  mutable bool indexValid;
+  mutable const cEvent *presentEvent; // Cached result of GetPresentEvent()...
+  mutable time_t presentValidUntil;   // ...which remains valid until this time
   mutable u_int16_t numTimers;// The number of timers that use this schedule
   bool hasRunning;
   int modified;
+  mutable int savedState;     // The value of 'modified' when this schedule was last written to the EPG data file
   time_t presentSeen;
+  void InvalidateIndex(void) { indexValid = false; presentValidUntil = 0; }
+  void InvalidatePresent(void) { presentValidUntil = 0; }
+  void UpdateIndex(void) const;
+       ///< Rebuilds eventsByTime if necessary. indexMutex must be locked.
+  int FirstStartingAfter(time_t Time) const;
+       ///< Returns the index (in eventsByTime) of the first event that starts after
+       ///< the given Time, or eventsByTime.Size() if there is no such event.
+       ///< indexMutex must be locked and the index must be up to date.
 public:
   cSchedule(tChannelID ChannelID);
   tChannelID ChannelID(void) const { return channelID; }
@@ -171,7 +224,11 @@ public:
   void ResetVersions(void);
   void Sort(void);
   void DropOutdated(time_t SegmentStart, time_t SegmentEnd, uchar TableID, uchar Version);
-  void Cleanup(time_t Time);
+  bool Cleanup(time_t Time, const cTimeMs *Timeout = NULL);
+       ///< Deletes all events that have ended before the given Time (taking
+       ///< Setup.EPGLinger into account), except for events that have timers.
+       ///< If Timeout is given, this function stops as soon as Timeout has timed out.
+       ///< Returns true if all such events have been deleted.
   void Cleanup(void);
   void IncNumTimers(void) const;
   void DecNumTimers(void) const;
@@ -186,7 +243,9 @@ public:
   const cEvent *GetEvent(tEventID EventID, time_t StartTime = 0) const;
   const cEvent *GetEventAround(time_t Time) const;
   void Dump(const cChannels *Channels, FILE *f, const char *Prefix = "", eDumpMode DumpMode = dmAll, time_t AtTime = 0) const;
-  static bool Read(FILE *f, cSchedules *Schedules);
+  static bool Read(FILE *f, cSchedules *Schedules, bool Replace = false);
+       ///< Reads schedules from the given file f. If Replace is true, the events
+       ///< of a schedule are cleared before the events from f are read into it.
   };
 
 class cSchedules : public cList<cSchedule> {
@@ -195,6 +254,10 @@ private:
   static cSchedules schedules;
   static char *epgDataFileName;
   static time_t lastDump;
+  static cString BaseFileName(void);
+  static cString JournalFileName(void);
+  static void MarkSaved(const cSchedules *Schedules, bool Complete = false);
+  static bool ReadJournal(cSchedules *Schedules, const char *BaseFileName);
 public:
   cSchedules(void);
   static const cSchedules *GetSchedulesRead(cStateKey &StateKey, int TimeoutMs = 0);
@@ -208,6 +271,22 @@ public:
   static void ResetVersions(void);
   static bool Dump(FILE *f = NULL, const char *Prefix = "", eDumpMode DumpMode = dmAll, time_t AtTime = 0);
   static bool Read(FILE *f = NULL);
+  static bool DumpSnapshot(void);
+      ///< Writes all schedules into the binary EPG data snapshot, which is stored
+      ///< next to the EPG data file (with the extension ".bin" appended). This is
+      ///< much faster to write and read than the text format, but is not meant
+      ///< for exchanging data (that's what Dump() and Read() are for).
+  static bool DumpJournal(void);
+      ///< Appends all schedules that have been modified since they were last
+      ///< written to the journal of the EPG data file. Returns false if there is
+      ///< no journal, or if it has grown too large, in which case the caller
+      ///< shall write the entire EPG data by means of Dump() or DumpSnapshot().
+      ///< A complete write removes the journal.
+  static bool ReadSnapshot(void);
+      ///< Reads the binary EPG data snapshot written by DumpSnapshot(). The
+      ///< schedules are created one by one, and the lock on the schedules is
+      ///< released in between, so that the EPG is available for the schedules
+      ///< read so far. Returns false if there is no valid snapshot.
   cSchedule *AddSchedule(tChannelID ChannelID);
   const cSchedule *GetSchedule(tChannelID ChannelID) const;
   const cSchedule *GetSchedule(const cChannel *Channel, bool AddIfMissing = false) const;
@@ -0,0 +1,532 @@
+/*
+ * epgindex.c: Full text index of the EPG data
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+#include "epgindex.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <wctype.h>
+#include "config.h"
+
+#define EPGINDEXMINBUCKETS  4096
+#define EPGINDEXMINWORD        2 // words with fewer characters are not indexed
+#define EPGINDEXMAXWORD       32 // only this many characters of a word are significant
+#define EPGINDEXMAXSTALE      50 // percent of outdated postings before the index is rebuilt
+#define EPGINDEXMINREBUILD 100000 // minimum number of outdated postings or unused ids before the index is rebuilt
+
+// --- cEpgWords -------------------------------------------------------------
+
+// Splits a text into words. A word is a sequence of letters and digits,
+// which is converted to lower case.
+
+class cEpgWords {
+private:
+  const char *s;
+  int length;
+  char word[Utf8BufSize(EPGINDEXMAXWORD) + 1];
+  static bool IsWordSymbol(uint c) { return Utf8is(alnum, c); }
+public:
+  cEpgWords(const char *Text) { s = Text ? Text : ""; length = 0; *word = 0; }
+  const char *Next(void);
+       ///< Returns the next word, or NULL if there are no more words.
+  int Length(void) const { return length; }
+       ///< Returns the number of characters of the word returned by the last call to Next().
+  };
+
+const char *cEpgWords::Next(void)
+{
+  for (;;) {
+      if (!*s)
+         return NULL;
+      int l = Utf8CharLen(s);
+      if (IsWordSymbol(Utf8CharGet(s, l)))
+         break;
+      s += l;
+      }
+  char *p = word;
+  length = 0;
+  while (*s) {
+        int l = Utf8CharLen(s);
+        uint c = Utf8CharGet(s, l);
+        if (!IsWordSymbol(c))
+           break;
+        s += l;
+        if (length < EPGINDEXMAXWORD) {
+           p += Utf8CharSet(Utf8to(lower, c), p);
+           length++;
+           }
+        }
+  *p = 0;
+  return word;
+}
+
+// --- cEpgIndex -------------------------------------------------------------
+
+cMutex cEpgIndex::mutex;
+bool cEpgIndex::enabled = false;
+cEpgIndex::tTerm **cEpgIndex::buckets = NULL;
+int cEpgIndex::numBuckets = 0;
+int cEpgIndex::numTerms = 0;
+int cEpgIndex::numPostings = 0;
+int cEpgIndex::numLivePostings = 0;
+cEpgIndex::tEntry *cEpgIndex::entries = NULL;
+int cEpgIndex::numEntries = 0;
+int cEpgIndex::allocatedEntries = 0;
+int cEpgIndex::numEvents = 0;
+int cEpgIndex::numDirty = 0;
+
+static uint32_t EpgWordHash(const char *s)
+{
+  // FNV-1a
+  uint32_t Hash = 2166136261U;
+  while (*s)
+        Hash = (Hash ^ uchar(*s++)) * 16777619U;
+  return Hash;
+}
+
+void cEpgIndex::ClearTerms(void)
+{
+  for (int i = 0; i < numBuckets; i++) {
+      while (tTerm *t = buckets[i]) {
+            buckets[i] = t->next;
+            free(t->postings);
+            free(t);
+            }
+      }
+  free(buckets);
+  buckets = NULL;
+  numBuckets = 0;
+  numTerms = 0;
+  numPostings = 0;
+}
+
+void cEpgIndex::Clear(void)
+{
+  for (int i = 1; i < numEntries; i++) {
+      if (entries[i].event)
+         entries[i].event->indexId = 0;
+      }
+  ClearTerms();
+  free(entries);
+  entries = NULL;
+  numEntries = 0;
+  allocatedEntries = 0;
+  numEvents = 0;
+  numDirty = 0;
+  numLivePostings = 0;
+}
+
+void cEpgIndex::Rebuild(void)
+{
+  // Drops all postings and gives the events new ids without gaps:
+  ClearTerms();
+  int n = 1;
+  for (int i = 1; i < numEntries; i++) {
+      if (const cEvent *Event = entries[i].event) {
+         Event->indexId = n;
+         entries[n].event = Event;
+         entries[n].numPostings = 0;
+         entries[n].dirty = true;
+         n++;
+         }
+      }
+  numEntries = n;
+  numDirty = numEvents;
+  numLivePostings = 0;
+}
+
+void cEpgIndex::Rehash(int NumBuckets)
+{
+  tTerm **NewBuckets = (tTerm **)calloc(NumBuckets, sizeof(tTerm *));
+  if (!NewBuckets)
+     return; // we'll just have to live with longer chains
+  for (int i = 0; i < numBuckets; i++) {
+      while (tTerm *t = buckets[i]) {
+            buckets[i] = t->next;
+            t->next = NewBuckets[t->hash % NumBuckets];
+            NewBuckets[t->hash % NumBuckets] = t;
+            }
+      }
+  free(buckets);
+  buckets = NewBuckets;
+  numBuckets = NumBuckets;
+}
+
+cEpgIndex::tTerm *cEpgIndex::GetTerm(const char *Word, bool Create)
+{
+  uint32_t Hash = EpgWordHash(Word);
+  if (numBuckets) {
+     for (tTerm *t = buckets[Hash % numBuckets]; t; t = t->next) {
+         if (t->hash == Hash && strcmp(t->word, Word) == 0)
+            return t;
+         }
+     }
+  if (!Create)
+     return NULL;
+  if (numTerms >= numBuckets)
+     Rehash(max(numBuckets * 2, EPGINDEXMINBUCKETS));
+  if (!numBuckets)
+     return NULL;
+  size_t Length = strlen(Word);
+  tTerm *t = (tTerm *)malloc(offsetof(tTerm, word) + Length + 1);
+  if (!t) {
+     esyslog("ERROR: out of memory");
+     return NULL;
+     }
+  memcpy(t->word, Word, Length + 1);
+  t->hash = Hash;
+  t->postings = NULL;
+  t->numPostings = 0;
+  t->allocated = 0;
+  t->next = buckets[Hash % numBuckets];
+  buckets[Hash % numBuckets] = t;
+  numTerms++;
+  return t;
+}
+
+void cEpgIndex::MarkDirty(int Id)
+{
+  tEntry *e = &entries[Id];
+  numLivePostings -= e->numPostings;
+  e->numPostings = 0;
+  if (!e->dirty) {
+     e->dirty = true;
+     numDirty++;
+     }
+}
+
+void cEpgIndex::AddEvent(const cEvent *Event)
+{
+  if (!numEntries)
+     numEntries = 1; // id 0 means "not indexed"
+  if (numEntries >= allocatedEntries) {
+     int NewAllocated = max(allocatedEntries * 2, EPGINDEXMINBUCKETS);
+     tEntry *NewEntries = (tEntry *)realloc(entries, NewAllocated * sizeof(tEntry));
+     if (!NewEntries) {
+        esyslog("ERROR: out of memory");
+        return;
+        }
+     entries = NewEntries;
+     allocatedEntries = NewAllocated;
+     }
+  int Id = numEntries++;
+  entries[Id].event = Event;
+  entries[Id].numPostings = 0;
+  entries[Id].dirty = false;
+  Event->indexId = Id;
+  numEvents++;
+  MarkDirty(Id);
+}
+
+void cEpgIndex::IndexEvent(int Id)
+{
+  const cEvent *Event = entries[Id].event;
+  const char *Texts[] = { Event->Title(), Event->ShortText(), Event->Description() };
+  int n = 0;
+  for (unsigned int i = 0; i < sizeof(Texts) / sizeof(Texts[0]); i++) {
+      cEpgWords Words(Texts[i]);
+      while (const char *w = Words.Next()) {
+            if (Words.Length() < EPGINDEXMINWORD)
+               continue;
+            tTerm *t = GetTerm(w, true);
+            if (!t)
+               break;
+            if (t->numPostings && t->postings[t->numPostings - 1] == Id)
+               continue; // this word has already been seen in this event
+            if (t->numPostings >= t->allocated) {
+               int NewAllocated = max(t->allocated * 2, 4);
+               int *NewPostings = (int *)realloc(t->postings, NewAllocated * sizeof(int));
+               if (!NewPostings) {
+                  esyslog("ERROR: out of memory");
+                  break;
+                  }
+               t->postings = NewPostings;
+               t->allocated = NewAllocated;
+               }
+            t->postings[t->numPostings++] = Id;
+            n++;
+            }
+      }
+  entries[Id].numPostings = n;
+  numPostings += n;
+  numLivePostings += n;
+}
+
+int cEpgIndex::GetPostings(const char *Word, bool Prefix, cVector<int> *Ids)
+{
+  int n = 0;
+  if (Prefix) {
+     size_t Length = strlen(Word);
+     for (int i = 0; i < numBuckets; i++) {
+         for (tTerm *t = buckets[i]; t; t = t->next) {
+             if (strncmp(t->word, Word, Length) == 0) {
+                n += t->numPostings;
+                for (int j = 0; Ids && j < t->numPostings; j++)
+                    Ids->Append(t->postings[j]);
+                }
+             }
+         }
+     }
+  else if (tTerm *t = GetTerm(Word, false)) {
+     n = t->numPostings;
+     for (int j = 0; Ids && j < t->numPostings; j++)
+         Ids->Append(t->postings[j]);
+     }
+  return n;
+}
+
+void cEpgIndex::Add(const cEvent *Event)
+{
+  if (!enabled)
+     return;
+  cMutexLock MutexLock(&mutex);
+  if (enabled && !Event->indexId)
+     AddEvent(Event);
+}
+
+void cEpgIndex::Del(const cEvent *Event)
+{
+  if (!Event->indexId)
+     return;
+  cMutexLock MutexLock(&mutex);
+  int Id = Event->indexId;
+  if (Id < numEntries && entries[Id].event == Event) {
+     numLivePostings -= entries[Id].numPostings;
+     entries[Id].numPostings = 0;
+     entries[Id].event = NULL;
+     numEvents--;
+     }
+  Event->indexId = 0;
+}
+
+void cEpgIndex::Changed(const cEvent *Event)
+{
+  if (!Event->indexId)
+     return;
+  cMutexLock MutexLock(&mutex);
+  int Id = Event->indexId;
+  if (Id < numEntries && entries[Id].event == Event)
+     MarkDirty(Id);
+}
+
+void cEpgIndex::Update(const cSchedules *Schedules, bool Build)
+{
+  cMutexLock MutexLock(&mutex);
+  if (enabled && !Setup.EPGIndex) {
+     Clear();
+     enabled = false;
+     }
+  else if (!enabled && Setup.EPGIndex && Build) {
+     // The index is only built when it is needed, so it takes no memory on systems that never search the EPG data:
+     dsyslog("EPG index: building");
+     Clear();
+     enabled = true;
+     for (const cSchedule *Schedule = Schedules->First(); Schedule; Schedule = Schedules->Next(Schedule)) {
+         for (const cEvent *Event = Schedule->Events()->First(); Event; Event = Schedule->Events()->Next(Event))
+             AddEvent(Event);
+         }
+     }
+  if (!enabled)
+     return;
+  if (numPostings > EPGINDEXMINREBUILD && int64_t(numPostings - numLivePostings) * 100 > int64_t(numPostings) * EPGINDEXMAXSTALE ||
+      numEntries - numEvents > max(numEvents, EPGINDEXMINREBUILD)) {
+     // Too many postings refer to deleted events or outdated texts:
+     dsyslog("EPG index: rebuilding (%d of %d postings outdated, %d of %d ids unused)", numPostings - numLivePostings, numPostings, numEntries - numEvents, numEntries);
+     Rebuild();
+     }
+  if (numDirty) {
+     for (int i = 1; i < numEntries; i++) {
+         if (entries[i].dirty) {
+            entries[i].dirty = false;
+            if (entries[i].event)
+               IndexEvent(i);
+            }
+         }
+     numDirty = 0;
+     }
+}
+
+void cEpgIndex::GetStatistics(int &Events, int &Terms, int &Postings)
+{
+  cMutexLock MutexLock(&mutex);
+  Events = numEvents;
+  Terms = numTerms;
+  Postings = numPostings;
+}
+
+// --- cEpgQuery -------------------------------------------------------------
+
+cEpgQuery::cEpgQuery(const char *Text, int Fields)
+{
+  fields = Fields;
+  from = 0;
+  to = 0;
+  content = 0;
+  SetText(Text);
+}
+
+cEpgQuery::~cEpgQuery()
+{
+  ClearTerms();
+}
+
+void cEpgQuery::ClearTerms(void)
+{
+  for (int i = 0; i < terms.Size(); i++)
+      delete terms[i];
+  terms.Clear();
+}
+
+void cEpgQuery::SetText(const char *Text)
+{
+  ClearTerms();
+  const char *p = Text;
+  while (p && *(p = skipspace(p))) {
+        const char *End;
+        if (*p == '"') {
+           p++;
+           End = strchrnul(p, '"');
+           }
+        else
+           End = p + strcspn(p, " \t\n");
+        cString Part(p, End);
+        const char *e = End;
+        while (e > p && isspace(*(e - 1)))
+              e--;
+        tTerm *Term = new tTerm;
+        Term->prefix = e > p && *(e - 1) == '*';
+        p = *End ? End + 1 : End;
+        cEpgWords Words(Part);
+        while (const char *w = Words.Next())
+              Term->words.Append(strdup(w));
+        if (Term->words.Size())
+           terms.Append(Term);
+        else
+           delete Term;
+        }
+}
+
+bool cEpgQuery::Matches(const char *Text, const tTerm *Term) const
+{
+  int n = Term->words.Size();
+  cEpgWords Words(Text);
+  while (const char *w = Words.Next()) {
+        cEpgWords Following = Words;
+        int i = 0;
+        for (; i < n; i++) {
+            if (i && !(w = Following.Next()))
+               return false;
+            if (Term->prefix && i == n - 1 ? !startswith(w, Term->words[i]) : strcmp(w, Term->words[i]) != 0)
+               break;
+            }
+        if (i == n)
+           return true;
+        }
+  return false;
+}
+
+bool cEpgQuery::Matches(const cEvent *Event) const
+{
+  if (from && Event->EndTime() <= from)
+     return false;
+  if (to && Event->StartTime() >= to)
+     return false;
+  if (channelID.Valid() && !(Event->ChannelID() == channelID))
+     return false;
+  if (content) {
+     for (int i = 0; ; i++) {
+         uchar c = Event->Contents(i);
+         if (!c)
+            return false;
+         if (c == content || (content & 0x0F) == 0 && (c & 0xF0) == content)
+            break;
+         }
+     }
+  for (int i = 0; i < terms.Size(); i++) {
+      const tTerm *Term = terms[i];
+      if (!((fields & eqfTitle) && Event->Title() && Matches(Event->Title(), Term) ||
+            (fields & eqfShortText) && Event->ShortText() && Matches(Event->ShortText(), Term) ||
+            (fields & eqfDescription) && Event->Description() && Matches(Event->Description(), Term)))
+         return false;
+      }
+  return true;
+}
+
+bool cEpgQuery::GetCandidates(cVector<const cEvent *> &Candidates) const
+{
+  cMutexLock MutexLock(&cEpgIndex::mutex);
+  if (!cEpgIndex::enabled)
+     return false;
+  // Use the word with the fewest postings:
+  const char *Word = NULL;
+  bool Prefix = false;
+  int Count = 0;
+  for (int i = 0; i < terms.Size(); i++) {
+      const tTerm *Term = terms[i];
+      for (int j = 0; j < Term->words.Size(); j++) {
+          const char *w = Term->words[j];
+          bool p = Term->prefix && j == Term->words.Size() - 1;
+          if (Utf8StrLen(w) < EPGINDEXMINWORD)
+             continue; // not in the index
+          int n = cEpgIndex::GetPostings(w, p, NULL);
+          if (!Word || n < Count) {
+             Word = w;
+             Prefix = p;
+             Count = n;
+             }
+          }
+      }
+  if (!Word)
+     return false;
+  cVector<int> Ids(max(Count, 10));
+  cEpgIndex::GetPostings(Word, Prefix, &Ids);
+  Ids.Sort(CompareInts);
+  for (int i = 0; i < Ids.Size(); i++) {
+      if (i && Ids[i] == Ids[i - 1])
+         continue;
+      if (const cEvent *Event = cEpgIndex::entries[Ids[i]].event)
+         Candidates.Append(Event);
+      }
+  return true;
+}
+
+static int CompareEvents(const void *a, const void *b)
+{
+  const cEvent *ea = *(const cEvent **)a;
+  const cEvent *eb = *(const cEvent **)b;
+  if (ea->Schedule() != eb->Schedule())
+     return uintptr_t(ea->Schedule()) < uintptr_t(eb->Schedule()) ? -1 : 1;
+  if (ea->StartTime() != eb->StartTime())
+     return ea->StartTime() < eb->StartTime() ? -1 : 1;
+  return 0;
+}
+
+int cEpgQuery::Find(const cSchedules *Schedules, cVector<const cEvent *> &Events) const
+{
+  Events.Clear();
+  cEpgIndex::Update(Schedules, true);
+  cVector<const cEvent *> Candidates;
+  if (GetCandidates(Candidates)) {
+     for (int i = 0; i < Candidates.Size(); i++) {
+         if (Matches(Candidates[i]))
+            Events.Append(Candidates[i]);
+         }
+     }
+  else {
+     for (const cSchedule *Schedule = Schedules->First(); Schedule; Schedule = Schedules->Next(Schedule)) {
+         if (channelID.Valid() && !(Schedule->ChannelID() == channelID))
+            continue;
+         for (const cEvent *Event = Schedule->Events()->First(); Event; Event = Schedule->Events()->Next(Event)) {
+             if (Matches(Event))
+                Events.Append(Event);
+             }
+         }
+     }
+  Events.Sort(CompareEvents);
+  return Events.Size();
+}
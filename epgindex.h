@@ -0,0 +1,119 @@
+/*
+ * epgindex.h: Full text index of the EPG data
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+#ifndef __EPGINDEX_H
+#define __EPGINDEX_H
+
+#include "epg.h"
+
+enum eEpgQueryFields { eqfTitle       = 0x01,
+                       eqfShortText   = 0x02,
+                       eqfDescription = 0x04,
+                       eqfAll         = eqfTitle | eqfShortText | eqfDescription
+                     };
+
+class cEpgIndex {
+  friend class cEpgQuery;
+private:
+  struct tTerm {
+    tTerm *next;
+    uint32_t hash;
+    int *postings; // The ids of the events that contain this word
+    int numPostings;
+    int allocated;
+    char word[1];
+    };
+  struct tEntry {
+    const cEvent *event; // NULL if the event has been deleted
+    int numPostings;     // The number of postings for the current texts of the event
+    bool dirty;          // The texts of the event still need to be indexed
+    };
+  static cMutex mutex;
+  static bool enabled;
+  static tTerm **buckets;
+  static int numBuckets;
+  static int numTerms;
+  static int numPostings;
+  static int numLivePostings;
+  static tEntry *entries; // Indexed by the events' ids (0 is not used)
+  static int numEntries;
+  static int allocatedEntries;
+  static int numEvents;
+  static int numDirty;
+  static void Clear(void);
+  static void ClearTerms(void);
+  static void Rebuild(void);
+  static void Rehash(int NumBuckets);
+  static tTerm *GetTerm(const char *Word, bool Create);
+  static void AddEvent(const cEvent *Event);
+  static void MarkDirty(int Id);
+  static void IndexEvent(int Id);
+  static int GetPostings(const char *Word, bool Prefix, cVector<int> *Ids);
+public:
+  static void Add(const cEvent *Event);
+       ///< Adds the given Event to the index. Its texts are indexed with the next
+       ///< call to Update(). Called by cSchedule::AddEvent().
+  static void Del(const cEvent *Event);
+       ///< Removes the given Event from the index.
+  static void Changed(const cEvent *Event);
+       ///< Tells the index that the texts of the given Event have changed.
+  static void Update(const cSchedules *Schedules, bool Build = false);
+       ///< Indexes the texts of all events that have been added or changed since
+       ///< the last call. If there is no index yet, it is only built (from all events
+       ///< in Schedules) if Build is true and indexing is turned on (see Setup.EPGIndex).
+       ///< If indexing has been turned off, the index is dropped.
+       ///< The caller must hold a lock on Schedules.
+  static bool Enabled(void) { return enabled; }
+  static void GetStatistics(int &Events, int &Terms, int &Postings);
+       ///< Returns the number of indexed events, the number of distinct words and
+       ///< the number of references from words to events.
+  };
+
+class cEpgQuery {
+private:
+  struct tTerm {
+    cStringList words;
+    bool prefix; // The last word matches all words that start with it
+    };
+  cVector<tTerm *> terms;
+  int fields;
+  time_t from;
+  time_t to;
+  tChannelID channelID;
+  uchar content;
+  void ClearTerms(void);
+  bool Matches(const char *Text, const tTerm *Term) const;
+  bool Matches(const cEvent *Event) const;
+  bool GetCandidates(cVector<const cEvent *> &Candidates) const;
+public:
+  cEpgQuery(const char *Text = NULL, int Fields = eqfAll);
+  ~cEpgQuery();
+  void SetText(const char *Text);
+       ///< Sets the Text to search for. Every word in Text must occur in one of the
+       ///< searched fields of an event, in any order. A sequence of words that is
+       ///< enclosed in double quotes must occur in exactly that order, and a word
+       ///< that ends with '*' matches every word that starts with it. Case is ignored.
+  void SetFields(int Fields) { fields = Fields; }
+       ///< Sets the fields of the events that are searched (see eEpgQueryFields).
+  void SetTimeRange(time_t From, time_t To) { from = From; to = To; }
+       ///< Restricts the result to events that overlap the time between From and To.
+       ///< Either of them may be 0 to leave that end of the range open.
+  void SetChannel(tChannelID ChannelID) { channelID = ChannelID.ClrRid(); }
+       ///< Restricts the result to events of the given channel.
+  void SetContent(uchar Content) { content = Content; }
+       ///< Restricts the result to events with the given Content (see cEvent::Contents()).
+       ///< If the lower nibble of Content is 0, all contents of that group match.
+  int Find(const cSchedules *Schedules, cVector<const cEvent *> &Events) const;
+       ///< Puts all events from Schedules that match this query into Events, grouped
+       ///< by schedule and sorted by start time, and returns their number. If Setup.EPGIndex
+       ///< is set, the index is used to find the events (it is built with the first call),
+       ///< otherwise all events are searched. The caller must hold a lock on Schedules.
+  };
+
+#endif //__EPGINDEX_H
@@ -53,6 +53,13 @@ bool cSectionSyncer::Sync(uchar Version, int Number, int LastNumber)
   return Result;
 }
 
+bool cSectionSyncer::Check(uchar Version, int Number)
+{
+  if (Version != currentVersion || !synced)
+     return Number == 0; // Sync() would (re)start with section 0
+  return !GetSectionFlag(Number);
+}
+
 // --- cFilterData -----------------------------------------------------------
 
 cFilterData::cFilterData(void)
@@ -28,6 +28,11 @@ public:
   void Repeat(void);
   bool Complete(void) { return complete; }
   bool Sync(uchar Version, int Number, int LastNumber);
+  bool Check(uchar Version, int Number);
+       ///< Returns true if a section with the given Version and Number would be
+       ///< processed by a call to Sync(), without changing the state of this
+       ///< syncer. This allows skipping sections that have already been seen
+       ///< without having to verify their CRC and parse them first.
   };
 
 class cFilterData : public cListObject {
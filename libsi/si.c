@@ -14,6 +14,7 @@
 #include <errno.h>
 #include <iconv.h>
 #include <malloc.h>
+#include <pthread.h>
 #include <stdlib.h> // for broadcaster stupidity workaround
 #include <string.h>
 #include "descriptor.h"
@@ -313,18 +314,201 @@ static const char *CharacterTables2[] = {
 
 static char *SystemCharacterTable = NULL;
 bool SystemCharacterTableIsSingleByte = true;
+static bool SystemCharacterTableIsUtf8 = false;
 
 bool systemCharacterTableIsSingleByte(void)
 {
   return SystemCharacterTableIsSingleByte;
 }
 
+// Most SI texts are in character tables where every character is encoded in a single
+// byte (ISO6937 additionally allows a non-spacing diacritical mark in front of a letter).
+// Such texts are converted into the system character table through lookup tables, which
+// are filled by iconv itself whenever the system character table is set, so that the
+// result is exactly what iconv would have produced. UTF-8 texts are only checked for
+// validity if the system character table is UTF-8, too. All other conversions are done
+// by iconv, but the iconv handles are kept for reuse.
+
+#define MaxConversionTables 40
+#define MaxConversionPrefixes 16 // character tables with more prefix bytes are handled by iconv
+#define MaxConversionLength 7
+
+struct ConversionEntry {
+   enum { Invalid, Prefix, Valid } type;
+   unsigned char length;
+   char text[MaxConversionLength];
+};
+
+struct ConversionTable {
+   char *fromCode;
+   bool asciiCompatible; // the characters 0x00..0x7F map to themselves
+   ConversionEntry single[256];
+   ConversionEntry *pairs[256]; // for prefix bytes, indexed by the following byte
+};
+
+static ConversionTable *ConversionTables[MaxConversionTables] = { NULL };
+static int NumConversionTables = 0;
+
+// Returns false if iconv's result is something the lookup tables can't represent:
+static bool convertSequence(iconv_t cd, const unsigned char *from, size_t fromLength, ConversionEntry &Entry)
+{
+   iconv(cd, NULL, NULL, NULL, NULL); // resets the conversion state
+   char *fromPtr = (char *)from;
+   char *toPtr = Entry.text;
+   size_t toLength = sizeof(Entry.text);
+   if (iconv(cd, &fromPtr, &fromLength, &toPtr, &toLength) != size_t(-1)) {
+      Entry.type = ConversionEntry::Valid;
+      Entry.length = toPtr - Entry.text;
+      return fromLength == 0 && Entry.length > 0;
+   }
+   Entry.type = errno == EILSEQ ? ConversionEntry::Invalid : ConversionEntry::Prefix;
+   return (errno == EILSEQ || errno == EINVAL) && fromPtr == (char *)from;
+}
+
+static void deleteConversionTable(ConversionTable *Table)
+{
+   for (int i = 0; i < 256; i++)
+      delete[] Table->pairs[i];
+   free(Table->fromCode);
+   delete Table;
+}
+
+static ConversionTable *buildConversionTable(const char *fromCode)
+{
+   iconv_t cd = iconv_open(SystemCharacterTable, fromCode);
+   if (cd == (iconv_t)-1)
+      return NULL;
+   ConversionTable *Table = new ConversionTable;
+   memset(Table, 0, sizeof(*Table));
+   Table->fromCode = strdup(fromCode);
+   bool ok = true;
+   int NumPrefixes = 0;
+   for (int i = 0; ok && i < 256; i++) {
+      unsigned char b[2] = { (unsigned char)i, 0 };
+      ok = convertSequence(cd, b, 1, Table->single[i]);
+      if (ok && Table->single[i].type == ConversionEntry::Prefix) {
+         if (++NumPrefixes > MaxConversionPrefixes)
+            ok = false;
+         else {
+            Table->pairs[i] = new ConversionEntry[256];
+            for (int j = 0; ok && j < 256; j++) {
+               b[1] = j;
+               ok = convertSequence(cd, b, 2, Table->pairs[i][j]);
+               // A prefix followed by another prefix is just as invalid as any other illegal sequence:
+               if (ok && Table->pairs[i][j].type == ConversionEntry::Prefix)
+                  Table->pairs[i][j].type = ConversionEntry::Invalid;
+            }
+         }
+      }
+   }
+   iconv_close(cd);
+   if (!ok) {
+      deleteConversionTable(Table);
+      return NULL;
+   }
+   Table->asciiCompatible = true;
+   for (int i = 0; i < 0x80; i++) {
+      const ConversionEntry &e = Table->single[i];
+      if (e.type != ConversionEntry::Valid || e.length != 1 || e.text[0] != char(i)) {
+         Table->asciiCompatible = false;
+         break;
+      }
+   }
+   return Table;
+}
+
+static void addConversionTable(const char *fromCode)
+{
+   if (!fromCode || NumConversionTables >= MaxConversionTables)
+      return;
+   for (int i = 0; i < NumConversionTables; i++) {
+      if (strcmp(ConversionTables[i]->fromCode, fromCode) == 0)
+         return;
+   }
+   if (ConversionTable *Table = buildConversionTable(fromCode))
+      ConversionTables[NumConversionTables++] = Table;
+}
+
+static const ConversionTable *getConversionTable(const char *fromCode)
+{
+   for (int i = 0; i < NumConversionTables; i++) {
+      if (strcmp(ConversionTables[i]->fromCode, fromCode) == 0)
+         return ConversionTables[i];
+   }
+   return NULL;
+}
+
+// iconv handles that are currently not in use:
+struct IconvHandle {
+   char *fromCode;
+   iconv_t cd;
+   IconvHandle *next;
+};
+
+static IconvHandle *IconvHandles = NULL;
+static pthread_mutex_t IconvHandlesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static iconv_t getIconvHandle(const char *fromCode)
+{
+   pthread_mutex_lock(&IconvHandlesMutex);
+   for (IconvHandle **p = &IconvHandles; *p; p = &(*p)->next) {
+      if (strcmp((*p)->fromCode, fromCode) == 0) {
+         IconvHandle *h = *p;
+         *p = h->next;
+         pthread_mutex_unlock(&IconvHandlesMutex);
+         iconv_t cd = h->cd;
+         free(h->fromCode);
+         delete h;
+         iconv(cd, NULL, NULL, NULL, NULL); // resets the conversion state
+         return cd;
+      }
+   }
+   pthread_mutex_unlock(&IconvHandlesMutex);
+   return iconv_open(SystemCharacterTable, fromCode);
+}
+
+static void putIconvHandle(const char *fromCode, iconv_t cd)
+{
+   IconvHandle *h = new IconvHandle;
+   h->fromCode = strdup(fromCode);
+   h->cd = cd;
+   pthread_mutex_lock(&IconvHandlesMutex);
+   h->next = IconvHandles;
+   IconvHandles = h;
+   pthread_mutex_unlock(&IconvHandlesMutex);
+}
+
 static char *OverrideCharacterTable = NULL;
 
+// Must be called whenever SystemCharacterTable or OverrideCharacterTable has been changed:
+static void initConversions(void)
+{
+   pthread_mutex_lock(&IconvHandlesMutex);
+   while (IconvHandle *h = IconvHandles) {
+      IconvHandles = h->next;
+      iconv_close(h->cd);
+      free(h->fromCode);
+      delete h;
+   }
+   pthread_mutex_unlock(&IconvHandlesMutex);
+   for (int i = 0; i < NumConversionTables; i++)
+      deleteConversionTable(ConversionTables[i]);
+   NumConversionTables = 0;
+   if (SystemCharacterTable) {
+      addConversionTable("ISO6937");
+      addConversionTable(OverrideCharacterTable);
+      for (unsigned int i = 0; i < NumEntries(CharacterTables1); i++)
+         addConversionTable(CharacterTables1[i]);
+      for (unsigned int i = 0; i < NumEntries(CharacterTables2); i++)
+         addConversionTable(CharacterTables2[i]);
+   }
+}
+
 bool SetOverrideCharacterTable(const char *CharacterTable)
 {
   free(OverrideCharacterTable);
   OverrideCharacterTable = CharacterTable ? strdup(CharacterTable) : NULL;
+   initConversions();
    if (OverrideCharacterTable) {
       // Check whether the character table is known:
       iconv_t cd = iconv_open(SystemCharacterTable, OverrideCharacterTable);
@@ -340,6 +524,8 @@ bool SetSystemCharacterTable(const char *CharacterTable) {
    free(SystemCharacterTable);
    SystemCharacterTable = CharacterTable ? strdup(CharacterTable) : NULL;
    SystemCharacterTableIsSingleByte = true;
+   SystemCharacterTableIsUtf8 = SystemCharacterTable && (strcasecmp(SystemCharacterTable, "UTF-8") == 0 || strcasecmp(SystemCharacterTable, "UTF8") == 0);
+   initConversions();
    if (SystemCharacterTable) {
       // Check whether the character table is known and "single byte":
       char a[] = "";
@@ -411,11 +597,102 @@ static int Utf8CharLen(const char *s)
   return 1;
 }
 
+static bool isAscii(const char *s, size_t len)
+{
+   while (len--) {
+      if (*s++ & 0x80)
+         return false;
+   }
+   return true;
+}
+
+static bool isValidUtf8(const unsigned char *s, size_t len)
+{
+   while (len > 0) {
+      if (*s < 0x80) {
+         s++;
+         len--;
+         continue;
+      }
+      size_t l;
+      unsigned int code, min;
+      if ((*s & 0xE0) == 0xC0)      { l = 2; code = *s & 0x1F; min = 0x80; }
+      else if ((*s & 0xF0) == 0xE0) { l = 3; code = *s & 0x0F; min = 0x800; }
+      else if ((*s & 0xF8) == 0xF0) { l = 4; code = *s & 0x07; min = 0x10000; }
+      else
+         return false;
+      if (l > len)
+         return false;
+      for (size_t i = 1; i < l; i++) {
+         if ((s[i] & 0xC0) != 0x80)
+            return false;
+         code = (code << 6) | (s[i] & 0x3F);
+      }
+      if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+         return false; // overlong sequences and surrogates are rejected by iconv, too
+      s += l;
+      len -= l;
+   }
+   return true;
+}
+
+// Copies the text without splitting a UTF-8 character:
+static void copyText(const char *from, size_t fromLength, char *to, size_t toLength)
+{
+   size_t len = fromLength;
+   if (len >= toLength) {
+      len = toLength - 1;
+      while (len > 0 && (from[len] & 0xC0) == 0x80)
+         len--;
+   }
+   memcpy(to, from, len);
+   to[len] = 0;
+}
+
+// Converts through the given Table, with the same result as the iconv loop in convertCharacterTable():
+static void convertWithTable(const ConversionTable *Table, const unsigned char *from, size_t fromLength, char *to, size_t toLength)
+{
+   while (fromLength > 0 && toLength > 1) {
+      const ConversionEntry *e = &Table->single[*from];
+      size_t n = 1;
+      if (e->type == ConversionEntry::Prefix) {
+         if (fromLength < 2)
+            break; // incomplete sequence at the end
+         e = &Table->pairs[*from][from[1]];
+         n = 2;
+      }
+      if (e->type == ConversionEntry::Valid) {
+         if (e->length >= toLength)
+            break;
+         memcpy(to, e->text, e->length);
+         to += e->length;
+         toLength -= e->length;
+         from += n;
+         fromLength -= n;
+      }
+      else {
+         // A character can't be converted, so mark it with '?' and proceed:
+         from++;
+         fromLength--;
+         *to++ = '?';
+         toLength--;
+      }
+   }
+   *to = 0;
+}
+
 size_t convertCharacterTable(const char *from, size_t fromLength, char *to, size_t toLength, const char *fromCode)
 {
   char *result = to;
-  if (SystemCharacterTable && fromCode) {
-     iconv_t cd = iconv_open(SystemCharacterTable, fromCode);
+  const ConversionTable *Table = SystemCharacterTable && fromCode ? getConversionTable(fromCode) : NULL;
+  if (Table && Table->asciiCompatible && isAscii(from, fromLength))
+     copyText(from, fromLength, to, toLength);
+  else if (Table)
+     convertWithTable(Table, (const unsigned char *)from, fromLength, to, toLength);
+  else if (SystemCharacterTableIsUtf8 && fromCode && (strcasecmp(fromCode, "UTF-8") == 0 || strcasecmp(fromCode, "UTF8") == 0) && isValidUtf8((const unsigned char *)from, fromLength))
+     copyText(from, fromLength, to, toLength);
+  else if (SystemCharacterTable && fromCode) {
+     iconv_t cd = getIconvHandle(fromCode);
      if (cd != (iconv_t)-1) {
         char *fromPtr = (char *)from;
         while (fromLength > 0 && toLength > 1) {
@@ -432,7 +709,7 @@ size_t convertCharacterTable(const char *from, size_t fromLength, char *to, size
            }
         }
         *to = 0;
-        iconv_close(cd);
+        putIconvHandle(fromCode, cd);
      }
   }
   else {
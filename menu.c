@@ -5331,6 +5331,7 @@ bool cRecordControl::GetEvent(void)
 void cRecordControl::Stop(bool ExecuteUserCommand)
 {
   if (timer) {
+     cMutexLock MutexLock(&cRecordControls::mutex);
      DELETENULL(recorder);
      timer->SetRecording(false);
      timer = NULL;
@@ -5353,6 +5354,7 @@ bool cRecordControl::Process(time_t t)
 
 // --- cRecordControls -------------------------------------------------------
 
+cMutex cRecordControls::mutex;
 cRecordControl *cRecordControls::RecordControls[MAXRECORDCONTROLS] = { NULL };
 int cRecordControls::state = 0;
 
@@ -5390,8 +5392,11 @@ bool cRecordControls::Start(cTimers *Timers, cTimer *Timer, bool Pause)
         if (!Timer || Timer->Matches()) {
            for (int i = 0; i < MAXRECORDCONTROLS; i++) {
                if (!RecordControls[i]) {
-                  RecordControls[i] = new cRecordControl(device, Timers, Timer, Pause);
-                  return RecordControls[i]->Process(time(NULL));
+                  cRecordControl *RecordControl = new cRecordControl(device, Timers, Timer, Pause);
+                  mutex.Lock();
+                  RecordControls[i] = RecordControl;
+                  mutex.Unlock();
+                  return RecordControl->Process(time(NULL));
                   }
                }
            }
@@ -5434,6 +5439,7 @@ void cRecordControls::Stop(const char *InstantId)
 
 void cRecordControls::Stop(cTimer *Timer)
 {
+  cMutexLock MutexLock(&mutex);
   for (int i = 0; i < MAXRECORDCONTROLS; i++) {
       if (RecordControls[i]) {
          if (RecordControls[i]->Timer() == Timer) {
@@ -5493,8 +5499,26 @@ cRecordControl *cRecordControls::GetRecordControl(const cTimer *Timer)
   return NULL;
 }
 
+bool cRecordControls::GetRecorderStatistics(int Index, cRecorderStatistics &Statistics, cString &RecordingName)
+{
+  cMutexLock MutexLock(&mutex);
+  for (int i = 0; i < MAXRECORDCONTROLS; i++) {
+      if (RecordControls[i]) {
+         if (cRecorder *Recorder = RecordControls[i]->Recorder()) {
+            if (Index-- == 0) {
+               Recorder->GetStatistics(Statistics);
+               RecordingName = Recorder->RecordingName();
+               return true;
+               }
+            }
+         }
+      }
+  return false;
+}
+
 bool cRecordControls::Process(cTimers *Timers, time_t t)
 {
+  cMutexLock MutexLock(&mutex);
   bool Result = false;
   for (int i = 0; i < MAXRECORDCONTROLS; i++) {
       if (RecordControls[i]) {
@@ -5536,6 +5560,7 @@ bool cRecordControls::Active(void)
 
 void cRecordControls::Shutdown(void)
 {
+  cMutexLock MutexLock(&mutex);
   for (int i = 0; i < MAXRECORDCONTROLS; i++)
       DELETENULL(RecordControls[i]);
   ChangeState();
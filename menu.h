@@ -251,10 +251,13 @@ public:
   const char *InstantId(void) { return instantId; }
   const char *FileName(void) { return fileName; }
   cTimer *Timer(void) { return timer; }
+  cRecorder *Recorder(void) { return recorder; }
   };
 
 class cRecordControls {
+  friend class cRecordControl;
 private:
+  static cMutex mutex; // protects RecordControls[] and their recorders against GetRecorderStatistics()
   static cRecordControl *RecordControls[];
   static int state;
 public:
@@ -268,6 +271,10 @@ public:
   static cRecordControl *GetRecordControl(const cTimer *Timer);
          ///< Returns the cRecordControl for the given Timer.
          ///< If there is no cRecordControl for Timer, NULL is returned.
+  static bool GetRecorderStatistics(int Index, cRecorderStatistics &Statistics, cString &RecordingName);
+         ///< Copies the statistics of the Index'th of the currently active recordings
+         ///< into Statistics, and its name into RecordingName. Returns false if there
+         ///< are no more recordings. This function may be called from any thread.
   static bool Process(cTimers *Timers, time_t t);
   static void ChannelDataModified(const cChannel *Channel);
   static bool Active(void);
@@ -310,12 +310,21 @@ uchar *cMtdCamSlot::Decrypt(uchar *Data, int &Count)
 {
   // Send data to CAM:
   if (Count >= TS_SIZE) {
-     Count = TS_SIZE;
-     int Pid = TsPid(Data);
-     TsSetPid(Data, mtdMapper->RealToUniqPid(Pid));
+     int n = 1;
+     if (int BatchSize = MasterSlot()->BatchSize()) { // the CAM accepts several packets at once
+        for (int Max = min(BatchSize, Count / TS_SIZE); n < Max && Data[n * TS_SIZE] == TS_SYNC_BYTE; n++)
+            ;
+        }
+     int Pids[n];
+     for (int i = 0; i < n; i++) {
+         uchar *p = Data + i * TS_SIZE;
+         Pids[i] = TsPid(p);
+         TsSetPid(p, mtdMapper->RealToUniqPid(Pids[i]));
+         }
+     Count = n * TS_SIZE;
      MasterSlot()->Decrypt(Data, Count);
-     if (Count == 0)
-        TsSetPid(Data, Pid); // must restore PID for later retry
+     for (int i = Count / TS_SIZE; i < n; i++)
+         TsSetPid(Data + i * TS_SIZE, Pids[i]); // must restore PID for later retry
      }
   else
      Count = 0;
@@ -41,6 +41,11 @@ fulfill the following requirements:
 - The cCamSlot's Decrypt() function shall accept the given TS packet,
   but shall *not* return a decrypted packet. Decypted packets shall be
   delivered through a call to MtdPutData(), one at a time.
+- If the cCamSlot's BatchSize() function returns a value greater than 0,
+  its Decrypt() function is given up to that many TS packets at once, and
+  shall set Count to the number of bytes it has accepted. Decrypted packets
+  are still delivered through MtdPutData(). DecryptPackets() is not used
+  with MTD.
 - The cCamSlot's Decrypt() function needs to be thread safe, because
   it will be called from several cMtdCamSlot objects.
 
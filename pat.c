@@ -14,6 +14,7 @@
 #include "libsi/descriptor.h"
 
 #define PMT_SCAN_TIMEOUT  1000 // ms
+#define PMT_FILTERS_SOFT    32 // PMT PIDs filtered at the same time with software section filters
 
 // --- cCaDescriptor ---------------------------------------------------------
 
@@ -286,17 +287,24 @@ class cPmtPidEntry : public cListObject {
 private:
   int pid;
   bool complete;
+  bool active;
+  cTimeMs timer;
 public:
   cPmtPidEntry(int Pid);
   int Pid(void) { return pid; }
   int Complete(void) { return complete; }
   void SetComplete(bool State) { complete = State; }
+  bool Active(void) { return active; }
+  void SetActive(bool State) { active = State; timer.Set(PMT_SCAN_TIMEOUT); }
+  void Received(void) { timer.Set(PMT_SCAN_TIMEOUT); }
+  bool TimedOut(void) { return active && timer.TimedOut(); }
   };
 
 cPmtPidEntry::cPmtPidEntry(int Pid)
 {
   pid = Pid;
   complete = false;
+  active = false;
 }
 
 // --- cPmtSidEntry ----------------------------------------------------------
@@ -356,9 +364,9 @@ void cPatFilter::Trigger(int Sid)
   cMutexLock MutexLock(&mutex);
   patVersion = -1;
   sectionSyncer.Reset();
-  if (Sid != 0 && activePmt)
-     Del(activePmt->Pid(), SI::TableIdPMT);
-  activePmt = NULL;
+  DeactivatePmtPids(Sid != 0);
+  scanTimer.Set();
+  pmtsComplete = false;
   if (Sid >= 0) {
      sid = Sid;
      DBGLOG("PAT filter trigger SID %d", Sid);
@@ -389,8 +397,10 @@ bool cPatFilter::PmtVersionChanged(int PmtPid, int Sid, int Version, bool SetNew
       if (se->Sid() == Sid && se->Pid() == PmtPid) {
          if (!se->Received()) {
             se->SetReceived(true);
-            if (PmtPidComplete(PmtPid))
+            if (PmtPidComplete(PmtPid) && !se->PidEntry()->Complete()) {
                se->PidEntry()->SetComplete(true);
+               CheckPmtsComplete();
+               }
             }
          if (se->Version() != Version) {
             DBGLOG("PMT %d  %2d %5d/%d %2d -> %2d", Transponder(), i, PmtPid, Sid, se->Version(), Version);
@@ -404,14 +414,81 @@ bool cPatFilter::PmtVersionChanged(int PmtPid, int Sid, int Version, bool SetNew
   return false;
 }
 
-void cPatFilter::SwitchToNextPmtPid(void)
+int cPatFilter::MaxActivePmts(void)
+{
+  if (Setup.PmtFilters > 0)
+     return Setup.PmtFilters;
+  return Setup.SoftwareSectionFilters ? PMT_FILTERS_SOFT : 1;
+}
+
+cPmtPidEntry *cPatFilter::GetPmtPidEntry(int PmtPid)
+{
+  for (cPmtPidEntry *pe = pmtPidList.First(); pe; pe = pmtPidList.Next(pe)) {
+      if (pe->Pid() == PmtPid)
+         return pe;
+      }
+  return NULL;
+}
+
+void cPatFilter::ActivatePmtPid(cPmtPidEntry *PmtPidEntry)
 {
-  if (activePmt) {
-     Del(activePmt->Pid(), SI::TableIdPMT);
-     if (!(activePmt = pmtPidList.Next(activePmt)))
-        activePmt = pmtPidList.First();
-     PmtPidReset(activePmt->Pid());
-     Add(activePmt->Pid(), SI::TableIdPMT);
+  PmtPidReset(PmtPidEntry->Pid());
+  PmtPidEntry->SetActive(true);
+  numActivePmts++;
+  Add(PmtPidEntry->Pid(), SI::TableIdPMT);
+  if (!(nextPmt = pmtPidList.Next(PmtPidEntry)))
+     nextPmt = pmtPidList.First();
+}
+
+void cPatFilter::DeactivatePmtPids(bool DelFilters)
+{
+  for (cPmtPidEntry *pe = pmtPidList.First(); pe; pe = pmtPidList.Next(pe)) {
+      if (pe->Active()) {
+         if (DelFilters)
+            Del(pe->Pid(), SI::TableIdPMT);
+         pe->SetActive(false);
+         }
+      }
+  numActivePmts = 0;
+  nextPmt = NULL;
+}
+
+void cPatFilter::ActivateNextPmtPids(void)
+{
+  // Starting at nextPmt, the PMT PIDs that have not been completely received
+  // yet are activated first, then the rest in turn:
+  int MaxActive = MaxActivePmts();
+  for (int Pass = 0; Pass < 2; Pass++) {
+      cPmtPidEntry *pe = nextPmt ? nextPmt : pmtPidList.First();
+      for (int i = pmtPidList.Count(); i > 0 && numActivePmts < MaxActive; i--) {
+          if (!pe->Active() && (Pass > 0 || !pe->Complete()))
+             ActivatePmtPid(pe);
+          if (!(pe = pmtPidList.Next(pe)))
+             pe = pmtPidList.First();
+          }
+      }
+}
+
+void cPatFilter::SwitchToNextPmtPid(cPmtPidEntry *PmtPidEntry)
+{
+  if (PmtPidEntry->Active()) {
+     Del(PmtPidEntry->Pid(), SI::TableIdPMT);
+     PmtPidEntry->SetActive(false);
+     numActivePmts--;
+     }
+  ActivateNextPmtPids();
+}
+
+void cPatFilter::CheckPmtsComplete(void)
+{
+  if (!pmtsComplete) {
+     for (cPmtPidEntry *pe = pmtPidList.First(); pe; pe = pmtPidList.Next(pe)) {
+         if (!pe->Complete())
+            return;
+         }
+     pmtsComplete = true;
+     int MaxActive = MaxActivePmts();
+     dsyslog("PAT filter: received %d PMTs on %d PIDs of transponder %s-%d in %d ms (%d filter%s)", pmtSidList.Count(), pmtPidList.Count(), *cSource::ToString(Source()), Transponder(), int(scanTimer.Elapsed()), MaxActive, MaxActive > 1 ? "s" : "");
      }
 }
 
@@ -428,12 +505,12 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
            if (pat.getVersionNumber() != patVersion) {
               if (pat.getLastSectionNumber() > 0)
                  DBGLOG("  PAT %d: %d sections", Transponder(), pat.getLastSectionNumber() + 1);
-              if (activePmt) {
-                 Del(activePmt->Pid(), SI::TableIdPMT);
-                 activePmt = NULL;
-                 }
+              DeactivatePmtPids();
               pmtSidList.Clear();
               pmtPidList.Clear();
+              if (patVersion >= 0)
+                 scanTimer.Set();
+              pmtsComplete = false;
               patVersion = pat.getVersionNumber();
               }
            SI::PAT::Association assoc;
@@ -451,7 +528,7 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
                   pmtSidList.Add(new cPmtSidEntry(assoc.getServiceId(), PmtPid, pPid));
                   DBGLOG("    PMT pid %2d/%2d %5d  SID %5d", PidIndex, pmtSidList.Count() - 1, PmtPid, assoc.getServiceId());
                   if (sid == assoc.getServiceId()) {
-                     activePmt = pPid;
+                     nextPmt = pPid; // the PMT of the current channel is activated first
                      DBGLOG("sid = %d pidIndex = %d", sid, PidIndex);
                      }
                   }
@@ -459,23 +536,22 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
            if (sectionSyncer.Complete()) { // all PAT sections done
               if (pmtPidList.Count() != pmtSidList.Count())
                  DBGLOG("  PAT %d: shared PMT PIDs", Transponder());
-              if (pmtSidList.Count() && !activePmt)
-                 activePmt = pmtPidList.First();
-              if (activePmt)
-                 Add(activePmt->Pid(), SI::TableIdPMT);
-              timer.Set(PMT_SCAN_TIMEOUT);
+              if (pmtSidList.Count())
+                 ActivateNextPmtPids();
               }
            }
         }
      }
   else if (Tid == SI::TableIdPMT && Source() && Transponder()) {
-     timer.Set(PMT_SCAN_TIMEOUT);
+     cPmtPidEntry *PmtPidEntry = GetPmtPidEntry(Pid);
+     if (PmtPidEntry)
+        PmtPidEntry->Received();
      SI::PMT pmt(Data, false);
      if (!pmt.CheckCRCAndParse())
         return;
      if (!PmtVersionChanged(Pid, pmt.getTableIdExtension(), pmt.getVersionNumber(), true)) {
-        if (activePmt && activePmt->Complete())
-           SwitchToNextPmtPid();
+        if (PmtPidEntry && PmtPidEntry->Active() && PmtPidEntry->Complete())
+           SwitchToNextPmtPid(PmtPidEntry);
         return;
         }
      cStateKey StateKey;
@@ -483,8 +559,8 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
      if (!Channels)
         return;
      bool ChannelsModified = false;
-     if (activePmt && activePmt->Complete())
-        SwitchToNextPmtPid();
+     if (PmtPidEntry && PmtPidEntry->Active() && PmtPidEntry->Complete())
+        SwitchToNextPmtPid(PmtPidEntry);
      cChannel *Channel = Channels->GetByServiceID(Source(), Transponder(), pmt.getServiceId());
      if (Channel) {
         SI::CaDescriptor *d;
@@ -725,10 +801,10 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
         }
      StateKey.Remove(ChannelsModified);
      }
-  if (timer.TimedOut()) {
-     if (activePmt)
-        DBGLOG("PMT timeout Pid %d", activePmt->Pid());
-     SwitchToNextPmtPid();
-     timer.Set(PMT_SCAN_TIMEOUT);
-     }
+  for (cPmtPidEntry *pe = pmtPidList.First(); pe; pe = pmtPidList.Next(pe)) {
+      if (pe->TimedOut()) {
+         DBGLOG("PMT timeout Pid %d", pe->Pid());
+         SwitchToNextPmtPid(pe);
+         }
+      }
 }
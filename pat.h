@@ -20,17 +20,25 @@ class cPmtSidEntry;
 class cPatFilter : public cFilter {
 private:
   cMutex mutex;
-  cTimeMs timer;
+  cTimeMs scanTimer;
   int patVersion;
   int sid;
-  cPmtPidEntry *activePmt;
+  int numActivePmts;
+  cPmtPidEntry *nextPmt;
   cList<cPmtPidEntry> pmtPidList;
   cList<cPmtSidEntry> pmtSidList;
   cSectionSyncer sectionSyncer;
+  bool pmtsComplete;
+  int MaxActivePmts(void);
   bool PmtPidComplete(int PmtPid);
   void PmtPidReset(int PmtPid);
   bool PmtVersionChanged(int PmtPid, int Sid, int Version, bool SetNewVersion = false);
-  void SwitchToNextPmtPid(void);
+  cPmtPidEntry *GetPmtPidEntry(int PmtPid);
+  void ActivatePmtPid(cPmtPidEntry *PmtPidEntry);
+  void DeactivatePmtPids(bool DelFilters = true);
+  void ActivateNextPmtPids(void);
+  void SwitchToNextPmtPid(cPmtPidEntry *PmtPidEntry);
+  void CheckPmtsComplete(void);
 protected:
   virtual void Process(u_short Pid, u_char Tid, const u_char *Data, int Length);
 public:
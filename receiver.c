@@ -21,6 +21,7 @@ cReceiver::cReceiver(const cChannel *Channel, int Priority)
   scramblingTimeout = 0;
   startEitInjection = 0;
   lastEitInjection = 0;
+  numPackets = 0;
   SetPids(Channel);
 }
 
@@ -45,8 +46,10 @@ bool cReceiver::AddPid(int Pid)
      if (numPids < MAXRECEIVEPIDS) {
         if (!WantsPid(Pid)) {
            pids[numPids++] = Pid;
-           if (device)
+           if (device) {
               device->AddPid(Pid);
+              device->ReceiverPidsChanged(this);
+              }
            }
         }
      else {
@@ -76,6 +79,8 @@ bool cReceiver::AddPids(int Pid1, int Pid2, int Pid3, int Pid4, int Pid5, int Pi
 bool cReceiver::SetPids(const cChannel *Channel)
 {
   numPids = 0;
+  if (device)
+     device->ReceiverPidsChanged(this);
   if (Channel) {
      channelID = Channel->GetChannelID();
      return AddPid(Channel->Vpid()) &&
@@ -95,8 +100,10 @@ void cReceiver::DelPid(int Pid)
             for ( ; i < numPids; i++) // we also copy the terminating 0!
                 pids[i] = pids[i + 1];
             numPids--;
-            if (device)
+            if (device) {
                device->DelPid(Pid);
+               device->ReceiverPidsChanged(this);
+               }
             return;
             }
          }
@@ -111,6 +118,12 @@ void cReceiver::DelPids(const int *Pids)
      }
 }
 
+void cReceiver::ReceiveBatch(const uchar *Data, int Count)
+{
+  for (int i = 0; i < Count; i++, Data += TS_SIZE)
+      Receive(Data, TS_SIZE);
+}
+
 bool cReceiver::WantsPid(int Pid)
 {
   if (Pid) {
@@ -27,6 +27,7 @@ private:
   int scramblingTimeout;
   time_t startEitInjection;
   time_t lastEitInjection;
+  uint64_t numPackets;
   bool WantsPid(int Pid);
 protected:
   cDevice *Device(void) { return device; }
@@ -43,6 +44,12 @@ protected:
                ///< as soon as possible, without any unnecessary delay. Each TS packet
                ///< will be delivered only ONCE, so the cReceiver must make sure that
                ///< it will be able to buffer the data if necessary.
+  virtual void ReceiveBatch(const uchar *Data, int Count);
+               ///< Like Receive(), but delivers Count consecutive TS packets (each TS_SIZE
+               ///< bytes long) from the set of PIDs the cReceiver has requested in one go.
+               ///< A derived class can reimplement this function to handle larger blocks
+               ///< of data more efficiently than one TS packet at a time.
+               ///< The default implementation calls Receive() for each TS packet.
 public:
   cReceiver(const cChannel *Channel = NULL, int Priority = MINPRIORITY);
                ///< Creates a new receiver for the given Channel with the given Priority.
@@ -79,6 +86,9 @@ public:
                ///< receiver.
   tChannelID ChannelID(void) { return channelID; }
   int NumPids(void) const { return numPids; }
+  uint64_t NumPackets(void) const { return numPackets; }
+               ///< Returns the number of TS packets this receiver has been given by
+               ///< its device(s) so far.
   bool IsAttached(void) { return device != NULL; }
                ///< Returns true if this receiver is (still) attached to a device.
                ///< A receiver may be automatically detached from its device in
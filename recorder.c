@@ -19,6 +19,14 @@
 #define MINFREEDISKSPACE    (512) // MB
 #define DISKCHECKINTERVAL   100 // seconds
 
+static uint64_t MicroSeconds(void)
+{
+  struct timespec tp;
+  if (clock_gettime(CLOCK_MONOTONIC, &tp) == 0)
+     return uint64_t(tp.tv_sec) * 1000000 + tp.tv_nsec / 1000;
+  return 0;
+}
+
 // --- cRecorder -------------------------------------------------------------
 
 cRecorder::cRecorder(const char *FileName, const cChannel *Channel, int Priority)
@@ -34,6 +42,8 @@ cRecorder::cRecorder(const char *FileName, const cChannel *Channel, int Priority
   ringBuffer = new cRingBufferLinear(RECORDERBUFSIZE, MIN_TS_PACKETS_FOR_FRAME_DETECTOR * TS_SIZE, true, "Recorder");
   ringBuffer->SetTimeouts(0, 100);
   ringBuffer->SetIoThrottle();
+  ringBuffer->SetSingleProducerConsumer();
+  ringBuffer->SetDeferredRelease(); // the data is written directly from the ring buffer, see Action()
 
   int Pid = Channel->Vpid();
   int Type = Channel->Vtype();
@@ -47,9 +57,15 @@ cRecorder::cRecorder(const char *FileName, const cChannel *Channel, int Priority
      }
   frameDetector = new cFrameDetector(Pid, Type);
   index = NULL;
+  firstPendingIndex = 0;
+  numPendingIndex = 0;
   fileSize = 0;
   lastDiskSpaceCheck = time(NULL);
+  statistics.bufferSize = RECORDERBUFSIZE;
+  packetsIn = 0;
   fileName = new cFileName(FileName, true);
+  fileName->SetAsyncWrite(true);
+  fileName->SetWriteLatencies(&writeLatencies);
   int PatVersion, PmtVersion;
   if (fileName->GetLastPatPmtVersions(PatVersion, PmtVersion))
      patPmtGenerator.SetVersions(PatVersion + 1, PmtVersion + 1);
@@ -67,6 +83,8 @@ cRecorder::cRecorder(const char *FileName, const cChannel *Channel, int Priority
 cRecorder::~cRecorder()
 {
   Detach();
+  fileName->Close(); // waits until all data has been written
+  WriteIndexEntries(true);
   delete index;
   delete fileName;
   delete frameDetector;
@@ -106,34 +124,159 @@ void cRecorder::Activate(bool On)
      Cancel(3);
 }
 
+static bool IsAdaptationFieldFiller(const uchar *Data)
+{
+  static const uchar aff[TS_SIZE - 4] = { 0xB7, 0x00,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF};
+  return (Data[3] & 0b00110000) == 0b00100000 && !memcmp(Data + 4, aff, sizeof(aff));
+}
+
+void cRecorder::CountDropped(const uchar *Data, int Length)
+{
+  cMutexLock MutexLock(&statisticsMutex);
+  for (; Length >= TS_SIZE; Data += TS_SIZE, Length -= TS_SIZE) {
+      int Pid = TsPid(Data);
+      int i = 0;
+      while (i < statistics.numDroppedPids && statistics.droppedPids[i] != Pid)
+            i++;
+      if (i == statistics.numDroppedPids) {
+         if (i >= MAXRECEIVEPIDS)
+            continue;
+         statistics.droppedPids[i] = Pid;
+         statistics.droppedPackets[i] = 0;
+         statistics.numDroppedPids++;
+         }
+      statistics.droppedPackets[i]++;
+      }
+}
+
+void cRecorder::CountWrite(uint64_t Time, int Bytes)
+{
+  int Bucket = 0;
+  for (uint64_t Limit = 100; Bucket < RECORDERBLOCKEDBUCKETS - 1 && Time >= Limit; Limit *= 10)
+      Bucket++;
+  cMutexLock MutexLock(&statisticsMutex);
+  statistics.writeBlocked[Bucket]++;
+  statistics.bytesWritten += Bytes;
+}
+
+void cRecorder::CountIndexWrite(uint64_t Time)
+{
+  cMutexLock MutexLock(&statisticsMutex);
+  statistics.indexWrites++;
+  statistics.indexWriteTime += Time;
+  if (int(Time) > statistics.indexWriteTimeMax)
+     statistics.indexWriteTimeMax = int(Time);
+}
+
+void cRecorder::AddIndexEntry(bool Independent, uint16_t FileNumber, off_t FileOffset)
+{
+  if (numPendingIndex == MAXPENDINGINDEX) {
+     // The disk is far behind, so the oldest entry is written anyway:
+     tIndexEntry &e = pendingIndex[firstPendingIndex];
+     uint64_t IndexWriteStart = MicroSeconds();
+     index->Write(e.independent, e.fileNumber, e.fileOffset);
+     CountIndexWrite(MicroSeconds() - IndexWriteStart);
+     firstPendingIndex = (firstPendingIndex + 1) % MAXPENDINGINDEX;
+     numPendingIndex--;
+     }
+  tIndexEntry &e = pendingIndex[(firstPendingIndex + numPendingIndex) % MAXPENDINGINDEX];
+  e.independent = Independent;
+  e.fileNumber = FileNumber;
+  e.fileOffset = FileOffset;
+  numPendingIndex++;
+}
+
+void cRecorder::WriteIndexEntries(bool All)
+{
+  // Files other than the current one have been closed, so all of their data is
+  // on disk. In the current file a frame is complete once the data up to the
+  // start of the next frame has been written:
+  off_t Written = All ? 0 : fileSize - recordFile->Pending();
+  while (numPendingIndex > 0) {
+        tIndexEntry &e = pendingIndex[firstPendingIndex];
+        if (!All && e.fileNumber == fileName->Number()) {
+           if (numPendingIndex == 1)
+              break;
+           tIndexEntry &Next = pendingIndex[(firstPendingIndex + 1) % MAXPENDINGINDEX];
+           if (Next.fileNumber == e.fileNumber && Next.fileOffset > Written)
+              break;
+           }
+        uint64_t IndexWriteStart = MicroSeconds();
+        index->Write(e.independent, e.fileNumber, e.fileOffset);
+        CountIndexWrite(MicroSeconds() - IndexWriteStart);
+        firstPendingIndex = (firstPendingIndex + 1) % MAXPENDINGINDEX;
+        numPendingIndex--;
+        }
+}
+
+void cRecorder::GetStatistics(cRecorderStatistics &Statistics)
+{
+  cMutexLock MutexLock(&statisticsMutex);
+  Statistics = statistics;
+  Statistics.packetsIn = packetsIn;
+  Statistics.bufferMaxFill = ringBuffer->MaxFill();
+  Statistics.bytesDropped = ringBuffer->OverflowedBytes();
+  writeLatencies.Get(Statistics.writeLatency);
+}
+
+void cRecorder::Store(const uchar *Data, int Length)
+{
+  int p = ringBuffer->Put(Data, Length);
+  if (p != Length && Running()) {
+     ringBuffer->ReportOverflow(Length - p);
+     CountDropped(Data + p, Length - p);
+     }
+}
+
+void cRecorder::BufferWritten(const uchar *Data, int Count)
+{
+  ringBuffer->Release(Data, Count);
+}
+
 void cRecorder::Receive(const uchar *Data, int Length)
 {
   if (Running()) {
-     static const uchar aff[TS_SIZE - 4] = { 0xB7, 0x00,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF}; // Length is always TS_SIZE!
-     if ((Data[3] & 0b00110000) == 0b00100000 && !memcmp(Data + 4, aff, sizeof(aff)))
+     packetsIn++;
+     if (IsAdaptationFieldFiller(Data))
         return; // Adaptation Field Filler found, skipping
-     int p = ringBuffer->Put(Data, Length);
-     if (p != Length && Running())
-        ringBuffer->ReportOverflow(Length - p);
+     Store(Data, Length);
+     }
+}
+
+void cRecorder::ReceiveBatch(const uchar *Data, int Count)
+{
+  if (Running()) {
+     packetsIn += Count;
+     // Runs of TS packets are put into the ring buffer as a whole, skipping any Adaptation Field Fillers:
+     const uchar *Start = Data;
+     for (int i = 0; i < Count; i++, Data += TS_SIZE) {
+         if (IsAdaptationFieldFiller(Data)) {
+            if (Data > Start)
+               Store(Start, Data - Start);
+            Start = Data + TS_SIZE;
+            }
+         }
+     if (Data > Start)
+        Store(Start, Data - Start);
      }
 }
 
@@ -148,6 +291,7 @@ void cRecorder::Action(void)
         if (b) {
            int Count = frameDetector->Analyze(b, r);
            if (Count) {
+              bool Written = false;
               if (!Running() && frameDetector->IndependentFrame()) // finish the recording before the next independent frame
                  break;
               if (frameDetector->Synced()) {
@@ -169,7 +313,9 @@ void cRecorder::Action(void)
                     if (!NextFile())
                        break;
                     if (index && frameDetector->NewFrame())
-                       index->Write(frameDetector->IndependentFrame(), fileName->Number(), fileSize);
+                       AddIndexEntry(frameDetector->IndependentFrame(), fileName->Number(), fileSize);
+                    uint64_t WriteStart = MicroSeconds();
+                    off_t OldFileSize = fileSize;
                     if (frameDetector->IndependentFrame()) {
                        recordFile->Write(patPmtGenerator.GetPat(), TS_SIZE);
                        fileSize += TS_SIZE;
@@ -180,16 +326,26 @@ void cRecorder::Action(void)
                              }
                        t.Set(MAXBROKENTIMEOUT);
                        }
-                    if (recordFile->Write(b, Count) < 0) {
+                    // The data is handed over to the file without copying it, and
+                    // BufferWritten() releases it in the ring buffer once it has been written:
+                    Written = true;
+                    if (recordFile->WriteShared(b, Count, this) < 0) {
                        LOG_ERROR_STR(fileName->Name());
                        break;
                        }
                     fileSize += Count;
+                    CountWrite(MicroSeconds() - WriteStart, fileSize - OldFileSize);
+                    if (index)
+                       WriteIndexEntries();
                     }
                  }
               ringBuffer->Del(Count);
+              if (!Written)
+                 ringBuffer->Release(b, Count); // this only happens before anything has been written
               }
            }
+        else if (index && numPendingIndex > 0)
+           WriteIndexEntries();
         if (t.TimedOut()) {
            esyslog("ERROR: video data stream broken");
            ShutdownHandler.RequestEmergencyExit();
@@ -10,25 +10,70 @@
 #ifndef __RECORDER_H
 #define __RECORDER_H
 
+#include <atomic>
 #include "receiver.h"
 #include "recording.h"
 #include "remux.h"
 #include "ringbuffer.h"
 #include "thread.h"
 
-class cRecorder : public cReceiver, cThread {
+#define MAXPENDINGINDEX 4096 // the maximum number of index entries waiting for their data to be written
+#define RECORDERBLOCKEDBUCKETS 6 // times blocked by writes below 100us, 1ms, 10ms, 100ms, 1s and above
+
+class cRecorderStatistics {
+public:
+  uint64_t packetsIn;                        // number of TS packets received from the device
+  uint64_t bytesWritten;                     // number of bytes written to the recording
+  int bufferSize;                            // size of the recorder's ring buffer (bytes)
+  int bufferMaxFill;                         // high water mark of the ring buffer (bytes)
+  int writeBlocked[RECORDERBLOCKEDBUCKETS];  // number of writes, by the time the recorder was blocked handing the data over to the file
+  int writeLatency[WRITELATENCYBUCKETS];     // number of write() calls to the recording, by the time they took (see cWriteLatencies)
+  uint64_t bytesDropped;                     // number of bytes dropped because the ring buffer was full
+  int indexWrites;                           // number of index entries written
+  uint64_t indexWriteTime;                   // total time spent writing index entries (us)
+  int indexWriteTimeMax;                     // longest time spent writing a single index entry (us)
+  int numDroppedPids;                        // number of PIDs with dropped packets
+  int droppedPids[MAXRECEIVEPIDS];           // the PIDs of dropped packets...
+  int droppedPackets[MAXRECEIVEPIDS];        // ...and how many have been dropped
+  cRecorderStatistics(void) { memset(this, 0, sizeof(*this)); }
+  };
+
+class cRecorder : public cReceiver, cThread, cWriteBufferOwner {
 private:
+  struct tIndexEntry {
+    bool independent;
+    uint16_t fileNumber;
+    off_t fileOffset;
+    };
   cRingBufferLinear *ringBuffer;
   cFrameDetector *frameDetector;
   cPatPmtGenerator patPmtGenerator;
   cFileName *fileName;
   cIndexFile *index;
+  tIndexEntry pendingIndex[MAXPENDINGINDEX];
+  int firstPendingIndex;
+  int numPendingIndex;
   cUnbufferedFile *recordFile;
   char *recordingName;
   off_t fileSize;
   time_t lastDiskSpaceCheck;
+  cMutex statisticsMutex;
+  cRecorderStatistics statistics;
+  cWriteLatencies writeLatencies;
+  std::atomic<uint64_t> packetsIn;
+  void CountDropped(const uchar *Data, int Length);
+  void CountWrite(uint64_t Time, int Bytes);
+  void CountIndexWrite(uint64_t Time);
+  void AddIndexEntry(bool Independent, uint16_t FileNumber, off_t FileOffset);
+  void WriteIndexEntries(bool All = false);
+       ///< Writes the pending index entries of all frames that have been completely
+       ///< written to the recording, so that a player never follows an index entry
+       ///< to data that is not yet in the file. If All is true, all pending entries
+       ///< are written.
   bool RunningLowOnDiskSpace(void);
   bool NextFile(void);
+  void Store(const uchar *Data, int Length);
+  virtual void BufferWritten(const uchar *Data, int Count);
 protected:
   virtual void Activate(bool On);
        ///< If you override Activate() you need to call Detach() (which is a
@@ -36,12 +81,16 @@ protected:
        ///< to properly get a call to Activate(false) when your object is
        ///< destroyed.
   virtual void Receive(const uchar *Data, int Length);
+  virtual void ReceiveBatch(const uchar *Data, int Count);
   virtual void Action(void);
 public:
   cRecorder(const char *FileName, const cChannel *Channel, int Priority);
        ///< Creates a new recorder for the given Channel and
        ///< the given Priority that will record into the file FileName.
   virtual ~cRecorder();
+  void GetStatistics(cRecorderStatistics &Statistics);
+       ///< Copies the current statistics of this recorder into Statistics.
+  const char *RecordingName(void) { return recordingName; }
   };
 
 #endif //__RECORDER_H
@@ -17,6 +17,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include "channels.h"
@@ -2319,35 +2320,300 @@ void cRecordingUserCommand::InvokeCommand(const char *State, const char *Recordi
 // --- cIndexFileGenerator ---------------------------------------------------
 
 #define IFG_BUFFER_SIZE KILOBYTE(100)
+#define IFG_MAX_WORKERS 16 // max. number of threads that process TS files in parallel
+#define IFG_WAIT_SEGMENT 100 // ms to wait for a worker to finish the next segment
+
+// A segment is the part of the index that belongs to one TS file of the recording.
+// Since every TS file starts with a PAT/PMT and an independent frame, each file can
+// be processed on its own, and the resulting segments are then written to the index
+// file in the order of their file numbers.
+
+class cIndexFileSegment {
+public:
+  uint16_t number;           // the number of the TS file
+  cVector<off_t> offsets;    // the file offsets of all frames in this file
+  cVector<bool> independent; // the "independent" flags of all frames in this file
+  double framesPerSecond;
+  bool done;                 // the worker has finished processing this file
+  bool missing;              // there is no TS file with this number
+  bool synced;               // the frame detector could be synced within this file
+  cIndexFileSegment(uint16_t Number)
+  {
+    number = Number;
+    framesPerSecond = 0;
+    done = missing = synced = false;
+  }
+  };
+
+class cIndexFileGenerator;
+
+class cIndexFileWorker : public cThread {
+private:
+  cIndexFileGenerator *generator;
+  cString recordingName;
+  void Process(cIndexFileSegment *Segment);
+protected:
+  virtual void Action(void);
+public:
+  cIndexFileWorker(cIndexFileGenerator *Generator, const char *RecordingName);
+  ~cIndexFileWorker();
+  };
 
 class cIndexFileGenerator : public cThread {
 private:
   cString recordingName;
   bool update;
+  cMutex mutex;
+  cCondVar segmentDone;
+  cVector<cIndexFileSegment *> segments; // indexed by file number - 1
+  int nextNumber; // the number of the next TS file to be handed out to a worker
+  int lastNumber; // the number of the first file that is missing or can't be synced (0 = not yet known)
+  bool GenerateParallel(bool &IndexFileComplete, bool &IndexFileWritten, double &FramesPerSecond);
+       ///< Generates the index by processing the TS files in parallel.
+       ///< Returns false if a file couldn't be processed on its own, in which case
+       ///< nothing has been written and the index needs to be generated sequentially.
+  bool GenerateSequential(bool &IndexFileWritten, double &FramesPerSecond);
+       ///< Generates (or updates) the index by processing the TS files one after
+       ///< the other. Returns true if the recording has been processed entirely.
 protected:
   virtual void Action(void);
 public:
   cIndexFileGenerator(const char *RecordingName, bool Update = false);
   ~cIndexFileGenerator();
+  const char *RecordingName(void) { return recordingName; }
+  cIndexFileSegment *GetSegment(void);
+       ///< Returns the next segment a worker shall process, or NULL if there is
+       ///< nothing left to do.
+  void SegmentDone(cIndexFileSegment *Segment);
   };
 
+// --- cIndexFileWorker ------------------------------------------------------
+
+cIndexFileWorker::cIndexFileWorker(cIndexFileGenerator *Generator, const char *RecordingName)
+:cThread("index file worker")
+,recordingName(RecordingName)
+{
+  generator = Generator;
+  Start();
+}
+
+cIndexFileWorker::~cIndexFileWorker()
+{
+  Cancel(3);
+}
+
+void cIndexFileWorker::Action(void)
+{
+  while (Running()) {
+        cIndexFileSegment *Segment = generator->GetSegment();
+        if (!Segment)
+           break;
+        Process(Segment);
+        if (!Running())
+           break;
+        generator->SegmentDone(Segment);
+        }
+}
+
+void cIndexFileWorker::Process(cIndexFileSegment *Segment)
+{
+  bool Rewind = false;
+  cFileName FileName(recordingName, false);
+  cUnbufferedFile *ReplayFile = FileName.SetOffset(Segment->number);
+  if (!ReplayFile) {
+     Segment->missing = true;
+     return;
+     }
+  cRingBufferLinear Buffer(IFG_BUFFER_SIZE, MIN_TS_PACKETS_FOR_FRAME_DETECTOR * TS_SIZE);
+  cPatPmtParser PatPmtParser;
+  cFrameDetector FrameDetector;
+  int BufferChunks = KILOBYTE(1); // no need to read a lot at the beginning when parsing PAT/PMT
+  off_t FileSize = 0;
+  off_t FrameOffset = -1;
+  bool Stuffed = false;
+  while (Running()) {
+        // Rewind input file:
+        if (Rewind) {
+           ReplayFile = FileName.SetOffset(Segment->number);
+           FileSize = 0;
+           Buffer.Clear();
+           Rewind = false;
+           }
+        // Process data:
+        int Length;
+        uchar *Data = Buffer.Get(Length);
+        if (Data) {
+           if (FrameDetector.Synced()) {
+              // Step 3 - generate the index:
+              if (TsPid(Data) == PATPID)
+                 FrameOffset = FileSize; // the PAT/PMT is at the beginning of an I-frame
+              int Processed = FrameDetector.Analyze(Data, Length);
+              if (Processed > 0) {
+                 if (FrameDetector.NewFrame()) {
+                    Segment->offsets.Append(FrameOffset >= 0 ? FrameOffset : FileSize);
+                    Segment->independent.Append(FrameDetector.IndependentFrame());
+                    FrameOffset = -1;
+                    }
+                 FileSize += Processed;
+                 Buffer.Del(Processed);
+                 }
+              }
+           else if (PatPmtParser.Completed()) {
+              // Step 2 - sync FrameDetector:
+              int Processed = FrameDetector.Analyze(Data, Length);
+              if (Processed > 0) {
+                 if (FrameDetector.Synced()) {
+                    // Synced FrameDetector, so rewind for actual processing:
+                    Rewind = true;
+                    }
+                 Buffer.Del(Processed);
+                 }
+              }
+           else {
+              // Step 1 - parse PAT/PMT:
+              uchar *p = Data;
+              while (Length >= TS_SIZE) {
+                    int Pid = TsPid(p);
+                    if (Pid == PATPID)
+                       PatPmtParser.ParsePat(p, TS_SIZE);
+                    else if (PatPmtParser.IsPmtPid(Pid))
+                       PatPmtParser.ParsePmt(p, TS_SIZE);
+                    Length -= TS_SIZE;
+                    p += TS_SIZE;
+                    if (PatPmtParser.Completed()) {
+                       // Found pid, so rewind to sync FrameDetector:
+                       FrameDetector.SetPid(PatPmtParser.Vpid() ? PatPmtParser.Vpid() : PatPmtParser.Apid(0), PatPmtParser.Vpid() ? PatPmtParser.Vtype() : PatPmtParser.Atype(0));
+                       BufferChunks = IFG_BUFFER_SIZE;
+                       Rewind = true;
+                       break;
+                       }
+                    }
+              Buffer.Del(p - Data);
+              }
+           }
+        // Read data:
+        else if (ReplayFile) {
+           int Result = Buffer.Read(ReplayFile, BufferChunks);
+           if (Result == 0) { // EOF
+              if (Buffer.Available() > 0 && !Stuffed && FrameDetector.Synced()) {
+                 // Flush out the rest of the data (see cIndexFileGenerator::GenerateSequential()):
+                 uchar StuffingPacket[TS_SIZE] = { TS_SYNC_BYTE, 0xFF };
+                 for (int i = 0; i <= MIN_TS_PACKETS_FOR_FRAME_DETECTOR; i++)
+                     Buffer.Put(StuffingPacket, sizeof(StuffingPacket));
+                 Stuffed = true;
+                 }
+              else {
+                 Segment->synced = FrameDetector.Synced();
+                 Segment->framesPerSecond = FrameDetector.FramesPerSecond();
+                 break;
+                 }
+              }
+           }
+        else
+           break;
+        }
+}
+
+// --- cIndexFileGenerator ---------------------------------------------------
+
 cIndexFileGenerator::cIndexFileGenerator(const char *RecordingName, bool Update)
 :cThread("index file generator")
 ,recordingName(RecordingName)
 {
   update = Update;
+  nextNumber = 1;
+  lastNumber = 0;
   Start();
 }
 
 cIndexFileGenerator::~cIndexFileGenerator()
 {
   Cancel(3);
+  for (int i = 0; i < segments.Size(); i++)
+      delete segments[i];
 }
 
-void cIndexFileGenerator::Action(void)
+cIndexFileSegment *cIndexFileGenerator::GetSegment(void)
+{
+  cMutexLock MutexLock(&mutex);
+  if (lastNumber && nextNumber >= lastNumber)
+     return NULL;
+  cIndexFileSegment *Segment = new cIndexFileSegment(nextNumber);
+  segments[nextNumber - 1] = Segment;
+  nextNumber++;
+  return Segment;
+}
+
+void cIndexFileGenerator::SegmentDone(cIndexFileSegment *Segment)
+{
+  cMutexLock MutexLock(&mutex);
+  Segment->done = true;
+  if (Segment->missing || !Segment->synced) {
+     // There's no need to process any files beyond this one:
+     if (!lastNumber || Segment->number < lastNumber)
+        lastNumber = Segment->number;
+     }
+  segmentDone.Broadcast();
+}
+
+bool cIndexFileGenerator::GenerateParallel(bool &IndexFileComplete, bool &IndexFileWritten, double &FramesPerSecond)
+{
+  cIndexFile IndexFile(recordingName, true, false, false, true);
+  cVector<cIndexFileWorker *> Workers;
+  int NumWorkers = constrain(int(sysconf(_SC_NPROCESSORS_ONLN)), 1, IFG_MAX_WORKERS);
+  for (int i = 0; i < NumWorkers; i++)
+      Workers.Append(new cIndexFileWorker(this, recordingName));
+  dsyslog("generating index file with %d worker threads", NumWorkers);
+  bool Fallback = false;
+  for (int Number = 1; Running(); ) {
+      cIndexFileSegment *Segment = NULL;
+      mutex.Lock();
+      if (Number <= segments.Size() && segments[Number - 1] && segments[Number - 1]->done) {
+         Segment = segments[Number - 1];
+         segments[Number - 1] = NULL;
+         }
+      else
+         segmentDone.TimedWait(mutex, IFG_WAIT_SEGMENT);
+      mutex.Unlock();
+      if (!Segment)
+         continue;
+      if (Segment->missing) {
+         delete Segment;
+         IndexFileComplete = true;
+         break;
+         }
+      if (!Segment->synced) {
+         isyslog("can't process '%s' file %d on its own - generating index file sequentially", *recordingName, Segment->number);
+         delete Segment;
+         Fallback = true;
+         break;
+         }
+      // Stitch the segment to the index:
+      for (int i = 0; i < Segment->offsets.Size(); i++)
+          IndexFile.Write(Segment->independent[i], Segment->number, Segment->offsets[i]);
+      if (Segment->offsets.Size() > 0)
+         IndexFileWritten = true;
+      if (FramesPerSecond <= 0)
+         FramesPerSecond = Segment->framesPerSecond;
+      delete Segment;
+      Number++;
+      }
+  for (int i = 0; i < Workers.Size(); i++)
+      delete Workers[i];
+  // Delete the index file if the recording has not been processed entirely:
+  if (Fallback || !IndexFileComplete || !IndexFileWritten)
+     IndexFile.Delete();
+  if (Fallback) {
+     IndexFileWritten = false;
+     FramesPerSecond = 0;
+     return false;
+     }
+  return true;
+}
+
+bool cIndexFileGenerator::GenerateSequential(bool &IndexFileWritten, double &FramesPerSecond)
 {
   bool IndexFileComplete = false;
-  bool IndexFileWritten = false;
   bool Rewind = false;
   cFileName FileName(recordingName, false);
   cUnbufferedFile *ReplayFile = FileName.Open();
@@ -2375,7 +2641,6 @@ void cIndexFileGenerator::Action(void)
      else
         isyslog("generating index file");
      }
-  Skins.QueueMessage(mtInfo, tr("Regenerating index file"));
   bool Stuffed = false;
   while (Running()) {
         // Rewind input file:
@@ -2469,25 +2734,37 @@ void cIndexFileGenerator::Action(void)
            break;
            }
         }
+  // Delete the index file if the recording has not been processed entirely:
+  if (!IndexFileComplete || !IndexFileWritten)
+     IndexFile.Delete();
+  FramesPerSecond = FrameDetector.FramesPerSecond();
+  return IndexFileComplete;
+}
+
+void cIndexFileGenerator::Action(void)
+{
+  bool IndexFileComplete = false;
+  bool IndexFileWritten = false;
+  double FramesPerSecond = 0;
+  Skins.QueueMessage(mtInfo, tr("Regenerating index file"));
+  if (update || !GenerateParallel(IndexFileComplete, IndexFileWritten, FramesPerSecond))
+     IndexFileComplete = GenerateSequential(IndexFileWritten, FramesPerSecond);
   if (IndexFileComplete) {
      if (IndexFileWritten) {
         cRecordingInfo RecordingInfo(recordingName);
         if (RecordingInfo.Read()) {
-           if (FrameDetector.FramesPerSecond() > 0 && !DoubleEqual(RecordingInfo.FramesPerSecond(), FrameDetector.FramesPerSecond())) {
-              RecordingInfo.SetFramesPerSecond(FrameDetector.FramesPerSecond());
+           if (FramesPerSecond > 0 && !DoubleEqual(RecordingInfo.FramesPerSecond(), FramesPerSecond)) {
+              RecordingInfo.SetFramesPerSecond(FramesPerSecond);
               RecordingInfo.Write();
               LOCK_RECORDINGS_WRITE;
               Recordings->UpdateByName(recordingName);
               }
            }
         Skins.QueueMessage(mtInfo, tr("Index file regeneration complete"));
-        return;
         }
      else
         Skins.QueueMessage(mtError, tr("Index file regeneration failed!"));
      }
-  // Delete the index file if the recording has not been processed entirely:
-  IndexFile.Delete();
 }
 
 // --- cIndexFile ------------------------------------------------------------
@@ -2530,6 +2807,7 @@ cIndexFile::cIndexFile(const char *FileName, bool Record, bool IsPesRecording, b
   size = 0;
   last = -1;
   index = NULL;
+  mappedSize = 0;
   isPesRecording = IsPesRecording;
   indexFileGenerator = NULL;
   if (FileName) {
@@ -2564,28 +2842,39 @@ cIndexFile::cIndexFile(const char *FileName, bool Record, bool IsPesRecording, b
            last = int((buf.st_size + delta) / sizeof(tIndexTs) - 1);
            if ((!Record || Update) && last >= 0) {
               size = last + 1;
-              index = MALLOC(tIndexTs, size);
-              if (index) {
-                 f = open(fileName, O_RDONLY);
-                 if (f >= 0) {
-                    if (safe_read(f, index, size_t(buf.st_size)) != buf.st_size) {
-                       esyslog("ERROR: can't read from file '%s'", *fileName);
-                       free(index);
-                       index = NULL;
+              f = open(fileName, O_RDONLY);
+              if (f >= 0) {
+                 if (!isPesRecording && !delta) {
+                    // TS index files can be used "as is", so we just map them into memory:
+                    void *p = mmap(NULL, size_t(buf.st_size), PROT_READ, MAP_SHARED, f, 0);
+                    if (p != MAP_FAILED) {
+                       index = (tIndexTs *)p;
+                       mappedSize = size_t(buf.st_size);
                        }
-                    else if (isPesRecording)
-                       ConvertFromPes(index, size);
-                    if (!index || time(NULL) - buf.st_mtime >= MININDEXAGE) {
-                       close(f);
-                       f = -1;
+                    }
+                 if (!index) {
+                    if ((index = MALLOC(tIndexTs, size)) != NULL) {
+                       if (safe_read(f, index, size_t(buf.st_size)) != buf.st_size) {
+                          esyslog("ERROR: can't read from file '%s'", *fileName);
+                          free(index);
+                          index = NULL;
+                          }
+                       else if (isPesRecording)
+                          ConvertFromPes(index, size);
                        }
-                    // otherwise we don't close f here, see CatchUp()!
+                    else
+                       esyslog("ERROR: can't allocate %zd bytes for index '%s'", size * sizeof(tIndexTs), *fileName);
                     }
-                 else
-                    LOG_ERROR_STR(*fileName);
+                 if (index)
+                    AddIFrames(0);
+                 if (!index || time(NULL) - buf.st_mtime >= MININDEXAGE) {
+                    close(f);
+                    f = -1;
+                    }
+                 // otherwise we don't close f here, see CatchUp()!
                  }
               else
-                 esyslog("ERROR: can't allocate %zd bytes for index '%s'", size * sizeof(tIndexTs), *fileName);
+                 LOG_ERROR_STR(*fileName);
               }
            }
         else
@@ -2611,10 +2900,43 @@ cIndexFile::~cIndexFile()
 {
   if (f >= 0)
      close(f);
-  free(index);
+  FreeIndex();
   delete indexFileGenerator;
 }
 
+void cIndexFile::FreeIndex(void)
+{
+  if (mappedSize)
+     munmap(index, mappedSize);
+  else
+     free(index);
+  index = NULL;
+  mappedSize = 0;
+  iFrames.Clear();
+}
+
+void cIndexFile::AddIFrames(int From)
+{
+  for (int i = From; i <= last; i++) {
+      if (index[i].independent)
+         iFrames.Append(i);
+      }
+}
+
+int cIndexFile::NumIFrames(int Index)
+{
+  int l = 0;
+  int h = iFrames.Size();
+  while (l < h) {
+        int m = (l + h) / 2;
+        if (iFrames[m] <= Index)
+           l = m + 1;
+        else
+           h = m;
+        }
+  return l;
+}
+
 cString cIndexFile::IndexFileName(const char *FileName, bool IsPesRecording)
 {
   return cString::sprintf("%s%s", FileName, IsPesRecording ? INDEXFILESUFFIX ".vdr" : INDEXFILESUFFIX);
@@ -2657,37 +2979,56 @@ bool cIndexFile::CatchUp(int Index)
          if (fstat(f, &buf) == 0) {
             int newLast = int(buf.st_size / sizeof(tIndexTs) - 1);
             if (newLast > last) {
-               int NewSize = size;
-               if (NewSize <= newLast) {
-                  NewSize *= 2;
-                  if (NewSize <= newLast)
-                     NewSize = newLast + 1;
-                  }
-               if (tIndexTs *NewBuffer = (tIndexTs *)realloc(index, NewSize * sizeof(tIndexTs))) {
-                  size = NewSize;
-                  index = NewBuffer;
-                  int offset = (last + 1) * sizeof(tIndexTs);
-                  int delta = (newLast - last) * sizeof(tIndexTs);
-                  if (lseek(f, offset, SEEK_SET) == offset) {
-                     if (safe_read(f, &index[last + 1], delta) != delta) {
-                        esyslog("ERROR: can't read from index");
-                        free(index);
-                        index = NULL;
-                        close(f);
-                        f = -1;
-                        break;
-                        }
-                     if (isPesRecording)
-                        ConvertFromPes(&index[last + 1], newLast - last);
-                     last = newLast;
-                     }
-                  else
+               int oldLast = last;
+               if (mappedSize) {
+                  // Just grow the mapping:
+                  size_t NewMappedSize = (newLast + 1) * sizeof(tIndexTs);
+                  void *p = mremap(index, mappedSize, NewMappedSize, MREMAP_MAYMOVE);
+                  if (p == MAP_FAILED) {
                      LOG_ERROR_STR(*fileName);
+                     FreeIndex();
+                     close(f);
+                     f = -1;
+                     break;
+                     }
+                  index = (tIndexTs *)p;
+                  mappedSize = NewMappedSize;
+                  size = newLast + 1;
+                  last = newLast;
                   }
                else {
-                  esyslog("ERROR: can't realloc() index");
-                  break;
+                  int NewSize = size;
+                  if (NewSize <= newLast) {
+                     NewSize *= 2;
+                     if (NewSize <= newLast)
+                        NewSize = newLast + 1;
+                     }
+                  if (tIndexTs *NewBuffer = (tIndexTs *)realloc(index, NewSize * sizeof(tIndexTs))) {
+                     size = NewSize;
+                     index = NewBuffer;
+                     int offset = (last + 1) * sizeof(tIndexTs);
+                     int delta = (newLast - last) * sizeof(tIndexTs);
+                     if (lseek(f, offset, SEEK_SET) == offset) {
+                        if (safe_read(f, &index[last + 1], delta) != delta) {
+                           esyslog("ERROR: can't read from index");
+                           FreeIndex();
+                           close(f);
+                           f = -1;
+                           break;
+                           }
+                        if (isPesRecording)
+                           ConvertFromPes(&index[last + 1], newLast - last);
+                        last = newLast;
+                        }
+                     else
+                        LOG_ERROR_STR(*fileName);
+                     }
+                  else {
+                     esyslog("ERROR: can't realloc() index");
+                     break;
+                     }
                   }
+               AddIFrames(oldLast + 1);
                }
             }
          else
@@ -2748,36 +3089,33 @@ int cIndexFile::GetNextIFrame(int Index, bool Forward, uint16_t *FileNumber, off
 {
   if (CatchUp()) {
      int d = Forward ? 1 : -1;
-     for (;;) {
-         Index += d;
-         if (Index >= 0 && Index <= last) {
-            if (index[Index].independent) {
-               uint16_t fn;
-               if (!FileNumber)
-                  FileNumber = &fn;
-               off_t fo;
-               if (!FileOffset)
-                  FileOffset = &fo;
-               *FileNumber = index[Index].number;
-               *FileOffset = index[Index].offset;
-               if (Length) {
-                  if (Index < last) {
-                     uint16_t fn = index[Index + 1].number;
-                     off_t fo = index[Index + 1].offset;
-                     if (fn == *FileNumber)
-                        *Length = int(fo - *FileOffset);
-                     else
-                        *Length = -1; // this means "everything up to EOF" (the buffer's Read function will act accordingly)
-                     }
-                  else
-                     *Length = -1;
-                  }
-               return Index;
-               }
-            }
-         else
-            break;
-         }
+     if (Index + d >= 0 && Index + d <= last) {
+        int n = Forward ? NumIFrames(Index) : NumIFrames(Index - 1) - 1;
+        if (0 <= n && n < iFrames.Size()) {
+           Index = iFrames[n];
+           uint16_t fn;
+           if (!FileNumber)
+              FileNumber = &fn;
+           off_t fo;
+           if (!FileOffset)
+              FileOffset = &fo;
+           *FileNumber = index[Index].number;
+           *FileOffset = index[Index].offset;
+           if (Length) {
+              if (Index < last) {
+                 uint16_t fn = index[Index + 1].number;
+                 off_t fo = index[Index + 1].offset;
+                 if (fn == *FileNumber)
+                    *Length = int(fo - *FileOffset);
+                 else
+                    *Length = -1; // this means "everything up to EOF" (the buffer's Read function will act accordingly)
+                 }
+              else
+                 *Length = -1;
+              }
+           return Index;
+           }
+        }
      }
   return -1;
 }
@@ -2786,26 +3124,13 @@ int cIndexFile::GetClosestIFrame(int Index)
 {
   if (last > 0) {
      Index = constrain(Index, 0, last);
-     if (index[Index].independent)
-        return Index;
-     int il = Index - 1;
-     int ih = Index + 1;
-     for (;;) {
-         if (il >= 0) {
-            if (index[il].independent)
-               return il;
-            il--;
-            }
-         else if (ih > last)
-            break;
-         if (ih <= last) {
-            if (index[ih].independent)
-               return ih;
-            ih++;
-            }
-         else if (il < 0)
-            break;
-         }
+     int n = NumIFrames(Index);
+     int il = n > 0 ? iFrames[n - 1] : -1;            // the closest I-frame at or before Index
+     int ih = n < iFrames.Size() ? iFrames[n] : -1;   // the closest I-frame after Index
+     if (il >= 0 && (ih < 0 || Index - il <= ih - Index))
+        return il;
+     if (ih >= 0)
+        return ih;
      }
   return 0;
 }
@@ -2813,13 +3138,17 @@ int cIndexFile::GetClosestIFrame(int Index)
 int cIndexFile::Get(uint16_t FileNumber, off_t FileOffset)
 {
   if (CatchUp()) {
-     //TODO implement binary search!
-     int i;
-     for (i = 0; i <= last; i++) {
-         if (index[i].number > FileNumber || (index[i].number == FileNumber) && off_t(index[i].offset) >= FileOffset)
-            break;
-         }
-     return i;
+     // Binary search for the first frame at or after the given position:
+     int l = 0;
+     int h = last + 1;
+     while (l < h) {
+           int m = (l + h) / 2;
+           if (index[m].number < FileNumber || index[m].number == FileNumber && off_t(index[m].offset) < FileOffset)
+              l = m + 1;
+           else
+              h = m;
+           }
+     return l;
      }
   return -1;
 }
@@ -2878,6 +3207,78 @@ bool GenerateIndex(const char *FileName, bool Update)
   return false;
 }
 
+static void FindRecordings(const char *DirName, cStringList &RecordingNames, int LinkLevel = 0)
+{
+  cReadDir d(DirName);
+  struct dirent *e;
+  while ((e = d.Next()) != NULL) {
+        cString buffer = AddDirectory(DirName, e->d_name);
+        struct stat st;
+        if (lstat(buffer, &st) == 0) {
+           int Link = 0;
+           if (S_ISLNK(st.st_mode)) {
+              if (LinkLevel > MAX_LINK_LEVEL) {
+                 isyslog("max link level exceeded - not scanning %s", *buffer);
+                 continue;
+                 }
+              Link = 1;
+              if (stat(buffer, &st) != 0)
+                 continue;
+              }
+           if (S_ISDIR(st.st_mode)) {
+              if (endswith(buffer, RECEXT))
+                 RecordingNames.Append(strdup(buffer));
+              else if (!endswith(buffer, DELEXT))
+                 FindRecordings(buffer, RecordingNames, LinkLevel + Link);
+              }
+           }
+        }
+}
+
+bool GenerateIndexes(const char *DirName)
+{
+  if (DirectoryOk(DirName)) {
+     cStringList RecordingNames;
+     FindRecordings(DirName, RecordingNames);
+     RecordingNames.Sort();
+     int MaxGenerators = constrain(int(sysconf(_SC_NPROCESSORS_ONLN)), 1, IFG_MAX_WORKERS);
+     cVector<cIndexFileGenerator *> Generators;
+     bool Result = true;
+     int i = 0;
+     while (i < RecordingNames.Size() || Generators.Size() > 0) {
+           // Collect the generators that have finished:
+           for (int g = Generators.Size() - 1; g >= 0; g--) {
+               if (!Generators[g]->Active()) {
+                  cString IndexFileName = AddDirectory(Generators[g]->RecordingName(), INDEXFILESUFFIX);
+                  if (access(IndexFileName, R_OK) != 0) {
+                     fprintf(stderr, "cannot create '%s'\n", *IndexFileName);
+                     Result = false;
+                     }
+                  delete Generators[g];
+                  Generators.Remove(g);
+                  }
+               }
+           // Start new generators:
+           if (i < RecordingNames.Size() && Generators.Size() < MaxGenerators) {
+              const char *FileName = RecordingNames[i++];
+              cRecording Recording(FileName);
+              if (Recording.Name() && !Recording.IsPesRecording()) {
+                 unlink(AddDirectory(FileName, INDEXFILESUFFIX));
+                 Generators.Append(new cIndexFileGenerator(FileName));
+                 }
+              else
+                 fprintf(stderr, "'%s' is not a TS recording - skipped\n", FileName);
+              }
+           else
+              cCondWait::SleepMs(INDEXFILECHECKINTERVAL);
+           }
+     return Result;
+     }
+  else
+     fprintf(stderr, "'%s' is not a directory\n", DirName);
+  return false;
+}
+
 // --- cFileName -------------------------------------------------------------
 
 #define MAXFILESPERRECORDINGPES 255
@@ -2893,6 +3294,8 @@ cFileName::cFileName(const char *FileName, bool Record, bool Blocking, bool IsPe
   record = Record;
   blocking = Blocking;
   isPesRecording = IsPesRecording;
+  asyncWrite = false;
+  writeLatencies = NULL;
   // Prepare the file name:
   fileName = MALLOC(char, strlen(FileName) + RECORDFILESUFFIXLEN);
   if (!fileName) {
@@ -2970,6 +3373,11 @@ cUnbufferedFile *cFileName::Open(void)
         file = cVideoDirectory::OpenVideoFile(fileName, O_RDWR | O_CREAT | O_LARGEFILE | BlockingFlag);
         if (!file)
            LOG_ERROR_STR(fileName);
+        else {
+           file->SetWriteLatencies(writeLatencies);
+           if (asyncWrite)
+              file->SetAsyncWrite(true);
+           }
         }
      else {
         if (access(fileName, R_OK) == 0) {
@@ -3042,6 +3450,20 @@ cUnbufferedFile *cFileName::NextFile(void)
   return SetOffset(fileNumber + 1);
 }
 
+void cFileName::SetAsyncWrite(bool On)
+{
+  asyncWrite = On;
+  if (file && record)
+     file->SetAsyncWrite(On);
+}
+
+void cFileName::SetWriteLatencies(cWriteLatencies *Latencies)
+{
+  writeLatencies = Latencies;
+  if (file && record)
+     file->SetWriteLatencies(Latencies);
+}
+
 // --- Index stuff -----------------------------------------------------------
 
 cString IndexToHMSF(int Index, bool WithFrame, double FramesPerSecond)
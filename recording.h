@@ -452,6 +452,8 @@ private:
   cString fileName;
   int size, last;
   tIndexTs *index;
+  size_t mappedSize; // if index is mmap()ed, this is the size of the mapping (in bytes)
+  cVector<int> iFrames; // the indexes of all independent frames, in ascending order
   bool isPesRecording;
   cResumeFile resumeFile;
   cIndexFileGenerator *indexFileGenerator;
@@ -459,6 +461,12 @@ private:
   void ConvertFromPes(tIndexTs *IndexTs, int Count);
   void ConvertToPes(tIndexTs *IndexTs, int Count);
   bool CatchUp(int Index = -1);
+  void FreeIndex(void);
+  void AddIFrames(int From);
+       ///< Adds the independent frames in index[From...last] to iFrames.
+  int NumIFrames(int Index);
+       ///< Returns the number of independent frames with an index less than or
+       ///< equal to Index.
 public:
   cIndexFile(const char *FileName, bool Record, bool IsPesRecording = false, bool PauseLive = false, bool Update = false);
   ~cIndexFile();
@@ -492,6 +500,8 @@ private:
   bool record;
   bool blocking;
   bool isPesRecording;
+  bool asyncWrite;
+  cWriteLatencies *writeLatencies;
 public:
   cFileName(const char *FileName, bool Record, bool Blocking = false, bool IsPesRecording = false);
   ~cFileName();
@@ -502,6 +512,12 @@ public:
   void Close(void);
   cUnbufferedFile *SetOffset(int Number, off_t Offset = 0); // yes, Number is int for easier internal calculating
   cUnbufferedFile *NextFile(void);
+  void SetAsyncWrite(bool On);
+       ///< Makes all files opened for recording write their data asynchronously
+       ///< (see cUnbufferedFile::SetAsyncWrite()).
+  void SetWriteLatencies(cWriteLatencies *Latencies);
+       ///< Makes all files opened for recording count the time their write() calls
+       ///< take in Latencies (see cUnbufferedFile::SetWriteLatencies()).
   };
 
 cString IndexToHMSF(int Index, bool WithFrame = false, double FramesPerSecond = DEFAULTFRAMESPERSECOND);
@@ -525,6 +541,12 @@ bool GenerateIndex(const char *FileName, bool Update = false);
        ///< complete, and will be updated if it isn't. Otherwise an existing index
        ///< file will be removed before a new one is generated.
 
+bool GenerateIndexes(const char *DirName);
+       ///< Generates the index files of all TS recordings in the directory tree
+       ///< starting at DirName. Any existing index files will be removed before the
+       ///< new ones are generated. Several recordings are processed at the same time,
+       ///< so that all available CPU cores are used.
+
 enum eRecordingsSortDir { rsdAscending, rsdDescending };
 enum eRecordingsSortMode { rsmName, rsmTime };
 extern eRecordingsSortMode RecordingsSortMode;
@@ -8,6 +8,12 @@
  */
 
 #include "remux.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 #include "device.h"
 #include "libsi/si.h"
 #include "libsi/section.h"
@@ -241,6 +247,47 @@ int64_t PtsDiff(int64_t Pts1, int64_t Pts2)
   return d;
 }
 
+// --- Start code search -----------------------------------------------------
+
+static int FindStartCodePrefix(const uchar *Data, int Length)
+{
+  // Returns the offset of the first 00 00 01 sequence in Data, or -1 if there is none.
+  int i = 0;
+#if defined(__AVX2__)
+  const __m256i Zero32 = _mm256_setzero_si256();
+  const __m256i One32 = _mm256_set1_epi8(0x01);
+  for (; i + 2 + 32 <= Length; i += 32) {
+      __m256i b0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(Data + i)), Zero32);
+      __m256i b1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(Data + i + 1)), Zero32);
+      __m256i b2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(Data + i + 2)), One32);
+      uint32_t Mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(b0, b1), b2));
+      if (Mask)
+         return i + __builtin_ctz(Mask);
+      }
+#endif
+#if defined(__SSE2__)
+  const __m128i Zero16 = _mm_setzero_si128();
+  const __m128i One16 = _mm_set1_epi8(0x01);
+  for (; i + 2 + 16 <= Length; i += 16) {
+      __m128i b0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(Data + i)), Zero16);
+      __m128i b1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(Data + i + 1)), Zero16);
+      __m128i b2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(Data + i + 2)), One16);
+      int Mask = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(b0, b1), b2));
+      if (Mask)
+         return i + __builtin_ctz(Mask);
+      }
+#endif
+  while (i + 2 < Length) {
+        if (Data[i + 2] > 0x01)
+           i += 3; // none of these three bytes can be the start of a prefix
+        else if (Data[i + 2] == 0x01 && Data[i + 1] == 0x00 && Data[i] == 0x00)
+           return i;
+        else
+           i++;
+        }
+  return -1;
+}
+
 // --- cTsPayload ------------------------------------------------------------
 
 cTsPayload::cTsPayload(void)
@@ -337,7 +384,10 @@ bool cTsPayload::Find(uint32_t Code)
   int OldNumPacketsPid = numPacketsPid;
   int OldNumPacketsOther = numPacketsOther;
   uint32_t Scanner = EMPTY_SCANNER;
+  bool IsStartCode = (Code & 0xFFFFFF00) == 0x00000100;
   while (!Eof()) {
+        if (IsStartCode)
+           SkipToStartCode(Scanner);
         Scanner = (Scanner << 8) | GetByte();
         if (Scanner == Code)
            return true;
@@ -348,6 +398,33 @@ bool cTsPayload::Find(uint32_t Code)
   return false;
 }
 
+static bool SkipToStartCodes = true;
+
+void cTsPayload::SetSkipToStartCode(bool On)
+{
+  SkipToStartCodes = On;
+}
+
+void cTsPayload::SkipToStartCode(uint32_t &Scanner)
+{
+  if (!SkipToStartCodes)
+     return;
+  if (index % TS_SIZE == 0 || index >= length)
+     return; // the next byte is a TS header, which GetByte() needs to handle
+  if ((Scanner & 0xFF) <= 0x01)
+     return; // the bytes already in Scanner might be part of a start code
+  int End = (index / TS_SIZE + 1) * TS_SIZE; // GetByte() made sure this TS packet is complete
+  int NewIndex = FindStartCodePrefix(data + index, End - index);
+  if (NewIndex >= 0)
+     NewIndex += index;
+  else
+     NewIndex = End - 2; // these bytes might be the start of a prefix in the next TS packet
+  for (int i = max(index, NewIndex - 4); i < NewIndex; i++)
+      Scanner = (Scanner << 8) | data[i];
+  if (NewIndex > index)
+     index = NewIndex;
+}
+
 void cTsPayload::Statistics(void) const
 {
   if (numPacketsPid + numPacketsOther > WRN_TS_PACKETS_FOR_FRAME_DETECTOR)
@@ -1257,6 +1334,7 @@ int cMpeg2Parser::Parse(const uchar *Data, int Length, int Pid)
   for (;;) {
       if (!SeenPayloadStart && tsPayload.AtTsStart())
          OldScanner = scanner;
+      tsPayload.SkipToStartCode(scanner);
       scanner = (scanner << 8) | tsPayload.GetByte();
       if (scanner == 0x00000100) { // Picture Start Code
          if (!SeenPayloadStart && tsPayload.GetLastIndex() > TS_SIZE) {
@@ -1421,6 +1499,7 @@ int cH264Parser::Parse(const uchar *Data, int Length, int Pid)
         }
      }
   for (;;) {
+      tsPayload.SkipToStartCode(scanner);
       scanner = (scanner << 8) | GetByte(true);
       if ((scanner & 0xFFFFFF00) == 0x00000100) { // NAL unit start
          uchar NalUnitType = scanner & 0x1F;
@@ -1589,6 +1668,7 @@ int cH265Parser::Parse(const uchar *Data, int Length, int Pid)
      scanner = EMPTY_SCANNER;
      }
   for (;;) {
+      tsPayload.SkipToStartCode(scanner);
       scanner = (scanner << 8) | GetByte(true);
       if ((scanner & 0xFFFFFF00) == 0x00000100) { // NAL unit start
          uchar NalUnitType = (scanner >> 1) & 0x3F;
@@ -288,6 +288,15 @@ public:
        ///< Find() can be performed starting at the same index..
        ///< The special code 0xFFFFFFFF can not be searched, because this value is used
        ///< to initialize the scanner.
+  void SkipToStartCode(uint32_t &Scanner);
+       ///< Skips all bytes in the rest of the current TS packet that can't be part of a
+       ///< start code (00 00 01 xx), and updates Scanner as if these bytes had been read
+       ///< with GetByte(). If Scanner is used as in 'Scanner = (Scanner << 8) | GetByte()'
+       ///< after this call, no start code will be missed. This never skips the TS header
+       ///< of the next packet, so any checks like AtPayloadStart() still work as before.
+  static void SetSkipToStartCode(bool On);
+       ///< Turns the skipping done by SkipToStartCode() on or off (it is on by default).
+       ///< This is only meant for measuring what the skipping gains.
   };
 
 // PAT/PMT Generator:
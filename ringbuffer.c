@@ -12,6 +12,8 @@
 
 #include "ringbuffer.h"
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include "tools.h"
 
@@ -33,7 +35,10 @@ cRingBuffer::cRingBuffer(int Size, bool Statistics)
   putTimeout = getTimeout = 0;
   lastOverflowReport = 0;
   overflowCount = overflowBytes = 0;
+  overflowTotal = 0;
   ioThrottle = NULL;
+  singleProducerConsumer = false;
+  waitingForPut = waitingForGet = false;
 }
 
 cRingBuffer::~cRingBuffer()
@@ -62,28 +67,65 @@ void cRingBuffer::UpdatePercentage(int Fill)
      }
 }
 
+// In single producer/consumer mode the waiting thread announces that it is
+// about to go to sleep, and the other thread only signals it if it actually
+// does so. The fences make sure that either the sleeper sees the new data, or
+// the other thread sees the sleeper (like with a futex).
+
 void cRingBuffer::WaitForPut(void)
 {
-  if (putTimeout)
-     readyForPut.Wait(putTimeout);
+  if (putTimeout) {
+     if (singleProducerConsumer) {
+        waitingForPut.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (Free() <= Size() / 10)
+           readyForPut.Wait(putTimeout);
+        waitingForPut.store(false, std::memory_order_relaxed);
+        }
+     else
+        readyForPut.Wait(putTimeout);
+     }
 }
 
 void cRingBuffer::WaitForGet(void)
 {
-  if (getTimeout)
-     readyForGet.Wait(getTimeout);
+  if (getTimeout) {
+     if (singleProducerConsumer) {
+        waitingForGet.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (Available() <= Size() / 10)
+           readyForGet.Wait(getTimeout);
+        waitingForGet.store(false, std::memory_order_relaxed);
+        }
+     else
+        readyForGet.Wait(getTimeout);
+     }
 }
 
 void cRingBuffer::EnablePut(void)
 {
-  if (putTimeout && Free() > Size() / 10)
-     readyForPut.Signal();
+  if (putTimeout) {
+     if (singleProducerConsumer) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!waitingForPut.load(std::memory_order_relaxed))
+           return;
+        }
+     if (Free() > Size() / 10)
+        readyForPut.Signal();
+     }
 }
 
 void cRingBuffer::EnableGet(void)
 {
-  if (getTimeout && Available() > Size() / 10)
-     readyForGet.Signal();
+  if (getTimeout) {
+     if (singleProducerConsumer) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!waitingForGet.load(std::memory_order_relaxed))
+           return;
+        }
+     if (Available() > Size() / 10)
+        readyForGet.Signal();
+     }
 }
 
 void cRingBuffer::SetTimeouts(int PutTimeout, int GetTimeout)
@@ -92,6 +134,11 @@ void cRingBuffer::SetTimeouts(int PutTimeout, int GetTimeout)
   getTimeout = GetTimeout;
 }
 
+void cRingBuffer::SetSingleProducerConsumer(void)
+{
+  singleProducerConsumer = true;
+}
+
 void cRingBuffer::SetIoThrottle(void)
 {
   if (!ioThrottle)
@@ -102,6 +149,7 @@ void cRingBuffer::ReportOverflow(int Bytes)
 {
   overflowCount++;
   overflowBytes += Bytes;
+  overflowTotal += Bytes;
   if (time(NULL) - lastOverflowReport > OVERFLOWREPORTDELTA) {
      esyslog("ERROR: %d ring buffer overflow%s (%d bytes dropped)", overflowCount, overflowCount > 1 ? "s" : "", overflowBytes);
      overflowCount = overflowBytes = 0;
@@ -171,9 +219,14 @@ cRingBufferLinear::cRingBufferLinear(int Size, int Margin, bool Statistics, cons
 :cRingBuffer(Size, Statistics)
 {
   description = Description ? strdup(Description) : NULL;
-  tail = head = margin = Margin;
+  margin = Margin;
+  head.store(Margin, std::memory_order_relaxed);
+  tail.store(Margin, std::memory_order_relaxed);
+  released.store(Margin, std::memory_order_relaxed);
+  deferredRelease = false;
   gotten = 0;
   buffer = NULL;
+  mappedSize = 0;
   if (Size > 1) { // 'Size - 1' must not be 0!
      if (Margin <= Size / 2) {
         buffer = MALLOC(uchar, Size);
@@ -187,8 +240,8 @@ cRingBufferLinear::cRingBufferLinear(int Size, int Margin, bool Statistics, cons
   else
      esyslog("ERROR: invalid size for ring buffer (%d)", Size);
 #ifdef DEBUGRINGBUFFERS
-  lastHead = head;
-  lastTail = tail;
+  lastHead = Margin;
+  lastTail = Margin;
   lastPut = lastGet = -1;
   AddDebugRBL(this);
 #endif
@@ -199,7 +252,10 @@ cRingBufferLinear::~cRingBufferLinear()
 #ifdef DEBUGRINGBUFFERS
   DelDebugRBL(this);
 #endif
-  free(buffer);
+  if (mappedSize)
+     munmap(buffer, mappedSize);
+  else
+     free(buffer);
   free(description);
 }
 
@@ -210,17 +266,18 @@ int cRingBufferLinear::DataReady(const uchar *Data, int Count)
 
 int cRingBufferLinear::Available(void)
 {
-  int diff = head - tail;
+  int diff = head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
   return (diff >= 0) ? diff : Size() + diff - margin;
 }
 
 void cRingBufferLinear::Clear(void)
 {
-  int Head = head;
-  tail = Head;
+  int Head = head.load(std::memory_order_acquire);
+  tail.store(Head, std::memory_order_release);
+  released.store(Head, std::memory_order_release);
 #ifdef DEBUGRINGBUFFERS
   lastHead = Head;
-  lastTail = tail;
+  lastTail = Head;
   lastPut = lastGet = -1;
 #endif
   maxFill = 0;
@@ -229,9 +286,10 @@ void cRingBufferLinear::Clear(void)
 
 int cRingBufferLinear::Read(int FileHandle, int Max)
 {
-  int Tail = tail;
-  int diff = Tail - head;
-  int free = (diff > 0) ? diff - 1 : Size() - head;
+  int Tail = FreeTail();
+  int Head = head.load(std::memory_order_relaxed);
+  int diff = Tail - Head;
+  int free = (diff > 0) ? diff - 1 : Size() - Head;
   if (Tail <= margin)
      free--;
   int Count = -1;
@@ -239,14 +297,14 @@ int cRingBufferLinear::Read(int FileHandle, int Max)
   if (free > 0) {
      if (0 < Max && Max < free)
         free = Max;
-     Count = safe_read(FileHandle, buffer + head, free);
+     Count = safe_read(FileHandle, buffer + Head, free);
      if (Count > 0) {
-        int Head = head + Count;
+        Head += Count;
         if (Head >= Size())
            Head = margin;
-        head = Head;
+        head.store(Head, std::memory_order_release);
         if (statistics) {
-           int fill = head - Tail;
+           int fill = Head - Tail;
            if (fill < 0)
               fill = Size() + fill;
            else if (fill >= Size())
@@ -256,7 +314,7 @@ int cRingBufferLinear::Read(int FileHandle, int Max)
         }
      }
 #ifdef DEBUGRINGBUFFERS
-  lastHead = head;
+  lastHead = head.load(std::memory_order_relaxed);
   lastPut = Count;
 #endif
   EnableGet();
@@ -267,9 +325,10 @@ int cRingBufferLinear::Read(int FileHandle, int Max)
 
 int cRingBufferLinear::Read(cUnbufferedFile *File, int Max)
 {
-  int Tail = tail;
-  int diff = Tail - head;
-  int free = (diff > 0) ? diff - 1 : Size() - head;
+  int Tail = FreeTail();
+  int Head = head.load(std::memory_order_relaxed);
+  int diff = Tail - Head;
+  int free = (diff > 0) ? diff - 1 : Size() - Head;
   if (Tail <= margin)
      free--;
   int Count = -1;
@@ -277,14 +336,14 @@ int cRingBufferLinear::Read(cUnbufferedFile *File, int Max)
   if (free > 0) {
      if (0 < Max && Max < free)
         free = Max;
-     Count = File->Read(buffer + head, free);
+     Count = File->Read(buffer + Head, free);
      if (Count > 0) {
-        int Head = head + Count;
+        Head += Count;
         if (Head >= Size())
            Head = margin;
-        head = Head;
+        head.store(Head, std::memory_order_release);
         if (statistics) {
-           int fill = head - Tail;
+           int fill = Head - Tail;
            if (fill < 0)
               fill = Size() + fill;
            else if (fill >= Size())
@@ -294,7 +353,7 @@ int cRingBufferLinear::Read(cUnbufferedFile *File, int Max)
         }
      }
 #ifdef DEBUGRINGBUFFERS
-  lastHead = head;
+  lastHead = head.load(std::memory_order_relaxed);
   lastPut = Count;
 #endif
   EnableGet();
@@ -306,9 +365,10 @@ int cRingBufferLinear::Read(cUnbufferedFile *File, int Max)
 int cRingBufferLinear::Put(const uchar *Data, int Count)
 {
   if (Count > 0) {
-     int Tail = tail;
-     int rest = Size() - head;
-     int diff = Tail - head;
+     int Tail = FreeTail();
+     int Head = head.load(std::memory_order_relaxed);
+     int rest = Size() - Head;
+     int diff = Tail - Head;
      int free = ((Tail < margin) ? rest : (diff > 0) ? diff : Size() + diff - margin) - 1;
      if (statistics) {
         int fill = Size() - free - 1 + Count;
@@ -320,20 +380,20 @@ int cRingBufferLinear::Put(const uchar *Data, int Count)
         if (free < Count)
            Count = free;
         if (Count >= rest) {
-           memcpy(buffer + head, Data, rest);
+           memcpy(buffer + Head, Data, rest);
            if (Count - rest)
               memcpy(buffer + margin, Data + rest, Count - rest);
-           head = margin + Count - rest;
+           head.store(margin + Count - rest, std::memory_order_release);
            }
         else {
-           memcpy(buffer + head, Data, Count);
-           head += Count;
+           memcpy(buffer + Head, Data, Count);
+           head.store(Head + Count, std::memory_order_release);
            }
         }
      else
         Count = 0;
 #ifdef DEBUGRINGBUFFERS
-     lastHead = head;
+     lastHead = head.load(std::memory_order_relaxed);
      lastPut = Count;
 #endif
      EnableGet();
@@ -345,21 +405,23 @@ int cRingBufferLinear::Put(const uchar *Data, int Count)
 
 uchar *cRingBufferLinear::Get(int &Count)
 {
-  int Head = head;
+  int Head = head.load(std::memory_order_acquire);
+  int Tail = tail.load(std::memory_order_relaxed);
   if (getThreadTid <= 0)
      getThreadTid = cThread::ThreadId();
-  int rest = Size() - tail;
-  if (rest < margin && Head < tail) {
+  int rest = Size() - Tail;
+  if (rest < margin && Head < Tail) {
      int t = margin - rest;
-     memcpy(buffer + t, buffer + tail, rest);
-     tail = t;
-     rest = Head - tail;
+     memcpy(buffer + t, buffer + Tail, rest);
+     Tail = t;
+     tail.store(Tail, std::memory_order_release);
+     rest = Head - Tail;
      }
-  int diff = Head - tail;
+  int diff = Head - Tail;
   int cont = (diff >= 0) ? diff : Size() + diff - margin;
   if (cont > rest)
      cont = rest;
-  uchar *p = buffer + tail;
+  uchar *p = buffer + Tail;
   if ((cont = DataReady(p, cont)) > 0) {
      Count = gotten = cont;
      return p;
@@ -375,20 +437,73 @@ void cRingBufferLinear::Del(int Count)
      Count = gotten;
      }
   if (Count > 0) {
-     int Tail = tail;
+     int Tail = tail.load(std::memory_order_relaxed);
      Tail += Count;
      gotten -= Count;
      if (Tail >= Size())
         Tail = margin;
-     tail = Tail;
+     tail.store(Tail, std::memory_order_release);
      EnablePut();
      }
 #ifdef DEBUGRINGBUFFERS
-  lastTail = tail;
+  lastTail = tail.load(std::memory_order_relaxed);
   lastGet = Count;
 #endif
 }
 
+void cRingBufferLinear::SetDeferredRelease(void)
+{
+  deferredRelease = true;
+}
+
+#define HUGEPAGESIZE  MEGABYTE(2)
+#define MPOL_BIND_    2 // from <numaif.h>, which would require libnuma
+
+bool cRingBufferLinear::SetHugePages(int NumaNode)
+{
+  if (!buffer || mappedSize)
+     return false;
+  size_t MapSize = (Size() + HUGEPAGESIZE - 1) / HUGEPAGESIZE * HUGEPAGESIZE;
+  bool Reserved = true;
+  void *p = mmap(NULL, MapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p == MAP_FAILED) {
+     // No huge pages reserved, so let's at least ask for transparent ones:
+     Reserved = false;
+     p = mmap(NULL, MapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+     if (p == MAP_FAILED) {
+        LOG_ERROR;
+        return false;
+        }
+     if (madvise(p, MapSize, MADV_HUGEPAGE) < 0)
+        dsyslog("ring buffer %s: no transparent huge pages available", description ? description : "");
+     }
+  if (NumaNode >= 0) {
+     // Binding must take place before the pages are touched for the first time:
+     unsigned long NodeMask[4] = { 0 };
+     if (NumaNode < int(sizeof(NodeMask) * 8)) {
+        NodeMask[NumaNode / (sizeof(NodeMask[0]) * 8)] |= 1UL << (NumaNode % (sizeof(NodeMask[0]) * 8));
+        if (syscall(SYS_mbind, p, MapSize, MPOL_BIND_, NodeMask, sizeof(NodeMask) * 8, 0) < 0)
+           esyslog("ERROR: can't bind ring buffer %s to NUMA node %d: %m", description ? description : "", NumaNode);
+        }
+     }
+  memset(p, 0, MapSize); // faults in all pages on the selected node
+  free(buffer);
+  buffer = (uchar *)p;
+  mappedSize = MapSize;
+  Clear();
+  dsyslog("ring buffer %s: using %s huge pages (%d MB, NUMA node %d)", description ? description : "", Reserved ? "reserved" : "transparent", int(MapSize / MEGABYTE(1)), NumaNode);
+  return true;
+}
+
+void cRingBufferLinear::Release(const uchar *Data, int Count)
+{
+  int Released = Data - buffer + Count;
+  if (Released >= Size())
+     Released = margin;
+  released.store(Released, std::memory_order_release);
+  EnablePut();
+}
+
 // --- cFrame ----------------------------------------------------------------
 
 cFrame::cFrame(const uchar *Data, int Count, eFrameType Type, int Index, uint32_t Pts, bool Independent)
@@ -10,6 +10,7 @@
 #ifndef __RINGBUFFER_H
 #define __RINGBUFFER_H
 
+#include <atomic>
 #include "thread.h"
 #include "tools.h"
 
@@ -22,7 +23,10 @@ private:
   time_t lastOverflowReport;
   int overflowCount;
   int overflowBytes;
+  std::atomic<uint64_t> overflowTotal;
   cIoThrottle *ioThrottle;
+  bool singleProducerConsumer;
+  std::atomic<bool> waitingForPut, waitingForGet;
 protected:
   tThreadId getThreadTid;
   int maxFill;//XXX
@@ -42,7 +46,20 @@ public:
   virtual ~cRingBuffer();
   void SetTimeouts(int PutTimeout, int GetTimeout);
   void SetIoThrottle(void);
+  void SetSingleProducerConsumer(void);
+       ///< Tells the ring buffer that data will only ever be put into it by one
+       ///< thread, and taken out of it by one other thread. In this mode a thread
+       ///< that waits for data (or free space) is only signaled if it is actually
+       ///< sleeping, which avoids the mutex and condition variable overhead of
+       ///< waking it up with every single Put() or Del().
+       ///< Must be called before the buffer is used.
   void ReportOverflow(int Bytes);
+  int MaxFill(void) const { return maxFill; }
+       ///< Returns the highest number of bytes that have been stored in this ring
+       ///< buffer so far. Only available if the buffer was created with Statistics.
+  uint64_t OverflowedBytes(void) const { return overflowTotal; }
+       ///< Returns the total number of bytes that have been reported as dropped
+       ///< through ReportOverflow() so far.
   };
 
 class cRingBufferLinear : public cRingBuffer {
@@ -58,10 +75,16 @@ public:
   static void PrintDebugRBL(void);
 #endif
 private:
-  int margin, head, tail;
+  int margin;
+  std::atomic<int> head, tail;
+  std::atomic<int> released;
+  bool deferredRelease;
   int gotten;
   uchar *buffer;
+  size_t mappedSize;
   char *description;
+  int FreeTail(void) { return (deferredRelease ? released : tail).load(std::memory_order_acquire); }
+       ///< Returns the index up to which the buffer may be filled with new data.
 protected:
   virtual int DataReady(const uchar *Data, int Count);
     ///< By default a ring buffer has data ready as soon as there are at least
@@ -102,6 +125,22 @@ public:
     ///< Deletes at most Count bytes from the ring buffer.
     ///< Count must be less or equal to the number that was returned by a previous
     ///< call to Get().
+  void SetDeferredRelease(void);
+    ///< Tells the ring buffer that data deleted with Del() is still in use (for
+    ///< instance because it is being written to disk by another thread) and must
+    ///< not be overwritten before a call to Release() allows it.
+    ///< Must be called before the buffer is used.
+  void Release(const uchar *Data, int Count);
+    ///< Releases the given Data, which must have been returned by Get() and then
+    ///< deleted with Del(). Data must be released in the same order it was gotten.
+    ///< May be called from any thread.
+  bool SetHugePages(int NumaNode = -1);
+    ///< Moves the buffer into memory that is backed by huge pages, which reduces
+    ///< TLB misses with large buffers. If NumaNode is not negative, the memory is
+    ///< bound to that NUMA node. If no huge pages have been reserved in the system,
+    ///< transparent huge pages are requested instead.
+    ///< Must be called before the buffer is used.
+    ///< Returns true if the buffer has been moved.
   };
 
 enum eFrameType { ftUnknown, ftVideo, ftAudio, ftDolby };
@@ -10,15 +10,26 @@
 #include "sections.h"
 #include <unistd.h>
 #include "channels.h"
+#include "config.h"
 #include "device.h"
+#include "libsi/util.h"
+#include "receiver.h"
+#include "ringbuffer.h"
 #include "thread.h"
 
+#define MAXSECTIONSIZE    4096 // max. allowed size for any section
+#define SECTIONBUFFERSIZE MEGABYTE(1)
+#define SECTIONWAIT        100 // ms to wait for sections from the demultiplexer
+#define MAXSECTIONBATCH    100 // the maximum number of sections distributed in one go
+#define ATTACHRETRYDELTA    10 // seconds before trying again to attach the demultiplexer
+#define MAXDEMUXPIDS        32 // the maximum number of PIDs the demultiplexer receives, so that the device has enough PID handles left for other receivers
+
 // --- cFilterHandle----------------------------------------------------------
 
 class cFilterHandle : public cListObject {
 public:
   cFilterData filterData;
-  int handle;
+  int handle; // -1 if the sections are extracted by the demultiplexer
   int used;
   cFilterHandle(const cFilterData &FilterData);
   };
@@ -30,13 +41,275 @@ cFilterHandle::cFilterHandle(const cFilterData &FilterData)
   used = 0;
 }
 
+// --- cSectionDemux ---------------------------------------------------------
+
+// Extracts sections from TS packets. The packets are delivered by the device
+// this receiver is attached to, the complete sections are collected in a ring
+// buffer, from where the section handler's thread takes them.
+
+class cSectionDemux : public cReceiver {
+private:
+  struct tPid {
+    uint16_t tidRefs[256]; // the number of filters that want each table id
+    int numFilters;
+    int cc;                // the continuity counter of the last TS packet
+    int length;            // the number of bytes collected of the current section
+    uchar data[MAXSECTIONSIZE];
+    };
+  cMutex mutex;
+  tPid *pids[MAXPID];
+  cRingBufferFrame ringBuffer;
+  cCondWait newSection;
+  bool flush;
+  time_t lastCrcError;
+  int crcErrors;
+  int Collect(int Pid, tPid *p, const uchar *Data, int Length);
+  void Deliver(int Pid, tPid *p);
+protected:
+  virtual void Activate(bool On);
+  virtual void Receive(const uchar *Data, int Length);
+public:
+  cSectionDemux(void);
+  virtual ~cSectionDemux();
+  bool Add(int Pid, int Tid, int Mask);
+       ///< Adds a filter for the sections with the given Pid, Tid and Mask.
+       ///< Returns false if the TS packets with the given Pid can't be received,
+       ///< in which case a section filter of the device has to be used instead.
+  void Del(int Pid, int Tid, int Mask);
+       ///< Deletes a filter that has been added with the same parameters.
+  void Flush(void);
+       ///< Discards all sections that have been received so far.
+  cFrame *Get(void);
+       ///< Returns the next section (with its PID in Index()), or NULL if there
+       ///< is none. The section must be given back through a call to Drop().
+  void Drop(cFrame *Frame) { ringBuffer.Drop(Frame); }
+  void Wait(void) { newSection.Wait(SECTIONWAIT); }
+       ///< Waits until a new section has been received, but at most SECTIONWAIT ms.
+  };
+
+cSectionDemux::cSectionDemux(void)
+:cReceiver(NULL, MINPRIORITY)
+,ringBuffer(SECTIONBUFFERSIZE)
+{
+  memset(pids, 0, sizeof(pids));
+  flush = false;
+  lastCrcError = 0;
+  crcErrors = 0;
+}
+
+cSectionDemux::~cSectionDemux()
+{
+  Detach();
+  for (int i = 0; i < MAXPID; i++)
+      free(pids[i]);
+}
+
+bool cSectionDemux::Add(int Pid, int Tid, int Mask)
+{
+  if (Pid <= 0 || Pid >= MAXPID)
+     return false; // PID 0 (the PAT) is never delivered to receivers
+  mutex.Lock();
+  tPid *p = pids[Pid];
+  mutex.Unlock();
+  if (!p) {
+     if (NumPids() >= MAXDEMUXPIDS)
+        return false;
+     p = (tPid *)calloc(1, sizeof(tPid));
+     if (!p) {
+        esyslog("ERROR: out of memory");
+        return false;
+        }
+     p->cc = -1;
+     if (!AddPid(Pid)) { // outside the lock, because the device calls Receive() with its own lock held
+        free(p);
+        return false;
+        }
+     mutex.Lock();
+     pids[Pid] = p;
+     mutex.Unlock();
+     }
+  cMutexLock MutexLock(&mutex);
+  for (int t = 0; t < 256; t++) {
+      if ((t & Mask) == (Tid & Mask))
+         p->tidRefs[t]++;
+      }
+  p->numFilters++;
+  return true;
+}
+
+void cSectionDemux::Del(int Pid, int Tid, int Mask)
+{
+  if (Pid < 0 || Pid >= MAXPID)
+     return;
+  mutex.Lock();
+  bool LastFilter = false;
+  if (tPid *p = pids[Pid]) {
+     for (int t = 0; t < 256; t++) {
+         if ((t & Mask) == (Tid & Mask) && p->tidRefs[t])
+            p->tidRefs[t]--;
+         }
+     if (--p->numFilters <= 0) {
+        free(p);
+        pids[Pid] = NULL;
+        LastFilter = true;
+        }
+     }
+  mutex.Unlock();
+  if (LastFilter)
+     DelPid(Pid);
+}
+
+void cSectionDemux::Flush(void)
+{
+  cMutexLock MutexLock(&mutex);
+  flush = true;
+}
+
+void cSectionDemux::Activate(bool On)
+{
+  cMutexLock MutexLock(&mutex);
+  for (int i = 0; i < MAXPID; i++) {
+      if (tPid *p = pids[i]) {
+         p->cc = -1;
+         p->length = 0;
+         }
+      }
+}
+
+void cSectionDemux::Deliver(int Pid, tPid *p)
+{
+  const uchar *s = p->data;
+  if (!p->tidRefs[s[0]])
+     return;
+  if ((s[1] & 0x80) && !SI::CRC32::isValid((const char *)s, p->length)) { // only sections with section_syntax_indicator have a CRC
+     crcErrors++;
+     if (time(NULL) - lastCrcError > 10) { // log them only every 10 seconds
+        dsyslog("%d section%s with CRC errors on device %d", crcErrors, crcErrors > 1 ? "s" : "", Device() ? Device()->DeviceNumber() + 1 : 0);
+        crcErrors = 0;
+        lastCrcError = time(NULL);
+        }
+     return;
+     }
+  cFrame *Frame = new cFrame(s, p->length, ftUnknown, Pid);
+  if (ringBuffer.Put(Frame))
+     newSection.Signal();
+  else {
+     ringBuffer.ReportOverflow(p->length);
+     delete Frame;
+     }
+}
+
+int cSectionDemux::Collect(int Pid, tPid *p, const uchar *Data, int Length)
+{
+  int Used = 0;
+  while (Used < Length) {
+        int Total = p->length < 3 ? 3 : (((p->data[1] & 0x0F) << 8) | p->data[2]) + 3;
+        if (Total > MAXSECTIONSIZE || p->length >= 3 && Total <= 3) { // a section_length of 0 is invalid
+           p->length = 0;
+           return Length;
+           }
+        int n = min(Total - p->length, Length - Used);
+        memcpy(p->data + p->length, Data + Used, n);
+        p->length += n;
+        Used += n;
+        if (p->length == Total && Total > 3) {
+           Deliver(Pid, p);
+           p->length = 0;
+           break;
+           }
+        }
+  return Used;
+}
+
+void cSectionDemux::Receive(const uchar *Data, int Length)
+{
+  if (TsError(Data) || TsIsScrambled(Data) || !TsHasPayload(Data))
+     return;
+  int Pid = TsPid(Data);
+  cMutexLock MutexLock(&mutex);
+  tPid *p = pids[Pid];
+  if (!p)
+     return;
+  int cc = TsContinuityCounter(Data);
+  if (cc == p->cc)
+     return; // duplicate packet
+  if (p->cc >= 0 && cc != ((p->cc + 1) & TS_CONT_CNT_MASK))
+     p->length = 0; // packets have been lost
+  p->cc = cc;
+  const uchar *d = Data + TsPayloadOffset(Data);
+  int n = Data + TS_SIZE - d;
+  if (TsPayloadStart(Data)) {
+     if (n <= 0)
+        return;
+     int Pointer = *d++;
+     n--;
+     if (Pointer > n) {
+        p->length = 0;
+        return;
+        }
+     if (p->length)
+        Collect(Pid, p, d, Pointer); // the end of the previous section
+     p->length = 0;
+     d += Pointer;
+     n -= Pointer;
+     while (n > 0 && *d != 0xFF) { // 0xFF is stuffing
+           int Used = Collect(Pid, p, d, n);
+           d += Used;
+           n -= Used;
+           if (p->length)
+              break; // the section continues in the next TS packet
+           }
+     }
+  else if (p->length)
+     Collect(Pid, p, d, n);
+}
+
+cFrame *cSectionDemux::Get(void)
+{
+  mutex.Lock();
+  bool Flush = flush;
+  flush = false;
+  mutex.Unlock();
+  if (Flush)
+     ringBuffer.Clear();
+  return ringBuffer.Get();
+}
+
 // --- cSectionHandlerPrivate ------------------------------------------------
 
 class cSectionHandlerPrivate {
 public:
   cChannel channel;
+  cVector<cFilter *> **matchingFilters[MAXPID]; // for each PID the filters that want the sections with a given table id (built when needed)
+  int matchingStatusCount; // the status count of the section handler when matchingFilters was cleared
+  cSectionHandlerPrivate(void);
+  ~cSectionHandlerPrivate();
+  void ClearMatchingFilters(void);
   };
 
+cSectionHandlerPrivate::cSectionHandlerPrivate(void)
+{
+  memset(matchingFilters, 0, sizeof(matchingFilters));
+  matchingStatusCount = -1;
+}
+
+cSectionHandlerPrivate::~cSectionHandlerPrivate()
+{
+  ClearMatchingFilters();
+}
+
+void cSectionHandlerPrivate::ClearMatchingFilters(void)
+{
+  for (int i = 0; i < MAXPID; i++) {
+      if (cVector<cFilter *> **Tids = matchingFilters[i]) {
+         for (int t = 0; t < 256; t++)
+             delete Tids[t];
+         delete[] Tids;
+         matchingFilters[i] = NULL;
+         }
+      }
+}
+
 // --- cSectionHandler -------------------------------------------------------
 
 cSectionHandler::cSectionHandler(cDevice *Device)
@@ -44,11 +317,13 @@ cSectionHandler::cSectionHandler(cDevice *Device)
 {
   shp = new cSectionHandlerPrivate;
   device = Device;
+  demux = Setup.SoftwareSectionFilters ? new cSectionDemux : NULL;
   SetDescription("device %d section handler", device->DeviceNumber() + 1);
   statusCount = 0;
   on = false;
   waitForLock = false;
   lastIncompleteSection = 0;
+  lastAttach = 0;
   Start();
 }
 
@@ -58,6 +333,7 @@ cSectionHandler::~cSectionHandler()
   cFilter *fi;
   while ((fi = filters.First()) != NULL)
         Detach(fi);
+  delete demux;
   delete shp;
 }
 
@@ -76,6 +352,11 @@ const cChannel *cSectionHandler::Channel(void)
   return &shp->channel;
 }
 
+const cReceiver *cSectionHandler::Receiver(void) const
+{
+  return demux;
+}
+
 void cSectionHandler::Add(const cFilterData *FilterData)
 {
   Lock();
@@ -86,8 +367,14 @@ void cSectionHandler::Add(const cFilterData *FilterData)
          break;
       }
   if (!fh) {
-     int handle = device->OpenFilter(FilterData->pid, FilterData->tid, FilterData->mask);
-     if (handle >= 0) {
+     int handle = -1;
+     bool Demux = demux && demux->Add(FilterData->pid, FilterData->tid, FilterData->mask);
+     if (!Demux) {
+        if (demux && FilterData->pid) // PID 0 always comes from a section filter
+           dsyslog("section demultiplexer of device %d can't receive PID %d - using a section filter", device->DeviceNumber() + 1, FilterData->pid);
+        handle = device->OpenFilter(FilterData->pid, FilterData->tid, FilterData->mask);
+        }
+     if (Demux || handle >= 0) {
         fh = new cFilterHandle(*FilterData);
         fh->handle = handle;
         filterHandles.Add(fh);
@@ -106,7 +393,10 @@ void cSectionHandler::Del(const cFilterData *FilterData)
   for (fh = filterHandles.First(); fh; fh = filterHandles.Next(fh)) {
       if (fh->filterData.Is(FilterData->pid, FilterData->tid, FilterData->mask)) {
          if (--fh->used <= 0) {
-            device->CloseFilter(fh->handle);
+            if (fh->handle < 0)
+               demux->Del(fh->filterData.pid, fh->filterData.tid, fh->filterData.mask);
+            else
+               device->CloseFilter(fh->handle);
             filterHandles.Del(fh);
             break;
             }
@@ -156,6 +446,8 @@ void cSectionHandler::SetStatus(bool On)
             }
         on = On;
         waitForLock = false;
+        if (demux && !On)
+           demux->Flush(); // the sections from the previous transponder are no longer valid
         }
      else
         waitForLock = On;
@@ -163,63 +455,146 @@ void cSectionHandler::SetStatus(bool On)
   Unlock();
 }
 
-void cSectionHandler::Action(void)
+const cVector<cFilter *> &cSectionHandler::MatchingFilters(int Pid, int Tid)
 {
-  while (Running()) {
+  if (shp->matchingStatusCount != statusCount) {
+     // Filters have been attached, detached or changed:
+     shp->ClearMatchingFilters();
+     shp->matchingStatusCount = statusCount;
+     }
+  cVector<cFilter *> **&Tids = shp->matchingFilters[Pid];
+  if (!Tids)
+     Tids = new cVector<cFilter *> *[256]();
+  cVector<cFilter *> *&Filters = Tids[Tid];
+  if (!Filters) {
+     // A filter that is currently off is taken anyway, because its status may change without a change of statusCount:
+     Filters = new cVector<cFilter *>(4);
+     for (cFilter *fi = filters.First(); fi; fi = filters.Next(fi)) {
+         for (cFilterData *fd = fi->data.First(); fd; fd = fi->data.Next(fd)) {
+             if (fd->Matches(Pid, Tid)) {
+                Filters->Append(fi);
+                break;
+                }
+             }
+         }
+     }
+  return *Filters;
+}
 
-        Lock();
-        if (waitForLock)
-           SetStatus(true);
-        int NumFilters = filterHandles.Count();
-        pollfd pfd[NumFilters];
-        for (cFilterHandle *fh = filterHandles.First(); fh; fh = filterHandles.Next(fh)) {
-            int i = fh->Index();
-            pfd[i].fd = fh->handle;
-            pfd[i].events = POLLIN;
-            pfd[i].revents = 0;
+void cSectionHandler::Distribute(int Pid, const uchar *Data, int Length)
+{
+  // Distribute data to all attached filters that want it:
+  if (Pid < 0 || Pid >= MAXPID)
+     return;
+  int Tid = Data[0];
+  const cVector<cFilter *> &Filters = MatchingFilters(Pid, Tid);
+  int OldStatusCount = statusCount;
+  for (int i = 0; i < Filters.Size(); i++) {
+      cFilter *fi = Filters[i];
+      if (fi->Matches(Pid, Tid)) {
+         fi->Process(Pid, Tid, Data, Length);
+         if (statusCount != OldStatusCount) {
+            // The filter has changed the filters, so the rest of them is checked one by one:
+            while ((fi = filters.Next(fi)) != NULL) {
+                  if (fi->Matches(Pid, Tid))
+                     fi->Process(Pid, Tid, Data, Length);
+                  }
+            break;
             }
-        int oldStatusCount = statusCount;
-        Unlock();
-
-        if (poll(pfd, NumFilters, 1000) > 0) {
-           bool DeviceHasLock = device->HasLock();
-           if (!DeviceHasLock)
-              cCondWait::SleepMs(100);
-           for (int i = 0; i < NumFilters; i++) {
-               if (pfd[i].revents & POLLIN) {
-                  cFilterHandle *fh = NULL;
-                  LOCK_THREAD;
-                  if (statusCount != oldStatusCount)
-                     break;
-                  for (fh = filterHandles.First(); fh; fh = filterHandles.Next(fh)) {
-                      if (pfd[i].fd == fh->handle)
-                         break;
-                      }
-                  if (fh) {
-                     // Read section data:
-                     unsigned char buf[4096]; // max. allowed size for any EIT section
-                     int r = device->ReadFilter(fh->handle, buf, sizeof(buf));
-                     if (!DeviceHasLock)
-                        continue; // we do the read anyway, to flush any data that might have come from a different transponder
-                     if (r > 3) { // minimum number of bytes necessary to get section length
-                        int len = (((buf[1] & 0x0F) << 8) | (buf[2] & 0xFF)) + 3;
-                        if (len == r) {
-                           // Distribute data to all attached filters:
-                           int pid = fh->filterData.pid;
-                           int tid = buf[0];
-                           for (cFilter *fi = filters.First(); fi; fi = filters.Next(fi)) {
-                               if (fi->Matches(pid, tid))
-                                  fi->Process(pid, tid, buf, len);
-                               }
-                           }
-                        else if (time(NULL) - lastIncompleteSection > 10) { // log them only every 10 seconds
-                           dsyslog("read incomplete section - len = %d, r = %d", len, r);
-                           lastIncompleteSection = time(NULL);
-                           }
-                        }
+         }
+      }
+}
+
+void cSectionHandler::ProcessDemux(void)
+{
+  Lock();
+  if (waitForLock)
+     SetStatus(true);
+  bool HasPids = demux->NumPids() > 0;
+  Unlock();
+  if (HasPids != demux->IsAttached() && time(NULL) - lastAttach > ATTACHRETRYDELTA) {
+     // The device may have detached the demultiplexer in favor of another receiver:
+     if (HasPids)
+        device->AttachReceiver(demux);
+     else
+        device->Detach(demux);
+     lastAttach = HasPids && !demux->IsAttached() ? time(NULL) : 0;
+     }
+  cFrame *Frame = demux->Get();
+  if (!Frame) {
+     demux->Wait();
+     return;
+     }
+  bool DeviceHasLock = device->HasLock();
+  LOCK_THREAD;
+  for (int i = 0; Frame; Frame = ++i < MAXSECTIONBATCH ? demux->Get() : NULL) {
+      if (DeviceHasLock) // sections that have been received without a lock might come from a different transponder
+         Distribute(Frame->Index(), Frame->Data(), Frame->Count());
+      demux->Drop(Frame);
+      }
+}
+
+void cSectionHandler::ProcessFilterHandles(int TimeoutMs)
+{
+  Lock();
+  if (waitForLock)
+     SetStatus(true);
+  int NumFilters = filterHandles.Count();
+  pollfd pfd[NumFilters];
+  for (cFilterHandle *fh = filterHandles.First(); fh; fh = filterHandles.Next(fh)) {
+      int i = fh->Index();
+      pfd[i].fd = fh->handle; // poll() ignores the negative ones of the demultiplexer
+      pfd[i].events = POLLIN;
+      pfd[i].revents = 0;
+      }
+  int oldStatusCount = statusCount;
+  Unlock();
+
+  if (poll(pfd, NumFilters, TimeoutMs) > 0) {
+     bool DeviceHasLock = device->HasLock();
+     if (!DeviceHasLock)
+        cCondWait::SleepMs(100);
+     for (int i = 0; i < NumFilters; i++) {
+         if (pfd[i].revents & POLLIN) {
+            cFilterHandle *fh = NULL;
+            LOCK_THREAD;
+            if (statusCount != oldStatusCount)
+               break;
+            for (fh = filterHandles.First(); fh; fh = filterHandles.Next(fh)) {
+                if (pfd[i].fd == fh->handle)
+                   break;
+                }
+            if (fh) {
+               // Read section data:
+               unsigned char buf[MAXSECTIONSIZE];
+               int r = device->ReadFilter(fh->handle, buf, sizeof(buf));
+               if (!DeviceHasLock)
+                  continue; // we do the read anyway, to flush any data that might have come from a different transponder
+               if (r > 3) { // minimum number of bytes necessary to get section length
+                  int len = (((buf[1] & 0x0F) << 8) | (buf[2] & 0xFF)) + 3;
+                  if (len == r)
+                     Distribute(fh->filterData.pid, buf, len);
+                  else if (time(NULL) - lastIncompleteSection > 10) { // log them only every 10 seconds
+                     dsyslog("read incomplete section - len = %d, r = %d", len, r);
+                     lastIncompleteSection = time(NULL);
                      }
                   }
                }
+            }
+         }
+     }
+}
+
+void cSectionHandler::Action(void)
+{
+  while (Running()) {
+        if (demux) {
+           ProcessDemux();
+           ProcessFilterHandles(0); // the PAT and any PIDs the demultiplexer can't receive
            }
+        else
+           ProcessFilterHandles(1000);
         }
+  if (demux)
+     device->Detach(demux);
 }
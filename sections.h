@@ -18,6 +18,8 @@
 class cDevice;
 class cChannel;
 class cFilterHandle;
+class cReceiver;
+class cSectionDemux;
 class cSectionHandlerPrivate;
 
 class cSectionHandler : public cThread {
@@ -25,16 +27,29 @@ class cSectionHandler : public cThread {
 private:
   cSectionHandlerPrivate *shp;
   cDevice *device;
+  cSectionDemux *demux;
   int statusCount;
   bool on, waitForLock;
   time_t lastIncompleteSection;
+  time_t lastAttach;
   cList<cFilter> filters;
   cList<cFilterHandle> filterHandles;
   void Add(const cFilterData *FilterData);
   void Del(const cFilterData *FilterData);
+  const cVector<cFilter *> &MatchingFilters(int Pid, int Tid);
+       ///< Returns the attached filters that have filter data for the given Pid and Tid.
+       ///< The list is built with the first call after the filters have changed.
+  void Distribute(int Pid, const uchar *Data, int Length);
+  void ProcessDemux(void);
+  void ProcessFilterHandles(int TimeoutMs);
   virtual void Action(void);
 public:
   cSectionHandler(cDevice *Device);
+       ///< Creates a section handler for the given Device. If Setup.SoftwareSectionFilters
+       ///< is set, the sections are extracted from the TS packets the device receives,
+       ///< instead of reading them from the device's section filters. The PAT (which
+       ///< is never delivered to receivers) and any PIDs that can't be added to the
+       ///< receiver are still read from section filters.
   virtual ~cSectionHandler();
   int Source(void);
   int Transponder(void);
@@ -43,6 +58,9 @@ public:
   void Detach(cFilter *Filter);
   void SetChannel(const cChannel *Channel);
   void SetStatus(bool On);
+  const cReceiver *Receiver(void) const;
+       ///< Returns the receiver this section handler uses to get the TS packets it
+       ///< extracts the sections from, or NULL if it uses the device's section filters.
   };
 
 #endif //__SECTIONS_H
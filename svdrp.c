@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <ifaddrs.h>
+#include <inttypes.h>
 #include <netinet/in.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -31,6 +32,7 @@
 #include "config.h"
 #include "device.h"
 #include "eitscan.h"
+#include "epgindex.h"
 #include "keys.h"
 #include "menu.h"
 #include "plugin.h"
@@ -898,6 +900,23 @@ const char *HelpPages[] = {
   "    recording's directory is listed.\n"
   "    Note that the ids of the recordings are not necessarily given in\n"
   "    numeric order.",
+  "LSTS\n"
+  "    List statistics of the recording pipeline. For each device that reads\n"
+  "    TS packets through a buffer there is a line of the form\n"
+  "    'device:<n> read:<bytes> overflows:<n> buffer:<bytes> maxfill:<bytes>\n"
+  "    packetrate:<packets/s> dispatch:<ns>'. Each receiver that is attached\n"
+  "    to a device has a line of the form 'receiver:<device>.<n>\n"
+  "    channel:<channel id> priority:<n> pids:<n> packets:<n>'. These are\n"
+  "    followed by a line for each active recording of the form\n"
+  "    'recording:<n> packets:<n> written:<bytes> buffer:<bytes>\n"
+  "    maxfill:<bytes> latency:<n>,<n>,<n>,<n>,<n>,<n> blocked:<n>,<n>,<n>,<n>,<n>,<n>\n"
+  "    index:<n>,<avg us>,<max us> overflow:<bytes> dropped:<pid>=<n>,...\n"
+  "    name:<name>'.\n"
+  "    The 'latency' values count the write() calls to the recording that took\n"
+  "    less than 100us, 1ms, 10ms, 100ms, 1s and longer, respectively. The\n"
+  "    'blocked' values count the times the recorder was blocked for as long\n"
+  "    while handing its data over to the file, which with asynchronous writes\n"
+  "    is not the time of the actual write.",
   "LSTT [ <id> ] [ id ]\n"
   "    List timers. Without option, all timers are listed. Otherwise\n"
   "    only the timer with the given id is listed. If the keyword 'id' is\n"
@@ -983,7 +1002,24 @@ const char *HelpPages[] = {
   "    status of the remote control is reported.",
   "SCAN\n"
   "    Forces an EPG scan. If this is a single DVB device system, the scan\n"
-  "    will be done on the primary device unless it is currently recording.",
+  "    will be done on the primary device unless it is currently recording.\n"
+  "    If a scan is already in progress, its progress is reported.",
+  "SRCH [ channel=<channel> ] [ from=<time> ] [ to=<time> ]\n"
+  "     [ content=<content> ] [ in=<fields> ] [ -- ] <text>\n"
+  "    Search EPG data. Lists all events that contain every word of the given\n"
+  "    text in their title, short text or description (ignoring case). Words\n"
+  "    enclosed in double quotes must appear in exactly that order, and a word\n"
+  "    that ends with '*' matches every word that starts with it. The result\n"
+  "    can be restricted to the given channel (either by number or by channel\n"
+  "    ID), to events that overlap the time range given by 'from' and 'to'\n"
+  "    (in time_t form), or to events with the given content (two hexadecimal\n"
+  "    digits as in the 'G' line of LSTE, where a second digit of 0 matches all\n"
+  "    contents of that group). With 'in' the fields that are searched can be\n"
+  "    given as any combination of 't' (title), 's' (short text) and 'd'\n"
+  "    (description). The text starts with the first word that doesn't contain\n"
+  "    a '=', or after '--' (which is needed if the first word of the text\n"
+  "    contains a '=' or is '--'). The events are listed in the same format as\n"
+  "    with LSTE, in the order of the channel numbers.",
   "STAT disk\n"
   "    Return information about disk usage (total, free, percent).",
   "UPDT <settings>\n"
@@ -1088,6 +1124,7 @@ private:
   void CmdLSTD(const char *Option);
   void CmdLSTE(const char *Option);
   void CmdLSTR(const char *Option);
+  void CmdLSTS(const char *Option);
   void CmdLSTT(const char *Option);
   void CmdMESG(const char *Option);
   void CmdMODC(const char *Option);
@@ -1105,6 +1142,7 @@ private:
   void CmdPUTE(const char *Option);
   void CmdREMO(const char *Option);
   void CmdSCAN(const char *Option);
+  void CmdSRCH(const char *Option);
   void CmdSTAT(const char *Option);
   void CmdUPDT(const char *Option);
   void CmdUPDR(const char *Option);
@@ -1333,6 +1371,7 @@ void cSVDRPServer::CmdCLRE(const char *Option)
                   Timer->SetEvent(NULL);
                }
            Schedule->Cleanup(INT_MAX);
+           Schedule->SetModified();
            cEitFilter::SetDisableUntil(time(NULL) + EITDISABLETIME);
            Reply(250, "EPG data of channel \"%s\" cleared", Option);
            }
@@ -1349,8 +1388,10 @@ void cSVDRPServer::CmdCLRE(const char *Option)
      LOCK_SCHEDULES_WRITE;
      for (cTimer *Timer = Timers->First(); Timer; Timer = Timers->Next(Timer))
          Timer->SetEvent(NULL); // processing all timers here (local *and* remote)
-     for (cSchedule *Schedule = Schedules->First(); Schedule; Schedule = Schedules->Next(Schedule))
+     for (cSchedule *Schedule = Schedules->First(); Schedule; Schedule = Schedules->Next(Schedule)) {
          Schedule->Cleanup(INT_MAX);
+         Schedule->SetModified();
+         }
      cEitFilter::SetDisableUntil(time(NULL) + EITDISABLETIME);
      Reply(250, "EPG data cleared");
      }
@@ -1925,6 +1966,48 @@ void cSVDRPServer::CmdLSTR(const char *Option)
      Reply(550, "No recordings available");
 }
 
+void cSVDRPServer::CmdLSTS(const char *Option)
+{
+  if (*Option) {
+     Reply(501, "Unknown option: \"%s\"", Option);
+     return;
+     }
+  cStringList Lines;
+  for (int i = 0; i < cDevice::NumDevices(); i++) {
+      if (cDevice *Device = cDevice::GetDevice(i)) {
+         uint64_t BytesRead;
+         int DriverOverflows, BufferSize, BufferMaxFill;
+         if (Device->TSBufferStats(BytesRead, DriverOverflows, BufferSize, BufferMaxFill))
+            Lines.Append(strdup(cString::sprintf("device:%d read:%" PRIu64 " overflows:%d buffer:%d maxfill:%d packetrate:%d dispatch:%d", Device->DeviceNumber() + 1, BytesRead, DriverOverflows, BufferSize, BufferMaxFill, Device->ReceiverPacketRate(), Device->ReceiverDispatchTime())));
+         tChannelID ChannelID;
+         int Priority, NumPids;
+         uint64_t NumPackets;
+         for (int r = 0; Device->ReceiverStats(r, ChannelID, Priority, NumPids, NumPackets); r++)
+             Lines.Append(strdup(cString::sprintf("receiver:%d.%d channel:%s priority:%d pids:%d packets:%" PRIu64, Device->DeviceNumber() + 1, r + 1, *ChannelID.ToString(), Priority, NumPids, NumPackets)));
+         }
+      }
+  cRecorderStatistics s;
+  cString RecordingName;
+  for (int i = 0; cRecordControls::GetRecorderStatistics(i, s, RecordingName); i++) {
+      cString Latency;
+      for (int b = 0; b < WRITELATENCYBUCKETS; b++)
+          Latency = cString::sprintf("%s%s%d", *Latency ? *Latency : "", b ? "," : "", s.writeLatency[b]);
+      cString Blocked;
+      for (int b = 0; b < RECORDERBLOCKEDBUCKETS; b++)
+          Blocked = cString::sprintf("%s%s%d", *Blocked ? *Blocked : "", b ? "," : "", s.writeBlocked[b]);
+      cString Dropped = "";
+      for (int d = 0; d < s.numDroppedPids; d++)
+          Dropped = cString::sprintf("%s%s%d=%d", *Dropped, d ? "," : "", s.droppedPids[d], s.droppedPackets[d]);
+      Lines.Append(strdup(cString::sprintf("recording:%d packets:%" PRIu64 " written:%" PRIu64 " buffer:%d maxfill:%d latency:%s blocked:%s index:%d,%d,%d overflow:%" PRIu64 " dropped:%s name:%s", i + 1, s.packetsIn, s.bytesWritten, s.bufferSize, s.bufferMaxFill, *Latency, *Blocked, s.indexWrites, s.indexWrites ? int(s.indexWriteTime / s.indexWrites) : 0, s.indexWriteTimeMax, s.bytesDropped, *Dropped, *RecordingName)));
+      }
+  if (Lines.Size()) {
+     for (int i = 0; i < Lines.Size(); i++)
+         Reply(i < Lines.Size() - 1 ? -250 : 250, "%s", Lines[i]);
+     }
+  else
+     Reply(550, "No statistics available");
+}
+
 void cSVDRPServer::CmdLSTT(const char *Option)
 {
   int Id = 0;
@@ -2461,10 +2544,144 @@ void cSVDRPServer::CmdREMO(const char *Option)
 
 void cSVDRPServer::CmdSCAN(const char *Option)
 {
+  int Transponders, Scanned, Devices, Seconds;
+  if (EITScanner.GetStatistics(Transponders, Scanned, Devices, Seconds)) {
+     Reply(250, "EPG scan in progress: %d of %d transponders scanned in %d seconds, %d devices scanning", Scanned, Transponders, Seconds, Devices);
+     return;
+     }
   EITScanner.ForceScan();
   Reply(250, "EPG scan triggered");
 }
 
+struct tSearchGroup {
+  const cChannel *channel;
+  int first; // the index of the group's first event
+  int count;
+  };
+
+static int CompareSearchGroups(const void *a, const void *b)
+{
+  return ((const tSearchGroup *)a)->channel->Number() - ((const tSearchGroup *)b)->channel->Number();
+}
+
+void cSVDRPServer::CmdSRCH(const char *Option)
+{
+  LOCK_CHANNELS_READ;
+  LOCK_SCHEDULES_READ;
+  cEpgQuery Query;
+  time_t From = 0;
+  time_t To = 0;
+  const char *p = skipspace(Option);
+  while (*p) {
+        const char *e = p + strcspn(p, " \t");
+        if (e - p == 2 && strncmp(p, "--", 2) == 0) {
+           p = skipspace(e); // everything after "--" is the text
+           break;
+           }
+        const char *v = (const char *)memchr(p, '=', e - p);
+        if (!v)
+           break; // the text starts with the first word that isn't an option
+        cString Keyword(p, v);
+        cString Value(v + 1, e);
+        if (strcasecmp(Keyword, "CHANNEL") == 0) {
+           const cChannel *Channel = NULL;
+           if (isnumber(Value))
+              Channel = Channels->GetByNumber(strtol(Value, NULL, 10));
+           else
+              Channel = Channels->GetByChannelID(tChannelID::FromString(Value));
+           if (!Channel) {
+              Reply(550, "Channel \"%s\" not defined", *Value);
+              return;
+              }
+           Query.SetChannel(Channel->GetChannelID());
+           }
+        else if (strcasecmp(Keyword, "FROM") == 0 || strcasecmp(Keyword, "TO") == 0) {
+           if (!isnumber(Value)) {
+              Reply(501, "Invalid time \"%s\"", *Value);
+              return;
+              }
+           (strcasecmp(Keyword, "FROM") == 0 ? From : To) = strtol(Value, NULL, 10);
+           }
+        else if (strcasecmp(Keyword, "CONTENT") == 0) {
+           char *t;
+           long Content = strtol(Value, &t, 16);
+           if (*t || Content <= 0 || Content > 0xFF) {
+              Reply(501, "Invalid content \"%s\"", *Value);
+              return;
+              }
+           Query.SetContent(Content);
+           }
+        else if (strcasecmp(Keyword, "IN") == 0) {
+           int Fields = 0;
+           for (const char *f = Value; *f; f++) {
+               switch (tolower(*f)) {
+                 case 't': Fields |= eqfTitle; break;
+                 case 's': Fields |= eqfShortText; break;
+                 case 'd': Fields |= eqfDescription; break;
+                 default: Reply(501, "Invalid fields \"%s\"", *Value);
+                          return;
+                 }
+               }
+           Query.SetFields(Fields);
+           }
+        else {
+           Reply(501, "Unknown option \"%s\" (use \"--\" in front of the text)", *Keyword);
+           return;
+           }
+        p = skipspace(e);
+        }
+  if (!*p) {
+     Reply(501, "Missing search text");
+     return;
+     }
+  Query.SetText(p);
+  Query.SetTimeRange(From, To);
+  cVector<const cEvent *> Events;
+  if (!Query.Find(Schedules, Events)) {
+     Reply(550, "No matching EPG data found");
+     return;
+     }
+  // The events are grouped by schedule, and the groups are listed in the order of their channel numbers:
+  tSearchGroup *Groups = MALLOC(tSearchGroup, Events.Size());
+  int NumGroups = 0;
+  for (int i = 0; i < Events.Size(); ) {
+      const cSchedule *Schedule = Events[i]->Schedule();
+      int First = i;
+      while (i < Events.Size() && Events[i]->Schedule() == Schedule)
+            i++;
+      if (const cChannel *Channel = Channels->GetByChannelID(Schedule->ChannelID(), true)) {
+         Groups[NumGroups].channel = Channel;
+         Groups[NumGroups].first = First;
+         Groups[NumGroups].count = i - First;
+         NumGroups++;
+         }
+      }
+  qsort(Groups, NumGroups, sizeof(tSearchGroup), CompareSearchGroups);
+  int fd = dup(file);
+  if (fd) {
+     FILE *f = fdopen(fd, "w");
+     if (f) {
+        for (int g = 0; g < NumGroups; g++) {
+            const cChannel *Channel = Groups[g].channel;
+            fprintf(f, "215-C %s %s\n", *Channel->GetChannelID().ToString(), Channel->Name());
+            for (int i = Groups[g].first; i < Groups[g].first + Groups[g].count; i++)
+                Events[i]->Dump(f, "215-");
+            fprintf(f, "215-c\n");
+            }
+        fflush(f);
+        Reply(215, "End of EPG data");
+        fclose(f);
+        }
+     else {
+        Reply(451, "Can't open file connection");
+        close(fd);
+        }
+     }
+  else
+     Reply(451, "Can't dup stream descriptor");
+  free(Groups);
+}
+
 void cSVDRPServer::CmdSTAT(const char *Option)
 {
   if (*Option) {
@@ -2578,6 +2795,7 @@ void cSVDRPServer::Execute(char *Cmd)
   else if (CMD("LSTD"))  CmdLSTD(s);
   else if (CMD("LSTE"))  CmdLSTE(s);
   else if (CMD("LSTR"))  CmdLSTR(s);
+  else if (CMD("LSTS"))  CmdLSTS(s);
   else if (CMD("LSTT"))  CmdLSTT(s);
   else if (CMD("MESG"))  CmdMESG(s);
   else if (CMD("MODC"))  CmdMODC(s);
@@ -2595,6 +2813,7 @@ void cSVDRPServer::Execute(char *Cmd)
   else if (CMD("PUTE"))  CmdPUTE(s);
   else if (CMD("REMO"))  CmdREMO(s);
   else if (CMD("SCAN"))  CmdSCAN(s);
+  else if (CMD("SRCH"))  CmdSRCH(s);
   else if (CMD("STAT"))  CmdSTAT(s);
   else if (CMD("UPDR"))  CmdUPDR(s);
   else if (CMD("UPDT"))  CmdUPDT(s);
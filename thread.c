@@ -14,6 +14,7 @@
 #include <execinfo.h>
 #include <linux/unistd.h>
 #include <malloc.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <sys/prctl.h>
@@ -264,6 +265,37 @@ void cThread::SetIOPriority(int Priority)
      LOG_ERROR;
 }
 
+bool cThread::SetCpuAffinity(const char *CpuList)
+{
+  cpu_set_t CpuSet;
+  CPU_ZERO(&CpuSet);
+  const char *p = CpuList;
+  bool Ok = p && *p;
+  while (Ok && *p) {
+        char *t;
+        int First = strtol(p, &t, 10);
+        int Last = First;
+        if (t != p && *t == '-')
+           Last = strtol(p = t + 1, &t, 10);
+        Ok = t != p && First >= 0 && First <= Last && Last < CPU_SETSIZE && (!*t || *t == ',');
+        if (Ok) {
+           for (int i = First; i <= Last; i++)
+               CPU_SET(i, &CpuSet);
+           p = *t ? t + 1 : t;
+           }
+        }
+  if (!Ok) {
+     esyslog("ERROR: invalid CPU list '%s'", CpuList ? CpuList : "");
+     return false;
+     }
+  if (sched_setaffinity(0, sizeof(CpuSet), &CpuSet) < 0) {
+     LOG_ERROR;
+     return false;
+     }
+  dsyslog("%s thread bound to CPUs %s", description ? description : "", CpuList);
+  return true;
+}
+
 void cThread::SetDescription(const char *Description, ...)
 {
   free(description);
@@ -91,6 +91,10 @@ private:
 protected:
   void SetPriority(int Priority);
   void SetIOPriority(int Priority);
+  bool SetCpuAffinity(const char *CpuList);
+       ///< Restricts the calling thread to the CPUs in CpuList, which is given in
+       ///< the kernel's list format (as in "0-3,8,10-11"). Meant to be called from
+       ///< within Action(). Returns false if CpuList is invalid or can't be applied.
   void Lock(void) { mutex.Lock(); }
   void Unlock(void) { mutex.Unlock(); }
   virtual void Action(void) = 0;
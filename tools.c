@@ -1787,9 +1787,232 @@ bool cSafeFile::Close(void)
 
 #define WRITE_BUFFER KILOBYTE(800)
 
+// --- cWriteLatencies -------------------------------------------------------
+
+cWriteLatencies::cWriteLatencies(void)
+{
+  memset(count, 0, sizeof(count));
+}
+
+void cWriteLatencies::Add(uint64_t Time)
+{
+  int Bucket = 0;
+  for (uint64_t Limit = 100; Bucket < WRITELATENCYBUCKETS - 1 && Time >= Limit; Limit *= 10)
+      Bucket++;
+  cMutexLock MutexLock(&mutex);
+  count[Bucket]++;
+}
+
+void cWriteLatencies::Get(int *Count)
+{
+  cMutexLock MutexLock(&mutex);
+  memcpy(Count, count, sizeof(count));
+}
+
+// --- cUnbufferedFileWriter -------------------------------------------------
+
+#define ASYNCWRITEBUFFER MEGABYTE(8) // the size of the buffer for asynchronous writes
+#define ASYNCWRITECHUNK  MEGABYTE(1) // the maximum amount of data written with one call
+#define ASYNCWRITEJOBS   256         // the maximum number of pending writes
+
+class cUnbufferedFileWriter : public cThread {
+private:
+  struct tWriteJob {
+    const uchar *data;
+    int count;
+    cWriteBufferOwner *owner; // NULL if data has been copied into our own buffer
+    };
+  cUnbufferedFile *file;
+  uchar *buffer;
+  int size;
+  int head;
+  int fill;
+  tWriteJob jobs[ASYNCWRITEJOBS];
+  int firstJob;
+  int numJobs;
+  off_t pending;
+  int error;
+  cMutex mutex;
+  cCondVar dataReady;
+  cCondVar spaceReady;
+  void AddJob(const uchar *Data, int Count, cWriteBufferOwner *Owner);
+protected:
+  virtual void Action(void);
+public:
+  cUnbufferedFileWriter(cUnbufferedFile *File);
+  virtual ~cUnbufferedFileWriter();
+  bool Ok(void) { return buffer != NULL; }
+       ///< Returns false if the buffer could not be allocated, in which case
+       ///< this writer can't be used.
+  ssize_t Write(const void *Data, size_t Size);
+  ssize_t WriteShared(const uchar *Data, int Count, cWriteBufferOwner *Owner);
+  bool Flush(void);
+       ///< Waits until all pending data has been written to the file.
+       ///< Returns false (and sets errno accordingly) if an error occurred.
+  off_t Pending(void);
+  };
+
+cUnbufferedFileWriter::cUnbufferedFileWriter(cUnbufferedFile *File)
+:cThread("file writer")
+{
+  file = File;
+  buffer = NULL;
+  size = ASYNCWRITEBUFFER;
+  head = 0;
+  fill = 0;
+  firstJob = 0;
+  numJobs = 0;
+  pending = 0;
+  error = 0;
+  if (posix_memalign((void **)&buffer, getpagesize(), size) != 0) {
+     esyslog("ERROR: can't allocate buffer for asynchronous writes - writing synchronously");
+     buffer = NULL;
+     }
+  else
+     Start();
+}
+
+cUnbufferedFileWriter::~cUnbufferedFileWriter()
+{
+  Cancel(-1);
+  mutex.Lock();
+  dataReady.Broadcast(); // the thread may be waiting for data
+  mutex.Unlock();
+  Cancel(3);
+  // Make sure the owners of any shared buffers get them back:
+  for (; numJobs > 0; numJobs--) {
+      tWriteJob &Job = jobs[firstJob];
+      if (Job.owner)
+         Job.owner->BufferWritten(Job.data, Job.count);
+      firstJob = (firstJob + 1) % ASYNCWRITEJOBS;
+      }
+  free(buffer);
+}
+
+void cUnbufferedFileWriter::AddJob(const uchar *Data, int Count, cWriteBufferOwner *Owner)
+{
+  if (!Owner && numJobs > 0) {
+     // Append to the previous job if the data is contiguous:
+     tWriteJob &Last = jobs[(firstJob + numJobs - 1) % ASYNCWRITEJOBS];
+     if (!Last.owner && Last.data + Last.count == Data) {
+        Last.count += Count;
+        pending += Count;
+        dataReady.Broadcast();
+        return;
+        }
+     }
+  tWriteJob &Job = jobs[(firstJob + numJobs) % ASYNCWRITEJOBS];
+  Job.data = Data;
+  Job.count = Count;
+  Job.owner = Owner;
+  numJobs++;
+  pending += Count;
+  dataReady.Broadcast();
+}
+
+void cUnbufferedFileWriter::Action(void)
+{
+  cMutexLock MutexLock(&mutex);
+  while (Running()) {
+        if (numJobs > 0) {
+           tWriteJob &Job = jobs[firstJob];
+           const uchar *Data = Job.data;
+           int Count = Job.owner ? Job.count : min(Job.count, int(ASYNCWRITECHUNK)); // shared buffers are written as a whole
+           ssize_t Written = Count;
+           int Errno = 0;
+           if (!error) { // after an error the remaining data is lost
+              mutex.Unlock(); // the data in Data[0...Count] is not touched by Write()
+              Written = file->WriteData(Data, Count);
+              Errno = errno;
+              mutex.Lock();
+              }
+           if (Written < 0) {
+              if (!error)
+                 esyslog("ERROR: asynchronous write failed: %s", strerror(Errno));
+              error = Errno;
+              }
+           Job.data += Count;
+           Job.count -= Count;
+           pending -= Count;
+           if (!Job.owner)
+              fill -= Count;
+           if (Job.count <= 0) {
+              if (Job.owner)
+                 Job.owner->BufferWritten(Data, Count);
+              firstJob = (firstJob + 1) % ASYNCWRITEJOBS;
+              numJobs--;
+              }
+           spaceReady.Broadcast();
+           }
+        else
+           dataReady.TimedWait(mutex, 100);
+        }
+}
+
+ssize_t cUnbufferedFileWriter::Write(const void *Data, size_t Size)
+{
+  cMutexLock MutexLock(&mutex);
+  const uchar *p = (const uchar *)Data;
+  size_t Rest = Size;
+  while (Rest > 0) {
+        while ((fill == size || numJobs == ASYNCWRITEJOBS) && !error)
+              spaceReady.Wait(mutex);
+        if (error) {
+           errno = error;
+           return -1;
+           }
+        int Count = min(min(size - fill, size - head), int(min(Rest, size_t(size))));
+        memcpy(buffer + head, p, Count);
+        AddJob(buffer + head, Count, NULL);
+        head += Count;
+        if (head >= size)
+           head = 0;
+        fill += Count;
+        p += Count;
+        Rest -= Count;
+        }
+  return Size;
+}
+
+ssize_t cUnbufferedFileWriter::WriteShared(const uchar *Data, int Count, cWriteBufferOwner *Owner)
+{
+  cMutexLock MutexLock(&mutex);
+  while (numJobs == ASYNCWRITEJOBS && !error)
+        spaceReady.Wait(mutex);
+  if (error) {
+     Owner->BufferWritten(Data, Count);
+     errno = error;
+     return -1;
+     }
+  AddJob(Data, Count, Owner);
+  return Count;
+}
+
+bool cUnbufferedFileWriter::Flush(void)
+{
+  cMutexLock MutexLock(&mutex);
+  while (numJobs > 0)
+        spaceReady.Wait(mutex);
+  if (error) {
+     errno = error;
+     return false;
+     }
+  return true;
+}
+
+off_t cUnbufferedFileWriter::Pending(void)
+{
+  cMutexLock MutexLock(&mutex);
+  return pending;
+}
+
+// --- cUnbufferedFile -------------------------------------------------------
+
 cUnbufferedFile::cUnbufferedFile(void)
 {
   fd = -1;
+  writer = NULL;
+  latencies = NULL;
 }
 
 cUnbufferedFile::~cUnbufferedFile()
@@ -1818,6 +2041,14 @@ int cUnbufferedFile::Open(const char *FileName, int Flags, mode_t Mode)
 int cUnbufferedFile::Close(void)
 {
   if (fd >= 0) {
+     bool WriteOk = true;
+     int WriteErrno = 0;
+     if (writer) {
+        WriteOk = writer->Flush();
+        WriteErrno = errno;
+        delete writer;
+        writer = NULL;
+        }
 #if USE_FADVISE_READ || USE_FADVISE_WRITE
      if (totwritten)    // if we wrote anything make sure the data has hit the disk before
         fdatasync(fd);  // calling fadvise, as this is our last chance to un-cache it.
@@ -1825,7 +2056,12 @@ int cUnbufferedFile::Close(void)
 #endif
      int OldFd = fd;
      fd = -1;
-     return close(OldFd);
+     int Result = close(OldFd);
+     if (!WriteOk) {
+        errno = WriteErrno;
+        return -1;
+        }
+     return Result;
      }
   errno = EBADF;
   return -1;
@@ -1852,6 +2088,8 @@ int cUnbufferedFile::FadviseDrop(off_t Offset, off_t Len)
 
 off_t cUnbufferedFile::Seek(off_t Offset, int Whence)
 {
+  if (writer && !writer->Flush())
+     return -1;
   if (Whence == SEEK_SET && Offset == curpos)
      return curpos;
   curpos = lseek(fd, Offset, Whence);
@@ -1860,6 +2098,8 @@ off_t cUnbufferedFile::Seek(off_t Offset, int Whence)
 
 ssize_t cUnbufferedFile::Read(void *Data, size_t Size)
 {
+  if (writer && !writer->Flush())
+     return -1;
   if (fd >= 0) {
 #if USE_FADVISE_READ
      off_t jumped = curpos-lastpos; // nonzero means we're not at the last offset
@@ -1917,9 +2157,61 @@ ssize_t cUnbufferedFile::Read(void *Data, size_t Size)
 }
 
 ssize_t cUnbufferedFile::Write(const void *Data, size_t Size)
+{
+  if (writer)
+     return writer->Write(Data, Size);
+  return WriteData(Data, Size);
+}
+
+ssize_t cUnbufferedFile::WriteShared(const uchar *Data, int Count, cWriteBufferOwner *Owner)
+{
+  if (writer)
+     return writer->WriteShared(Data, Count, Owner);
+  ssize_t Written = WriteData(Data, Count);
+  Owner->BufferWritten(Data, Count);
+  return Written;
+}
+
+off_t cUnbufferedFile::Pending(void)
+{
+  return writer ? writer->Pending() : 0;
+}
+
+void cUnbufferedFile::SetWriteLatencies(cWriteLatencies *Latencies)
+{
+  if (writer)
+     writer->Flush(); // makes sure the writer thread doesn't use the previous ones
+  latencies = Latencies;
+}
+
+void cUnbufferedFile::SetAsyncWrite(bool On)
+{
+  if (On) {
+     if (!writer && fd >= 0) {
+        writer = new cUnbufferedFileWriter(this);
+        if (!writer->Ok())
+           DELETENULL(writer);
+        }
+     }
+  else if (writer) {
+     writer->Flush();
+     delete writer;
+     writer = NULL;
+     }
+}
+
+ssize_t cUnbufferedFile::WriteData(const void *Data, size_t Size)
 {
   if (fd >=0) {
+     struct timespec Start;
+     if (latencies)
+        clock_gettime(CLOCK_MONOTONIC, &Start);
      ssize_t bytesWritten = safe_write(fd, Data, Size);
+     if (latencies) {
+        struct timespec End;
+        clock_gettime(CLOCK_MONOTONIC, &End);
+        latencies->Add((End.tv_sec - Start.tv_sec) * 1000000LL + (End.tv_nsec - Start.tv_nsec) / 1000);
+        }
 #if USE_FADVISE_WRITE
      if (bytesWritten > 0) {
         begin = min(begin, curpos);
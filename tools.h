@@ -460,7 +460,34 @@ public:
 /// cUnbufferedFile is used for large files that are mainly written or read
 /// in a streaming manner, and thus should not be cached.
 
+#define WRITELATENCYBUCKETS 6 // write() calls that took below 100us, 1ms, 10ms, 100ms, 1s and longer
+
+class cWriteLatencies {
+private:
+  cMutex mutex;
+  int count[WRITELATENCYBUCKETS];
+public:
+  cWriteLatencies(void);
+  void Add(uint64_t Time);
+       ///< Counts a write() call that took Time microseconds.
+  void Get(int *Count);
+       ///< Copies the number of write() calls counted in each bucket so far into
+       ///< Count, which must have room for WRITELATENCYBUCKETS elements.
+  };
+
+class cWriteBufferOwner {
+public:
+  virtual ~cWriteBufferOwner() {}
+  virtual void BufferWritten(const uchar *Data, int Count) = 0;
+       ///< Is called when the given Data, which has been handed over to
+       ///< cUnbufferedFile::WriteShared(), has been written and the memory may
+       ///< be reused. This may be called from a different thread.
+  };
+
+class cUnbufferedFileWriter;
+
 class cUnbufferedFile {
+  friend class cUnbufferedFileWriter;
 private:
   int fd;
   off_t curpos;
@@ -472,7 +499,10 @@ private:
   size_t readahead;
   size_t written;
   size_t totwritten;
+  cUnbufferedFileWriter *writer;
+  cWriteLatencies *latencies;
   int FadviseDrop(off_t Offset, off_t Len);
+  ssize_t WriteData(const void *Data, size_t Size);
 public:
   cUnbufferedFile(void);
   ~cUnbufferedFile();
@@ -482,6 +512,29 @@ public:
   off_t Seek(off_t Offset, int Whence);
   ssize_t Read(void *Data, size_t Size);
   ssize_t Write(const void *Data, size_t Size);
+  void SetAsyncWrite(bool On);
+       ///< If On is true, Write() merely copies the given data into a buffer and
+       ///< returns immediately, while a separate thread actually writes it to the
+       ///< file. This way a slow disk doesn't directly block the caller. Any error
+       ///< that occurs while writing the data is reported by the next call to
+       ///< Write() or Close(). Read() and Seek() wait until all pending data has
+       ///< been written. If On is false, any pending data is written and Write()
+       ///< returns to writing the data directly.
+       ///< If the buffer for asynchronous writes can't be allocated, the data
+       ///< is written synchronously.
+       ///< The file must have been opened before calling this function.
+  ssize_t WriteShared(const uchar *Data, int Count, cWriteBufferOwner *Owner);
+       ///< Like Write(), but in asynchronous mode the data is not copied. Instead the
+       ///< caller must leave Data untouched until Owner->BufferWritten() is called,
+       ///< which happens in any case, even if an error occurs. Data written with
+       ///< Write() and WriteShared() ends up in the file in the order of the calls.
+  off_t Pending(void);
+       ///< Returns the number of bytes that have been given to Write() or WriteShared()
+       ///< in asynchronous mode, but have not yet been written to the file.
+  void SetWriteLatencies(cWriteLatencies *Latencies);
+       ///< Times every write() call on this file (which in asynchronous mode happens
+       ///< in the writer thread) and counts it in the given Latencies, which must
+       ///< remain valid until the file is closed. NULL turns this off.
   static cUnbufferedFile *Create(const char *FileName, int Flags, mode_t Mode = DEFFILEMODE);
   };
 
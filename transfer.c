@@ -63,6 +63,14 @@ void cTransfer::Receive(const uchar *Data, int Length)
      }
 }
 
+void cTransfer::ReceiveBatch(const uchar *Data, int Count)
+{
+  // The device can only play one TS packet at a time, but this at least saves
+  // the virtual function call for each of them:
+  for (int i = 0; i < Count; i++, Data += TS_SIZE)
+      cTransfer::Receive(Data, TS_SIZE);
+}
+
 // --- cTransferControl ------------------------------------------------------
 
 cDevice *cTransferControl::receiverDevice = NULL;
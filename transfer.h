@@ -22,6 +22,7 @@ private:
 protected:
   virtual void Activate(bool On);
   virtual void Receive(const uchar *Data, int Length);
+  virtual void ReceiveBatch(const uchar *Data, int Count);
 public:
   cTransfer(const cChannel *Channel);
   virtual ~cTransfer();
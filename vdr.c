@@ -285,6 +285,7 @@ int main(int argc, char *argv[])
       { "epgfile",  required_argument, NULL, 'E' },
       { "filesize", required_argument, NULL, 'f' | 0x100 },
       { "genindex", required_argument, NULL, 'g' | 0x100 },
+      { "genindexes",required_argument, NULL, 'g' | 0x200 },
       { "grab",     required_argument, NULL, 'g' },
       { "help",     no_argument,       NULL, 'h' },
       { "instance", required_argument, NULL, 'i' },
@@ -401,6 +402,8 @@ int main(int argc, char *argv[])
                     break;
           case 'g' | 0x100:
                     return GenerateIndex(optarg) ? 0 : 2;
+          case 'g' | 0x200:
+                    return GenerateIndexes(optarg) ? 0 : 2;
           case 'g': SetSVDRPGrabImageDir(*optarg != '-' ? optarg : NULL);
                     break;
           case 'h': DisplayHelp = true;
@@ -587,6 +590,8 @@ int main(int argc, char *argv[])
                "            --filesize=SIZE limit video files to SIZE bytes (default is %dM)\n"
                "                           only useful in conjunction with --edit\n"
                "            --genindex=REC generate index for recording REC and exit\n"
+               "            --genindexes=DIR generate the indexes of all recordings in DIR\n"
+               "                           (and its subdirectories) and exit\n"
                "  -g DIR,   --grab=DIR     write images from the SVDRP command GRAB into the\n"
                "                           given DIR; DIR must be the full path name of an\n"
                "                           existing directory, without any \"..\", double '/'\n"
@@ -817,6 +822,10 @@ int main(int argc, char *argv[])
   if (!PluginManager.InitializePlugins())
      EXIT(2);
 
+  // Device affinities (after the plugins have created their devices):
+
+  cDevice::SetCpuAffinities(Setup.DeviceAffinity);
+
   // Primary device:
 
   cDevice::SetPrimaryDevice(Setup.PrimaryDVB);